@@ -27,6 +27,24 @@ unsigned long bot_lasttime; // last time messages' scan has been done
 int last_message_id = 0;
 int ledState = LOW;
 
+// The keyboards are built in this buffer, so redrawing them doesn't allocate
+char keyboardBuffer[256];
+TelegramKeyboard keyboard(keyboardBuffer);
+
+// A keyboard that never changes can be kept in flash
+const char optionsKeyboard[] PROGMEM =
+    "[[{\"text\":\"Go to Google\",\"url\":\"https://www.google.com\"}],"
+    "[{\"text\":\"Send\",\"callback_data\":\"This was sent by inline\"}]]";
+
+// Builds the keyboard showing the current ledState
+void buildLedKeyboard()
+{
+    keyboard.clear();
+    keyboard.addCallbackButton(ledState ? "The LED is ON" : "The LED is OFF", "/toggleLED");
+    keyboard.addRow();
+    keyboard.addCallbackButton("Send text", "This text was sent by inline button");
+}
+
 void handleNewMessages(int numNewMessages)
 {
 
@@ -47,7 +65,7 @@ void handleNewMessages(int numNewMessages)
         Serial.println(message_id);
 
         // Inline buttons with callbacks when pressed will raise a callback_query message
-        if (bot.messages[i].type == "callback_query")
+        if (bot.messages[i].update_type == TELEGRAM_UPDATE_CALLBACK_QUERY)
         {
             Serial.print("Call back button pressed by: ");
             Serial.println(bot.messages[i].from_id);
@@ -67,23 +85,11 @@ void handleNewMessages(int numNewMessages)
                 msg += "Try it again, see the button has updated as well:\n\n";
 
                 // Prepare the buttons
-                String keyboardJson = "["; // start Json
-                keyboardJson += "[{ \"text\" : \"The LED is ";
-                if (ledState)
-                {
-                    keyboardJson += "ON";
-                }
-                else
-                {
-                    keyboardJson += "OFF";
-                }
-                keyboardJson += "\", \"callback_data\" : \"/toggleLED\" }]";
-                keyboardJson += ", [{ \"text\" : \"Send text\", \"callback_data\" : \"This text was sent by inline button\" }]"; // add another button
-                //keyboardJson += ", [{ \"text\" : \"Go to Google\", \"url\" : \"https://www.google.com\" }]"; // add another button, this one appears after first Update
-                keyboardJson += "]"; // end Json
+                buildLedKeyboard();
+                //keyboard.addUrlButton("Go to Google", "https://www.google.com"); // add another button, this one appears after first Update
 
                 // Now send this message including the current message_id as the 5th input to UPDATE that message
-                bot.sendMessageWithInlineKeyboard(chat_id, msg, "Markdown", keyboardJson, message_id);
+                bot.sendMessageWithInlineKeyboard(chat_id, msg, "Markdown", keyboard, message_id);
             }
 
             else
@@ -104,27 +110,15 @@ void handleNewMessages(int numNewMessages)
                 msg += "Lets test this updating LED button below:\n\n";
 
                 // lets create a button depending on the current ledState
-                String keyboardJson = "["; // start of keyboard json
-                keyboardJson += "[{ \"text\" : \"The LED is ";
-                if (ledState)
-                {
-                    keyboardJson += "ON";
-                }
-                else
-                {
-                    keyboardJson += "OFF";
-                }
-                keyboardJson += "\", \"callback_data\" : \"/toggleLED\" }]";                                                     //callback is /toggleLED
-                keyboardJson += ", [{ \"text\" : \"Send text\", \"callback_data\" : \"This text was sent by inline button\" }]"; // add another button
-                keyboardJson += "]";                                                                                             // end of keyboard json
+                buildLedKeyboard();
 
                 //first time, send this message as a normal inline keyboard message:
-                bot.sendMessageWithInlineKeyboard(chat_id, msg, "Markdown", keyboardJson);
+                bot.sendMessageWithInlineKeyboard(chat_id, msg, "Markdown", keyboard);
             }
             if (text == "/options")
             {
-                String keyboardJson = "[[{ \"text\" : \"Go to Google\", \"url\" : \"https://www.google.com\" }], [{ \"text\" : \"Send\", \"callback_data\" : \"This was sent by inline\" }]]";
-                bot.sendMessageWithInlineKeyboard(chat_id, "Choose from one of the following options", "", keyboardJson);
+                keyboard.load(FPSTR(optionsKeyboard));
+                bot.sendMessageWithInlineKeyboard(chat_id, "Choose from one of the following options", "", keyboard);
             }
         }
     }
@@ -59,12 +59,6 @@ bool flashState = LOW;
 
 camera_fb_t *fb = NULL;
 
-bool isMoreDataAvailable();
-byte *getNextBuffer();
-int getNextBufferLen();
-
-bool dataAvailable = false;
-
 void handleNewMessages(int numNewMessages)
 {
   Serial.println("handleNewMessages");
@@ -96,11 +90,12 @@ void handleNewMessages(int numNewMessages)
         bot.sendMessage(chat_id, "Camera capture failed", "");
         return;
       }
-      dataAvailable = true;
       Serial.println("Sending");
-      bot.sendPhotoByBinary(chat_id, "image/jpeg", fb->len,
-                            isMoreDataAvailable, nullptr,
-                            getNextBuffer, getNextBufferLen);
+      // The frame buffer is sent as it is, without copying it
+      TelegramUpload upload;
+      upload.addField("chat_id", chat_id);
+      upload.addFile("photo", "img.jpg", "image/jpeg", fb->buf, fb->len);
+      bot.sendMultipart("sendPhoto", upload);
 
       Serial.println("done!");
 
@@ -117,43 +112,6 @@ void handleNewMessages(int numNewMessages)
   }
 }
 
-bool isMoreDataAvailable()
-{
-  if (dataAvailable)
-  {
-    dataAvailable = false;
-    return true;
-  }
-  else
-  {
-    return false;
-  }
-}
-
-byte *getNextBuffer()
-{
-  if (fb)
-  {
-    return fb->buf;
-  }
-  else
-  {
-    return nullptr;
-  }
-}
-
-int getNextBufferLen()
-{
-  if (fb)
-  {
-    return fb->len;
-  }
-  else
-  {
-    return 0;
-  }
-}
-
 void setup()
 {
   Serial.begin(115200);
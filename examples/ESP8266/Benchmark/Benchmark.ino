@@ -0,0 +1,198 @@
+/*******************************************************************
+    Measures how long the main API calls take and how much heap
+    they use on an ESP8266.
+
+    Every call is repeated RUNS times, then the average, fastest and
+    slowest time, the calls per second, the lowest free heap seen
+    and the number of TLS handshakes are printed to serial.
+
+    Define FAKE_SERVER_HOST to run against a local server replaying
+    recorded Bot API responses over plain HTTP instead of Telegram,
+    which takes the network out of the numbers so changes to the
+    library can be compared. extras/host builds one:
+    telegram-replay-server -a extras/host/sessions/benchmark.txt
+
+    Parts:
+    D1 Mini ESP8266 * - http://s.click.aliexpress.com/e/uzFUnIe
+    (or any ESP8266 board)
+
+      = Affilate
+
+    If you find what I do useful and would like to support me,
+    please consider becoming a sponsor on Github
+    https://github.com/sponsors/witnessmenow/
+
+
+    Written by Brian Lough
+    YouTube: https://www.youtube.com/brianlough
+    Tindie: https://www.tindie.com/stores/brianlough/
+    Twitter: https://twitter.com/witnessmenow
+ *******************************************************************/
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <UniversalTelegramBot.h>
+
+// Wifi network station credentials
+#define WIFI_SSID "YOUR_SSID"
+#define WIFI_PASSWORD "YOUR_PASSWORD"
+// Telegram BOT Token (Get from Botfather)
+#define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
+// Chat the benchmark messages are sent to
+#define CHAT_ID "XXXXXXXX"
+
+// Uncomment to benchmark against a local server instead of Telegram
+//#define FAKE_SERVER_HOST "192.168.1.10"
+//#define FAKE_SERVER_PORT 8080
+
+// Number of times every call is made
+const int RUNS = 20;
+
+#ifdef FAKE_SERVER_HOST
+WiFiClient client;
+#else
+X509List cert(TELEGRAM_CERTIFICATE_ROOT);
+WiFiClientSecure client;
+#endif
+UniversalTelegramBot bot(BOT_TOKEN, client);
+
+uint32_t lowestHeap;
+
+void sampleHeap()
+{
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < lowestHeap)
+    lowestHeap = freeHeap;
+}
+
+void printResult(const char *name, unsigned long total, unsigned long fastest,
+                 unsigned long slowest, int failed, uint32_t heapBefore,
+                 unsigned long handshakes)
+{
+  Serial.print(name);
+  Serial.print(": avg ");
+  Serial.print(total / RUNS);
+  Serial.print(" ms, min ");
+  Serial.print(fastest);
+  Serial.print(" ms, max ");
+  Serial.print(slowest);
+  Serial.print(" ms, ");
+  Serial.print(total > 0 ? RUNS * 1000.0 / total : 0.0);
+  Serial.print(" calls/s, ");
+  Serial.print(failed);
+  Serial.print(" failed, heap used ");
+  Serial.print(heapBefore - lowestHeap);
+  Serial.print(" bytes, largest free block ");
+  Serial.print(ESP.getMaxFreeBlockSize());
+  Serial.print(" bytes, ");
+  Serial.print(bot.getHandshakeCount() - handshakes);
+  Serial.println(" handshakes");
+}
+
+// Makes the call RUNS times, call returns false if the request failed
+void benchmark(const char *name, bool (*call)())
+{
+  unsigned long total = 0;
+  unsigned long fastest = ULONG_MAX;
+  unsigned long slowest = 0;
+  int failed = 0;
+  uint32_t heapBefore = ESP.getFreeHeap();
+  unsigned long handshakes = bot.getHandshakeCount();
+  lowestHeap = heapBefore;
+
+  for (int i = 0; i < RUNS; i++)
+  {
+    unsigned long start = millis();
+    if (!call())
+      failed++;
+    unsigned long elapsed = millis() - start;
+    sampleHeap();
+
+    total += elapsed;
+    if (elapsed < fastest)
+      fastest = elapsed;
+    if (elapsed > slowest)
+      slowest = elapsed;
+  }
+
+  printResult(name, total, fastest, slowest, failed, heapBefore, handshakes);
+}
+
+bool callGetMe()
+{
+  return bot.getMe();
+}
+
+bool callSendMessage()
+{
+  return bot.sendMessage(CHAT_ID, "Benchmark message", "");
+}
+
+bool callGetUpdates()
+{
+  bot.getUpdates(bot.last_message_received + 1);
+  return bot._lastError == TELEGRAM_ERROR_NONE;
+}
+
+bool callFetchUpdates()
+{
+  bot.fetchUpdates();
+  while (bot.nextMessage() != nullptr)
+    bot.ackMessage();
+  return bot._lastError == TELEGRAM_ERROR_NONE;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println();
+
+  // attempt to connect to Wifi network:
+  Serial.print("Connecting to Wifi SSID ");
+  Serial.print(WIFI_SSID);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+#ifdef FAKE_SERVER_HOST
+  bot.serverHost = FAKE_SERVER_HOST;
+  bot.serverPort = FAKE_SERVER_PORT;
+#else
+  client.setTrustAnchors(&cert); // Add root certificate for api.telegram.org
+#endif
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print("\nWiFi connected. IP address: ");
+  Serial.println(WiFi.localIP());
+
+#ifndef FAKE_SERVER_HOST
+  Serial.print("Retrieving time: ");
+  configTime(0, 0, "pool.ntp.org"); // get UTC time via NTP
+  time_t now = time(nullptr);
+  while (now < 24 * 3600)
+  {
+    Serial.print(".");
+    delay(100);
+    now = time(nullptr);
+  }
+  Serial.println(now);
+#endif
+
+  Serial.print("Free heap at start: ");
+  Serial.println(ESP.getFreeHeap());
+
+  benchmark("getMe", callGetMe);
+  benchmark("sendMessage", callSendMessage);
+  benchmark("getUpdates", callGetUpdates);
+  bot.streamUpdates = true;
+  benchmark("getUpdates (streamed)", callGetUpdates);
+  bot.streamUpdates = false;
+  benchmark("fetchUpdates", callFetchUpdates);
+  bot.keepAlive = false;
+  benchmark("getMe (no keep-alive)", callGetMe);
+}
+
+void loop()
+{
+}
@@ -16,8 +16,6 @@
 #define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
 
 const char *SUBSCRIBED_USERS_FILENAME = "/subscribed_users.json"; // Filename for local storage
-const unsigned long BULK_MESSAGES_MTBS = 1500;                    // Mean time between send messages, 1.5 seconds
-const unsigned int MESSAGES_LIMIT_PER_SECOND = 25;                // Telegram API have limit for bulk messages ~30 messages per second
 const unsigned long BOT_MTBS = 1000;                              // Mean time between scan messages
 
 WiFiClientSecure secured_client;
@@ -105,20 +103,16 @@ bool removeSubscribedUser(String chat_id)
 void sendMessageToAllSubscribedUsers(String message)
 {
   JsonObject users = getSubscribedUsers();
-  unsigned int users_processed = 0;
 
   for (JsonObject::iterator it = users.begin(); it != users.end(); ++it)
   {
-    users_processed++;
-    if (users_processed < MESSAGES_LIMIT_PER_SECOND)
+    const char *chat_id = it->key().c_str();
+    // The bot sends queued messages as fast as Telegram's limits allow,
+    // keep it working while the queue is full
+    while (!bot.queueMessage(chat_id, message))
     {
-      const char *chat_id = it->key().c_str();
-      bot.sendMessage(chat_id, message, "");
-    }
-    else
-    {
-      delay(BULK_MESSAGES_MTBS);
-      users_processed = 0;
+      bot.loop();
+      yield();
     }
   }
 }
@@ -212,6 +206,10 @@ void setup()
   Serial.begin(115200);
   Serial.println();
 
+  // Write up to 4 bulk messages back to back instead of waiting for the
+  // answer to each one first
+  bot.pipelineDepth = 4;
+
   if (!LittleFS.begin())
   {
     Serial.println("Failed to mount file system");
@@ -246,6 +244,9 @@ void setup()
 
 void loop()
 {
+  // Sends the queued bulk messages
+  bot.loop();
+
   if (millis() - bot_lasttime > BOT_MTBS)
   {
     int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
@@ -5,6 +5,10 @@
 *
 *  This should reduce amount of data used by the bot
 *
+*  pollUpdates() adapts the long poll to the traffic: it waits up
+*  to maxTimeout seconds while the bot is idle and polls straight
+*  away while messages keep coming in
+*
 *  written by Brian Lough
 *******************************************************************/
 #include <ESP8266WiFi.h>
@@ -17,9 +21,6 @@
 // Telegram BOT Token (Get from Botfather)
 #define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
 
-const unsigned long BOT_MTBS = 1000; // mean time between scan messages
-
-unsigned long bot_lasttime;          // last time messages' scan has been done
 X509List cert(TELEGRAM_CERTIFICATE_ROOT);
 WiFiClientSecure secured_client;
 UniversalTelegramBot bot(BOT_TOKEN, secured_client);
@@ -62,23 +63,15 @@ void setup()
   }
   Serial.println(now);
 
-  bot.longPoll = 60;
+  bot.pollScheduler.maxTimeout = 60;
 }
 
 void loop()
 {
-  if (millis() - bot_lasttime > BOT_MTBS)
+  int numNewMessages = bot.pollUpdates();
+  if (numNewMessages)
   {
-    int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-
-    while (numNewMessages)
-    {
-      Serial.println("got response");
-      handleNewMessages(numNewMessages);
-      numNewMessages = bot.getUpdates(bot.last_message_received + 1);
-    }
-
-    Serial.println("I will happen much less often with a long poll");
-    bot_lasttime = millis();
+    Serial.println("got response");
+    handleNewMessages(numNewMessages);
   }
 }
@@ -0,0 +1,117 @@
+/*******************************************************************
+    A telegram bot for your ESP8266 that echoes messages back
+    without ever blocking the sketch while it waits for Telegram.
+
+    Requests are queued and then advanced a little on every call of
+    bot.loop(), so the rest of loop() (here a blinking LED) keeps
+    running while the bot long polls.
+
+    Parts:
+    D1 Mini ESP8266 * - http://s.click.aliexpress.com/e/uzFUnIe
+    (or any ESP8266 board)
+
+      = Affilate
+
+    If you find what I do useful and would like to support me,
+    please consider becoming a sponsor on Github
+    https://github.com/sponsors/witnessmenow/
+
+
+    Written by Brian Lough
+    YouTube: https://www.youtube.com/brianlough
+    Tindie: https://www.tindie.com/stores/brianlough/
+    Twitter: https://twitter.com/witnessmenow
+ *******************************************************************/
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <UniversalTelegramBot.h>
+
+// Wifi network station credentials
+#define WIFI_SSID "YOUR_SSID"
+#define WIFI_PASSWORD "YOUR_PASSWORD"
+// Telegram BOT Token (Get from Botfather)
+#define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
+
+const int ledPin = LED_BUILTIN;
+const unsigned long BLINK_INTERVAL = 250;
+
+X509List cert(TELEGRAM_CERTIFICATE_ROOT);
+WiFiClientSecure secured_client;
+UniversalTelegramBot bot(BOT_TOKEN, secured_client, 5);
+bool polling = false;
+unsigned long lastBlink;
+
+void onMessageSent(UniversalTelegramBot &bot, int error, const String &response)
+{
+  if (error != TELEGRAM_ERROR_NONE)
+  {
+    Serial.print("Sending failed: ");
+    Serial.println(error);
+  }
+}
+
+void onUpdates(UniversalTelegramBot &bot, int newMessages)
+{
+  polling = false;
+
+  telegramMessage *message;
+  while ((message = bot.nextMessage()) != nullptr)
+  {
+    if (!bot.sendMessageAsync(message->chat_id, message->text, "", onMessageSent))
+    {
+      break; // request queue is full, try again after the next loop()
+    }
+    bot.ackMessage();
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println();
+  pinMode(ledPin, OUTPUT);
+
+  // attempt to connect to Wifi network:
+  Serial.print("Connecting to Wifi SSID ");
+  Serial.print(WIFI_SSID);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  secured_client.setTrustAnchors(&cert); // Add root certificate for api.telegram.org
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print("\nWiFi connected. IP address: ");
+  Serial.println(WiFi.localIP());
+
+  Serial.print("Retrieving time: ");
+  configTime(0, 0, "pool.ntp.org"); // get UTC time via NTP
+  time_t now = time(nullptr);
+  while (now < 24 * 3600)
+  {
+    Serial.print(".");
+    delay(100);
+    now = time(nullptr);
+  }
+  Serial.println(now);
+
+  bot.longPoll = 30;
+}
+
+void loop()
+{
+  if (!polling)
+  {
+    polling = bot.fetchUpdatesAsync(onUpdates);
+  }
+  bot.loop();
+
+  // Keeps blinking while the bot waits for messages
+  if (millis() - lastBlink > BLINK_INTERVAL)
+  {
+    digitalWrite(ledPin, !digitalRead(ledPin));
+    lastBlink = millis();
+  }
+}
@@ -40,34 +40,23 @@ void handleNewMessages(int numNewMessages)
 
     if (text == "/get_test_photo")
     {
-      String response = bot.sendPhoto(chat_id, test_photo_url, "This photo was sent using URL");
+      bot.sendPhoto(chat_id, test_photo_url, "This photo was sent using URL");
 
-      if (bot.checkForOkResponse(response))
+      // The response has been read into lastResponse already. There are 3
+      // image sizes after Telegram has processed the photo, file_id is the
+      // one of the biggest
+      String file_id = bot.lastResponse.file_id;
+      if (bot.lastResponse.ok && file_id != "")
       {
-        DynamicJsonDocument images(1500);
-        DeserializationError error = deserializeJson(images, response);
+        bot.sendPhoto(chat_id, file_id, "This photo was sent using File ID");
 
-        // There are 3 image sizes after Telegram has process photo
-        // You may choose what you want, in example was choosed bigger size
-        int photosArrayLength = images["result"]["photo"].size();
-
-        if (photosArrayLength > 0)
+        if (bot.lastResponse.ok)
+        {
+          // do something
+        }
+        else
         {
-          String file_id = images["result"]["photo"][photosArrayLength - 1]["file_id"];
-
-          if (file_id)
-          {
-            String send_photo_by_file_id_response = bot.sendPhoto(chat_id, file_id, "This photo was sent using File ID");
-
-            if (bot.checkForOkResponse(send_photo_by_file_id_response))
-            {
-              // do something
-            }
-            else
-            {
-              // or not to do
-            }
-          }
+          // or not to do
         }
       }
     }
@@ -15,37 +15,40 @@ X509List cert(TELEGRAM_CERTIFICATE_ROOT);
 WiFiClientSecure secured_client;
 UniversalTelegramBot bot(BOT_TOKEN, secured_client);
 
-void handleNewMessages(int numNewMessages)
+void onHelp(UniversalTelegramBot &bot, telegramMessage &msg, const char *args)
 {
-  Serial.print("handleNewMessages ");
-  Serial.println(numNewMessages);
-  
-  String answer;
-  for (int i = 0; i < numNewMessages; i++)
-  {
-    telegramMessage &msg = bot.messages[i];
-    Serial.println("Received " + msg.text);
-    if (msg.text == "/help")
-      answer = "So you need _help_, uh? me too! use /start or /status";
-    else if (msg.text == "/start")
-      answer = "Welcome my new friend! You are the first *" + msg.from_name + "* I've ever met";
-    else if (msg.text == "/status")
-      answer = "All is good here, thanks for asking!";
-    else
-      answer = "Say what?";
-
-    bot.sendMessage(msg.chat_id, answer, "Markdown");
-  }
+  bot.sendMessage(msg.chat_id, "So you need _help_, uh? me too! use /start or /status", "Markdown");
+}
+
+void onStart(UniversalTelegramBot &bot, telegramMessage &msg, const char *args)
+{
+  bot.sendMessage(msg.chat_id, "Welcome my new friend! You are the first *" + msg.from_name + "* I've ever met", "Markdown");
+}
+
+void onStatus(UniversalTelegramBot &bot, telegramMessage &msg, const char *args)
+{
+  bot.sendMessage(msg.chat_id, "All is good here, thanks for asking!", "Markdown");
+}
+
+void onOther(UniversalTelegramBot &bot, telegramMessage &msg, const char *args)
+{
+  Serial.println("Received " + msg.text);
+  bot.sendMessage(msg.chat_id, "Say what?", "Markdown");
 }
 
+// The commands the bot answers, the same table fills the bot menu
+const TelegramCommand commands[] PROGMEM = {
+  TELEGRAM_COMMAND("help", "Get bot usage help", onHelp),
+  TELEGRAM_COMMAND("start", "Message sent when you open a chat with a bot", onStart),
+  TELEGRAM_COMMAND("status", "Answer device current status", onStatus),
+};
+TelegramCommandRouter router(commands);
+
 void bot_setup()
 {
-  const String commands = F("["
-                            "{\"command\":\"help\",  \"description\":\"Get bot usage help\"},"
-                            "{\"command\":\"start\", \"description\":\"Message sent when you open a chat with a bot\"},"
-                            "{\"command\":\"status\",\"description\":\"Answer device current status\"}" // no comma on last command
-                            "]");
-  bot.setMyCommands(commands);
+  router.fallback = onOther;
+  bot.getMe(); // "/status@botname" is only answered once the bot knows its name
+  bot.setMyCommands(router);
   //bot.sendMessage("25235518", "Hola amigo!", "Markdown");
 }
 
@@ -91,7 +94,7 @@ void loop()
     while (numNewMessages)
     {
       Serial.println("got response");
-      handleNewMessages(numNewMessages);
+      router.dispatch(bot, numNewMessages);
       numNewMessages = bot.getUpdates(bot.last_message_received + 1);
     }
 
@@ -0,0 +1,107 @@
+/*******************************************************************
+    A telegram bot for your ESP8266 that echoes messages back,
+    fetching up to 10 updates per request into the bot's queue.
+
+    Messages are only confirmed to Telegram after they have been
+    acknowledged, so anything not handled before a reset is
+    delivered again. Where the bot is kept in EEPROM, so after a
+    reset it carries on without a getMe() and without handling a
+    message twice.
+
+    Parts:
+    D1 Mini ESP8266 * - http://s.click.aliexpress.com/e/uzFUnIe
+    (or any ESP8266 board)
+
+      = Affilate
+
+    If you find what I do useful and would like to support me,
+    please consider becoming a sponsor on Github
+    https://github.com/sponsors/witnessmenow/
+
+
+    Written by Brian Lough
+    YouTube: https://www.youtube.com/brianlough
+    Tindie: https://www.tindie.com/stores/brianlough/
+    Twitter: https://twitter.com/witnessmenow
+ *******************************************************************/
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <UniversalTelegramBot.h>
+#include <EEPROM.h>
+
+// Wifi network station credentials
+#define WIFI_SSID "YOUR_SSID"
+#define WIFI_PASSWORD "YOUR_PASSWORD"
+// Telegram BOT Token (Get from Botfather)
+#define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
+
+// Number of updates fetched per request
+#define QUEUE_SIZE 10
+
+const unsigned long BOT_MTBS = 1000; // mean time between scan messages
+
+X509List cert(TELEGRAM_CERTIFICATE_ROOT);
+WiFiClientSecure secured_client;
+UniversalTelegramBot bot(BOT_TOKEN, secured_client, QUEUE_SIZE);
+unsigned long bot_lasttime; // last time messages' scan has been done
+TelegramEepromStateStore botState(0);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println();
+
+  // attempt to connect to Wifi network:
+  Serial.print("Connecting to Wifi SSID ");
+  Serial.print(WIFI_SSID);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  secured_client.setTrustAnchors(&cert); // Add root certificate for api.telegram.org
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print("\nWiFi connected. IP address: ");
+  Serial.println(WiFi.localIP());
+
+  Serial.print("Retrieving time: ");
+  configTime(0, 0, "pool.ntp.org"); // get UTC time via NTP
+  time_t now = time(nullptr);
+  while (now < 24 * 3600)
+  {
+    Serial.print(".");
+    delay(100);
+    now = time(nullptr);
+  }
+  Serial.println(now);
+
+  EEPROM.begin(sizeof(TelegramBotState));
+  bot.stateStore = &botState;
+  if (!bot.restoreState())
+  {
+    bot.getMe();
+  }
+  Serial.print("Bot: @");
+  Serial.println(bot.userName);
+}
+
+void loop()
+{
+  if (millis() - bot_lasttime > BOT_MTBS)
+  {
+    bot.fetchUpdates();
+    bot_lasttime = millis();
+  }
+
+  // Handle one message per loop, leaving time for everything else
+  telegramMessage *message = bot.nextMessage();
+  if (message != nullptr)
+  {
+    if (bot.sendMessage(message->chat_id, message->text, ""))
+    {
+      bot.ackMessage();
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*******************************************************************
+    A telegram bot for your ESP8266 that echoes messages back,
+    with Telegram pushing the messages to it through a webhook
+    instead of the bot polling for them.
+
+    Telegram only delivers webhooks over HTTPS, on port 443, 80, 88
+    or 8443. Run a reverse proxy or tunnel that terminates TLS and
+    forwards the requests to WEBHOOK_PORT on this board, and set
+    WEBHOOK_URL to its public address.
+
+    Parts:
+    D1 Mini ESP8266 * - http://s.click.aliexpress.com/e/uzFUnIe
+    (or any ESP8266 board)
+
+      = Affilate
+
+    If you find what I do useful and would like to support me,
+    please consider becoming a sponsor on Github
+    https://github.com/sponsors/witnessmenow/
+
+
+    Written by Brian Lough
+    YouTube: https://www.youtube.com/brianlough
+    Tindie: https://www.tindie.com/stores/brianlough/
+    Twitter: https://twitter.com/witnessmenow
+ *******************************************************************/
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <UniversalTelegramBot.h>
+
+// Wifi network station credentials
+#define WIFI_SSID "YOUR_SSID"
+#define WIFI_PASSWORD "YOUR_PASSWORD"
+// Telegram BOT Token (Get from Botfather)
+#define BOT_TOKEN "XXXXXXXXX:XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX"
+
+// Public HTTPS address forwarded to this board
+#define WEBHOOK_URL "https://example.com/telegram"
+// Sent by Telegram with every update, make up your own
+#define WEBHOOK_SECRET "ChangeThisToSomethingRandom"
+const uint16_t WEBHOOK_PORT = 8080;
+
+X509List cert(TELEGRAM_CERTIFICATE_ROOT);
+WiFiClientSecure secured_client;
+UniversalTelegramBot bot(BOT_TOKEN, secured_client, 5);
+WiFiServer server(WEBHOOK_PORT);
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println();
+
+  // attempt to connect to Wifi network:
+  Serial.print("Connecting to Wifi SSID ");
+  Serial.print(WIFI_SSID);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  secured_client.setTrustAnchors(&cert); // Add root certificate for api.telegram.org
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print("\nWiFi connected. IP address: ");
+  Serial.println(WiFi.localIP());
+
+  Serial.print("Retrieving time: ");
+  configTime(0, 0, "pool.ntp.org"); // get UTC time via NTP
+  time_t now = time(nullptr);
+  while (now < 24 * 3600)
+  {
+    Serial.print(".");
+    delay(100);
+    now = time(nullptr);
+  }
+  Serial.println(now);
+
+  // Updates are only served once Telegram knows the secret to send
+  while (!bot.setWebhook(WEBHOOK_URL, WEBHOOK_SECRET))
+  {
+    Serial.println("Setting the webhook failed, retrying in 10 seconds");
+    delay(10000);
+  }
+  Serial.println("Webhook set");
+  server.begin();
+}
+
+void loop()
+{
+  WiFiClient connection = server.available();
+  if (connection)
+  {
+    bot.handleWebhook(connection);
+  }
+
+  telegramMessage *message = bot.nextMessage();
+  if (message != nullptr)
+  {
+    if (bot.sendMessage(message->chat_id, message->text, ""))
+    {
+      bot.ackMessage();
+    }
+  }
+}
@@ -6,7 +6,7 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <UniversalTelegramBot.h>
-#include <HTTPUpdate.h>
+#include <Update.h>
 #include <SD.h>
 #include <FS.h>
 #include <SPIFFS.h>
@@ -23,6 +23,33 @@ WiFiClientSecure secured_client;
 UniversalTelegramBot bot(BOT_TOKEN, secured_client);
 unsigned long bot_lasttime; // last time messages' scan has been done
 
+// Passes a download on to the Update library
+class UpdateWriter : public Print
+{
+public:
+  size_t write(uint8_t c) { return Update.write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) { return Update.write((uint8_t *)buffer, size); }
+};
+
+void downloadProgress(size_t received, size_t total, unsigned long elapsed)
+{
+  Serial.print("%");
+  Serial.println(total ? received * 100 / total : 0);
+}
+
+bool updateFrom(const telegramMessage &message, int command)
+{
+  if (!Update.begin(message.file_size, command))
+    return false;
+  UpdateWriter writer;
+  if (!bot.downloadFile(message.file_id, writer, message.file_unique_id))
+  {
+    Update.abort();
+    return false;
+  }
+  return Update.end();
+}
+
 void handleNewMessages(int numNewMessages)
 {
   for (int i = 0; i < numNewMessages; i++)
@@ -31,57 +58,28 @@ void handleNewMessages(int numNewMessages)
     {
       if (bot.messages[i].hasDocument == true)
       {
-        httpUpdate.rebootOnUpdate(false);
-        t_httpUpdate_return ret = (t_httpUpdate_return)3;
         if (bot.messages[i].file_caption == "write spiffs")
         {
           size_t spiffsFreeSize = SPIFFS.totalBytes() - SPIFFS.usedBytes();
           if (bot.messages[i].file_size < spiffsFreeSize)
           {
             bot.sendMessage(bot.messages[i].chat_id, "File downloading.", "");
-            HTTPClient http;
-            if (http.begin(secured_client, bot.messages[i].file_path))
+            if (SPIFFS.exists("/" + bot.messages[i].file_name))
+              SPIFFS.remove(("/" + bot.messages[i].file_name));
+            File fl = SPIFFS.open("/" + bot.messages[i].file_name, FILE_WRITE);
+            if (!fl)
+            {
+              bot.sendMessage(bot.messages[i].chat_id, "File open error.", "");
+            }
+            else
             {
-              int code = http.GET();
-              if (code == HTTP_CODE_OK)
-              {
-                int total = http.getSize();
-                int len = total;
-                uint8_t buff[128] = {0};
-                WiFiClient *tcp = http.getStreamPtr();
-                if (SPIFFS.exists("/" + bot.messages[i].file_name))
-                  SPIFFS.remove(("/" + bot.messages[i].file_name));
-                File fl = SPIFFS.open("/" + bot.messages[i].file_name, FILE_WRITE);
-                if (!fl)
-                {
-                  bot.sendMessage(bot.messages[i].chat_id, "File open error.", "");
-                }
-                else
-                {
-                  while (http.connected() && (len > 0 || len == -1))
-                  {
-                    size_t size_available = tcp->available();
-                    Serial.print("%");
-                    Serial.println(100 - ((len * 100) / total));
-                    if (size_available)
-                    {
-                      int c = tcp->readBytes(buff, ((size_available > sizeof(buff)) ? sizeof(buff) : size_available));
-                      fl.write(buff, c);
-                      if (len > 0)
-                      {
-                        len -= c;
-                      }
-                    }
-                    delay(1);
-                  }
-                  fl.close();
-                  if (len == 0)
-                    bot.sendMessage(bot.messages[i].chat_id, "Success.", "");
-                  else
-                    bot.sendMessage(bot.messages[i].chat_id, "Error.", "");
-                }
-              }
-              http.end();
+              // Streamed straight into the file, resumed if the connection drops
+              bool ok = bot.downloadFile(bot.messages[i].file_id, fl, bot.messages[i].file_unique_id);
+              fl.close();
+              if (ok)
+                bot.sendMessage(bot.messages[i].chat_id, "Success.", "");
+              else
+                bot.sendMessage(bot.messages[i].chat_id, "Error (" + String(bot._lastError) + ").", "");
             }
           }
           else
@@ -89,35 +87,20 @@ void handleNewMessages(int numNewMessages)
             bot.sendMessage(bot.messages[i].chat_id, "SPIFFS size to low (" + String(spiffsFreeSize) + ") needed: " + String(bot.messages[i].file_size), "");
           }
         }
-        else
+        else if (bot.messages[i].file_caption == "update firmware" ||
+                 bot.messages[i].file_caption == "update spiffs")
         {
-          if (bot.messages[i].file_caption == "update firmware")
-          {
-            bot.sendMessage(bot.messages[i].chat_id, "Firmware writing...", "");
-            ret = httpUpdate.update(secured_client, bot.messages[i].file_path);
-          }
-          if (bot.messages[i].file_caption == "update spiffs")
+          bool firmware = bot.messages[i].file_caption == "update firmware";
+          bot.sendMessage(bot.messages[i].chat_id, firmware ? "Firmware writing..." : "SPIFFS writing...", "");
+          if (updateFrom(bot.messages[i], firmware ? U_FLASH : U_SPIFFS))
           {
-            bot.sendMessage(bot.messages[i].chat_id, "SPIFFS writing...", "");
-            ret = httpUpdate.updateSpiffs(secured_client, bot.messages[i].file_path);
-          }
-          switch (ret)
-          {
-          case HTTP_UPDATE_FAILED:
-            bot.sendMessage(bot.messages[i].chat_id, "HTTP_UPDATE_FAILED Error (" + String(httpUpdate.getLastError()) + "): " + httpUpdate.getLastErrorString(), "");
-            break;
-
-          case HTTP_UPDATE_NO_UPDATES:
-            bot.sendMessage(bot.messages[i].chat_id, "HTTP_UPDATE_NO_UPDATES", "");
-            break;
-
-          case HTTP_UPDATE_OK:
             bot.sendMessage(bot.messages[i].chat_id, "UPDATE OK.\nRestarting...", "");
             numNewMessages = bot.getUpdates(bot.last_message_received + 1);
             ESP.restart();
-            break;
-          default:
-            break;
+          }
+          else
+          {
+            bot.sendMessage(bot.messages[i].chat_id, "UPDATE FAILED Error (" + String(Update.getError()) + "): " + Update.errorString(), "");
           }
         }
       }
@@ -178,6 +161,8 @@ void setup()
     now = time(nullptr);
   }
   Serial.println(now);
+
+  bot.downloadProgress = downloadProgress;
 }
 
 void loop()
@@ -0,0 +1,133 @@
+// Times the main API calls against the replay server and reports, per call,
+// the latency, requests per second, bytes on the wire, heap allocations,
+// bytes copied into the heap and the peak heap. The calls are the ones of the
+// Benchmark example, so host and board figures can be put side by side
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostHeap.h"
+#include "ReplayServer.h"
+
+#ifndef SESSIONS_DIR
+#define SESSIONS_DIR "sessions"
+#endif
+
+static HostClient client;
+static UniversalTelegramBot bot("123456:benchmark-token", client);
+
+struct Result {
+  unsigned long total = 0;
+  unsigned long fastest = (unsigned long)-1;
+  unsigned long slowest = 0;
+  int failed = 0;
+  unsigned long allocations = 0;
+  unsigned long long allocatedBytes = 0;
+  size_t peak = 0;
+  unsigned long sent = 0;
+  unsigned long received = 0;
+};
+
+static int failures = 0;
+
+static void printResult(const char *name, const Result &r, int runs) {
+  printf("%-24s %9.1f %9.1f %9.1f %9.0f %8lu %8lu %8.1f %10.0f %9u %6d\n", name, r.total / (double)runs,
+         r.fastest / 1.0, r.slowest / 1.0, r.total > 0 ? runs * 1e6 / r.total : 0.0, r.sent / runs,
+         r.received / runs, r.allocations / (double)runs, r.allocatedBytes / (double)runs, (unsigned)r.peak,
+         r.failed);
+  failures += r.failed;
+}
+
+// Makes the call runs times, call returns false if the request failed
+static void benchmark(const char *name, bool (*call)(), int runs) {
+  Result r;
+  // One call outside the figures, so lazily allocated buffers are in place
+  call();
+  unsigned long sent = client.bytesSent;
+  unsigned long received = client.bytesReceived;
+
+  for (int i = 0; i < runs; i++) {
+    HostHeapSample heap;
+    unsigned long start = micros();
+    if (!call()) r.failed++;
+    unsigned long elapsed = micros() - start;
+
+    r.total += elapsed;
+    if (elapsed < r.fastest) r.fastest = elapsed;
+    if (elapsed > r.slowest) r.slowest = elapsed;
+    r.allocations += heap.allocations();
+    r.allocatedBytes += heap.allocatedBytes();
+    if (heap.peak() > r.peak) r.peak = heap.peak();
+  }
+  r.sent = client.bytesSent - sent;
+  r.received = client.bytesReceived - received;
+  printResult(name, r, runs);
+}
+
+static bool callGetMe() {
+  return bot.getMe();
+}
+
+static bool callSendMessage() {
+  return bot.sendMessage("123456789", "Benchmark message", "");
+}
+
+static bool callGetUpdates() {
+  return bot.getUpdates(bot.last_message_received + 1) > 0 && bot._lastError == TELEGRAM_ERROR_NONE;
+}
+
+static bool callFetchUpdates() {
+  bot.fetchUpdates();
+  // The recorded updates repeat, go back so they count as new again
+  bool received = bot.nextMessage() != nullptr;
+  while (bot.nextMessage() != nullptr) bot.ackMessage();
+  bot.last_message_received = 0;
+  bot.last_message_acked = 0;
+  return received && bot._lastError == TELEGRAM_ERROR_NONE;
+}
+
+static bool callGetCompactUpdates() {
+  return bot.getCompactUpdates(bot.last_message_received + 1) > 0 && bot._lastError == TELEGRAM_ERROR_NONE;
+}
+
+int main(int argc, char **argv) {
+  int runs = argc > 1 ? atoi(argv[1]) : 200;
+  if (runs <= 0) runs = 1;
+
+  ReplayServer server;
+  if (!server.load(SESSIONS_DIR "/benchmark.txt") || !server.start()) {
+    fprintf(stderr, "cannot start the replay server\n");
+    return 1;
+  }
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  // JSON slots on a 64 bit host are about twice the size of an ESP's, and
+  // the recorded getUpdates answer holds four updates
+  bot.maxMessageLength = 16384;
+
+  // Only what the bot allocates on this thread is counted
+  HostHeap::track(true);
+
+  printf("%d runs per call\n", runs);
+  printf("%-24s %9s %9s %9s %9s %8s %8s %8s %10s %9s %6s\n", "call", "avg us", "min us", "max us", "calls/s",
+         "tx B", "rx B", "allocs", "heap B", "peak B", "failed");
+  benchmark("getMe", callGetMe, runs);
+  benchmark("sendMessage", callSendMessage, runs);
+  benchmark("getUpdates", callGetUpdates, runs);
+  bot.streamUpdates = true;
+  benchmark("getUpdates (streamed)", callGetUpdates, runs);
+  bot.streamUpdates = false;
+  benchmark("fetchUpdates", callFetchUpdates, runs);
+  benchmark("getCompactUpdates", callGetCompactUpdates, runs);
+  bot.keepAlive = false;
+  benchmark("getMe (no keep-alive)", callGetMe, runs);
+  printf("%lu connections for %u requests, the bot holds %u heap bytes\n", client.connects,
+         (unsigned)server.requestCount(), (unsigned)HostHeap::inUse());
+
+  HostHeap::track(false);
+  server.stop();
+  return failures > 0 ? 1 : 0;
+}
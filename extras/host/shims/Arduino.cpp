@@ -0,0 +1,60 @@
+#include "Arduino.h"
+
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+static unsigned long long monotonicMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+// Both clocks start near zero and wrap like on a board
+static const unsigned long long bootMicros = monotonicMicros();
+
+unsigned long millis() {
+  return (unsigned long)((monotonicMicros() - bootMicros) / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)(monotonicMicros() - bootMicros);
+}
+
+void delay(unsigned long ms) {
+  struct timespec wait = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+  while (nanosleep(&wait, &wait) != 0) {
+  }
+}
+
+void yield() {
+  sched_yield();
+}
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) srandom(seed);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
@@ -0,0 +1,115 @@
+#include "Arduino.h"
+
+#include <stdarg.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) n++;
+    else break;
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const String &s) {
+  return write(s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[]) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+  return print((long long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long long n, int base) {
+  if (base == 10 && n < 0) return printNumber(0ULL - (unsigned long long)n, true, base);
+  return printNumber((unsigned long long)n, false, base);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+  return printNumber(n, false, base);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[64];
+  if (isnan(n)) return print("nan");
+  if (isinf(n)) return print("inf");
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return print(buf);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *str) { return print(str) + println(); }
+size_t Print::println(const String &s) { return print(s) + println(); }
+size_t Print::println(const char str[]) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(long long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+size_t Print::printf(const char *format, ...) {
+  char buf[128];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(buf)) return write((const uint8_t *)buf, len);
+
+  char *big = (char *)malloc(len + 1);
+  if (!big) return 0;
+  va_start(args, format);
+  vsnprintf(big, len + 1, format, args);
+  va_end(args);
+  size_t n = write((const uint8_t *)big, len);
+  free(big);
+  return n;
+}
+
+size_t Print::printNumber(unsigned long long n, bool negative, int base) {
+  char buf[66];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  if (negative) *--str = '-';
+  return write(str);
+}
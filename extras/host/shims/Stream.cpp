@@ -0,0 +1,116 @@
+#include "Arduino.h"
+
+int Stream::timedRead() {
+  _startMillis = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - _startMillis < _timeout);
+  return -1;
+}
+
+int Stream::timedPeek() {
+  _startMillis = millis();
+  do {
+    int c = peek();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - _startMillis < _timeout);
+  return -1;
+}
+
+bool Stream::find(const char *target) {
+  return findUntil(target, nullptr);
+}
+
+bool Stream::find(const char *target, size_t length) {
+  size_t index = 0;
+  if (length == 0) return true;
+  int c;
+  while ((c = timedRead()) >= 0) {
+    if (c == target[index]) {
+      if (++index >= length) return true;
+    } else {
+      index = c == target[0] ? 1 : 0;
+    }
+  }
+  return false;
+}
+
+bool Stream::findUntil(const char *target, const char *terminator) {
+  size_t targetLen = strlen(target);
+  size_t termLen = terminator ? strlen(terminator) : 0;
+  size_t index = 0, termIndex = 0;
+  if (targetLen == 0) return true;
+  int c;
+  while ((c = timedRead()) >= 0) {
+    if (c == target[index]) {
+      if (++index >= targetLen) return true;
+    } else {
+      index = c == target[0] ? 1 : 0;
+    }
+    if (termLen > 0 && c == terminator[termIndex]) {
+      if (++termIndex >= termLen) return false;
+    } else {
+      termIndex = 0;
+    }
+  }
+  return false;
+}
+
+long Stream::parseInt() {
+  int c;
+  do {
+    c = timedPeek();
+    if (c < 0) return 0;
+    if (c == '-' || (c >= '0' && c <= '9')) break;
+    read();
+  } while (true);
+
+  bool negative = false;
+  long value = 0;
+  do {
+    if (c == '-') negative = true;
+    else value = value * 10 + c - '0';
+    read();
+    c = timedPeek();
+  } while (c >= '0' && c <= '9');
+  return negative ? -value : value;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t index = 0;
+  while (index < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    *buffer++ = (char)c;
+    index++;
+  }
+  return index;
+}
+
+String Stream::readString() {
+  String ret;
+  int c;
+  while ((c = timedRead()) >= 0) ret += (char)c;
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator) ret += (char)c;
+  return ret;
+}
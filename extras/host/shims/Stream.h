@@ -0,0 +1,40 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  bool find(const char *target);
+  bool find(const char *target, size_t length);
+  bool findUntil(const char *target, const char *terminator);
+
+  long parseInt();
+
+  virtual size_t readBytes(char *buffer, size_t length);
+  virtual size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) {
+    return readBytesUntil(terminator, (char *)buffer, length);
+  }
+
+  String readString();
+  String readStringUntil(char terminator);
+
+protected:
+  // Wait up to the timeout for a byte, -1 if none came
+  int timedRead();
+  int timedPeek();
+
+  unsigned long _timeout = 1000;
+  unsigned long _startMillis = 0;
+};
+
+#endif
@@ -0,0 +1,451 @@
+#include "Arduino.h"
+
+#include <ctype.h>
+
+static void formatInteger(char *buf, unsigned long long value, bool negative, unsigned char base) {
+  char digits[66];
+  int n = 0;
+  if (base < 2 || base > 36) base = 10;
+  do {
+    unsigned d = value % base;
+    digits[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= base;
+  } while (value);
+  if (negative) *buf++ = '-';
+  while (n) *buf++ = digits[--n];
+  *buf = '\0';
+}
+
+static void formatSigned(char *buf, long long value, unsigned char base) {
+  // Only base 10 prints a sign, other bases show the two's complement
+  if (base == 10 && value < 0)
+    formatInteger(buf, 0ULL - (unsigned long long)value, true, base);
+  else
+    formatInteger(buf, (unsigned long long)value, false, base);
+}
+
+String::String(const char *cstr) {
+  if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const char *cstr, unsigned int length) {
+  if (cstr) copy(cstr, length);
+}
+
+String::String(const String &value) {
+  *this = value;
+}
+
+String::String(const __FlashStringHelper *pstr) {
+  *this = pstr;
+}
+
+String::String(String &&rval) {
+  move(rval);
+}
+
+String::String(char c) {
+  char buf[2] = {c, '\0'};
+  *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base) {
+  char buf[66];
+  formatInteger(buf, value, false, base);
+  *this = buf;
+}
+
+String::String(int value, unsigned char base) {
+  char buf[67];
+  if (base == 10) formatSigned(buf, value, base);
+  else formatInteger(buf, (unsigned int)value, false, base);
+  *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base) {
+  char buf[66];
+  formatInteger(buf, value, false, base);
+  *this = buf;
+}
+
+String::String(long value, unsigned char base) {
+  char buf[67];
+  if (base == 10) formatSigned(buf, value, base);
+  else formatInteger(buf, (unsigned long)value, false, base);
+  *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base) {
+  char buf[66];
+  formatInteger(buf, value, false, base);
+  *this = buf;
+}
+
+String::String(long long value, unsigned char base) {
+  char buf[67];
+  formatSigned(buf, value, base);
+  *this = buf;
+}
+
+String::String(unsigned long long value, unsigned char base) {
+  char buf[66];
+  formatInteger(buf, value, false, base);
+  *this = buf;
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, (double)value);
+  *this = buf;
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  *this = buf;
+}
+
+String::~String() {
+  free(_buffer);
+}
+
+void String::invalidate() {
+  free(_buffer);
+  _buffer = nullptr;
+  _capacity = _len = 0;
+}
+
+unsigned char String::reserve(unsigned int size) {
+  if (_buffer && _capacity >= size) return 1;
+  if (changeBuffer(size)) {
+    if (_len == 0) _buffer[0] = '\0';
+    return 1;
+  }
+  return 0;
+}
+
+unsigned char String::changeBuffer(unsigned int maxStrLen) {
+  char *newbuffer = (char *)realloc(_buffer, maxStrLen + 1);
+  if (newbuffer) {
+    _buffer = newbuffer;
+    _capacity = maxStrLen;
+    return 1;
+  }
+  return 0;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+  if (!reserve(length)) {
+    invalidate();
+    return *this;
+  }
+  _len = length;
+  memmove(_buffer, cstr, length);
+  _buffer[length] = '\0';
+  return *this;
+}
+
+void String::move(String &rhs) {
+  if (this == &rhs) return;
+  free(_buffer);
+  _buffer = rhs._buffer;
+  _capacity = rhs._capacity;
+  _len = rhs._len;
+  rhs._buffer = nullptr;
+  rhs._capacity = rhs._len = 0;
+}
+
+String &String::operator=(const String &rhs) {
+  if (this == &rhs) return *this;
+  if (rhs._buffer) copy(rhs._buffer, rhs._len);
+  else invalidate();
+  return *this;
+}
+
+String &String::operator=(String &&rval) {
+  move(rval);
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  if (cstr) copy(cstr, strlen(cstr));
+  else invalidate();
+  return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *pstr) {
+  return *this = reinterpret_cast<const char *>(pstr);
+}
+
+unsigned char String::concat(const String &s) {
+  return concat(s.c_str(), s._len);
+}
+
+unsigned char String::concat(const char *cstr, unsigned int length) {
+  unsigned int newlen = _len + length;
+  if (!cstr) return 0;
+  if (length == 0) return 1;
+  if (!reserve(newlen)) return 0;
+  memmove(_buffer + _len, cstr, length);
+  _len = newlen;
+  _buffer[_len] = '\0';
+  return 1;
+}
+
+unsigned char String::concat(const char *cstr) {
+  if (!cstr) return 0;
+  return concat(cstr, strlen(cstr));
+}
+
+unsigned char String::concat(const __FlashStringHelper *str) {
+  return concat(reinterpret_cast<const char *>(str));
+}
+
+unsigned char String::concat(char c) {
+  return concat(&c, 1);
+}
+
+unsigned char String::concat(unsigned char num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(int num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(unsigned int num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(long num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(unsigned long num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(long long num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(unsigned long long num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(float num) {
+  return concat(String(num));
+}
+
+unsigned char String::concat(double num) {
+  return concat(String(num));
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const String &rhs) {
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(rhs)) a.invalidate();
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const char *cstr) {
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!cstr || !a.concat(cstr)) a.invalidate();
+  return a;
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, const __FlashStringHelper *rhs) {
+  return lhs + reinterpret_cast<const char *>(rhs);
+}
+
+StringSumHelper &operator+(const StringSumHelper &lhs, char c) {
+  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
+  if (!a.concat(c)) a.invalidate();
+  return a;
+}
+
+#define STRING_SUM_NUMBER(T)                                              \
+  StringSumHelper &operator+(const StringSumHelper &lhs, T num) {          \
+    StringSumHelper &a = const_cast<StringSumHelper &>(lhs);               \
+    if (!a.concat(num)) a.invalidate();                                    \
+    return a;                                                              \
+  }
+
+STRING_SUM_NUMBER(int)
+STRING_SUM_NUMBER(unsigned int)
+STRING_SUM_NUMBER(long)
+STRING_SUM_NUMBER(unsigned long)
+STRING_SUM_NUMBER(long long)
+STRING_SUM_NUMBER(unsigned long long)
+STRING_SUM_NUMBER(double)
+
+int String::compareTo(const String &s) const {
+  return strcmp(c_str(), s.c_str());
+}
+
+unsigned char String::equals(const String &s) const {
+  return _len == s._len && compareTo(s) == 0;
+}
+
+unsigned char String::equals(const char *cstr) const {
+  return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+unsigned char String::equalsIgnoreCase(const String &s) const {
+  return _len == s._len && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+unsigned char String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+unsigned char String::startsWith(const String &prefix, unsigned int offset) const {
+  if (offset > _len || prefix._len > _len - offset) return 0;
+  return strncmp(c_str() + offset, prefix.c_str(), prefix._len) == 0;
+}
+
+unsigned char String::endsWith(const String &suffix) const {
+  if (suffix._len > _len) return 0;
+  return strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+  if (index < _len) _buffer[index] = c;
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy_writable_char;
+  if (index >= _len || !_buffer) {
+    dummy_writable_char = 0;
+    return dummy_writable_char;
+  }
+  return _buffer[index];
+}
+
+char String::operator[](unsigned int index) const {
+  if (index >= _len || !_buffer) return 0;
+  return _buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+  if (!bufsize || !buf) return;
+  if (index >= _len) {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = bufsize - 1;
+  if (n > _len - index) n = _len - index;
+  memcpy(buf, _buffer + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+  if (fromIndex >= _len) return -1;
+  const char *temp = strchr(_buffer + fromIndex, c);
+  return temp ? temp - _buffer : -1;
+}
+
+int String::indexOf(const String &s, unsigned int fromIndex) const {
+  if (fromIndex >= _len) return -1;
+  const char *found = strstr(_buffer + fromIndex, s.c_str());
+  return found ? found - _buffer : -1;
+}
+
+int String::lastIndexOf(char c) const {
+  return _len ? lastIndexOf(c, _len - 1) : -1;
+}
+
+int String::lastIndexOf(char c, unsigned int fromIndex) const {
+  if (fromIndex >= _len) return -1;
+  for (int i = fromIndex; i >= 0; i--)
+    if (_buffer[i] == c) return i;
+  return -1;
+}
+
+int String::lastIndexOf(const String &s) const {
+  return s._len > _len ? -1 : lastIndexOf(s, _len - s._len);
+}
+
+int String::lastIndexOf(const String &s, unsigned int fromIndex) const {
+  if (s._len == 0 || _len == 0 || s._len > _len) return -1;
+  if (fromIndex >= _len) fromIndex = _len - 1;
+  int found = -1;
+  for (const char *p = _buffer; p <= _buffer + fromIndex; p++) {
+    p = strstr(p, s.c_str());
+    if (!p) break;
+    if ((unsigned int)(p - _buffer) <= fromIndex) found = p - _buffer;
+  }
+  return found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+  if (left > right) std::swap(left, right);
+  if (left >= _len) return String();
+  if (right > _len) right = _len;
+  return String(_buffer + left, right - left);
+}
+
+void String::replace(char find, char replace) {
+  for (char *p = begin(); p && *p; p++)
+    if (*p == find) *p = replace;
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (_len == 0 || find._len == 0) return;
+  String result;
+  const char *p = c_str();
+  const char *found;
+  while ((found = strstr(p, find.c_str())) != nullptr) {
+    result.concat(p, found - p);
+    result.concat(replace);
+    p = found + find._len;
+  }
+  result.concat(p);
+  *this = static_cast<String &&>(result);
+}
+
+void String::remove(unsigned int index) {
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= _len || count == 0) return;
+  if (count > _len - index) count = _len - index;
+  memmove(_buffer + index, _buffer + index + count, _len - index - count);
+  _len -= count;
+  _buffer[_len] = 0;
+}
+
+void String::toLowerCase() {
+  for (char *p = begin(); p && *p; p++) *p = tolower((unsigned char)*p);
+}
+
+void String::toUpperCase() {
+  for (char *p = begin(); p && *p; p++) *p = toupper((unsigned char)*p);
+}
+
+void String::trim() {
+  if (!_buffer || _len == 0) return;
+  char *begin = _buffer;
+  while (isspace((unsigned char)*begin)) begin++;
+  char *end = _buffer + _len - 1;
+  while (end >= begin && isspace((unsigned char)*end)) end--;
+  _len = end + 1 - begin;
+  if (begin > _buffer) memmove(_buffer, begin, _len);
+  _buffer[_len] = 0;
+}
+
+long String::toInt() const {
+  return _buffer ? atol(_buffer) : 0;
+}
+
+float String::toFloat() const {
+  return _buffer ? (float)atof(_buffer) : 0;
+}
+
+double String::toDouble() const {
+  return _buffer ? atof(_buffer) : 0;
+}
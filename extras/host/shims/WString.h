@@ -0,0 +1,156 @@
+#ifndef String_class_h
+#define String_class_h
+
+// Arduino String. The buffer lives on the heap and is grown with realloc to
+// the exact size asked for, like the AVR core, so heap figures taken on the
+// host follow the same allocations as on a board. The small string buffer
+// of the ESP cores is not reproduced
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+
+class StringSumHelper;
+
+class String {
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const String &str);
+  String(const __FlashStringHelper *str);
+  String(String &&rval);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  unsigned char reserve(unsigned int size);
+  unsigned int length() const { return _len; }
+  bool isEmpty() const { return _len == 0; }
+
+  String &operator=(const String &rhs);
+  String &operator=(const char *cstr);
+  String &operator=(const __FlashStringHelper *str);
+  String &operator=(String &&rval);
+
+  unsigned char concat(const String &str);
+  unsigned char concat(const char *cstr);
+  unsigned char concat(const char *cstr, unsigned int length);
+  unsigned char concat(const __FlashStringHelper *str);
+  unsigned char concat(char c);
+  unsigned char concat(unsigned char num);
+  unsigned char concat(int num);
+  unsigned char concat(unsigned int num);
+  unsigned char concat(long num);
+  unsigned char concat(unsigned long num);
+  unsigned char concat(long long num);
+  unsigned char concat(unsigned long long num);
+  unsigned char concat(float num);
+  unsigned char concat(double num);
+
+  template <typename T>
+  String &operator+=(const T &rhs) {
+    concat(rhs);
+    return *this;
+  }
+
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const String &rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const char *cstr);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const __FlashStringHelper *rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, char c);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, int num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned int num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, long long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned long long num);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, double num);
+
+  int compareTo(const String &s) const;
+  unsigned char equals(const String &s) const;
+  unsigned char equals(const char *cstr) const;
+  unsigned char equalsIgnoreCase(const String &s) const;
+  unsigned char operator==(const String &rhs) const { return equals(rhs); }
+  unsigned char operator==(const char *cstr) const { return equals(cstr); }
+  unsigned char operator!=(const String &rhs) const { return !equals(rhs); }
+  unsigned char operator!=(const char *cstr) const { return !equals(cstr); }
+  unsigned char operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+  unsigned char operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+  unsigned char operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+  unsigned char operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+  unsigned char startsWith(const String &prefix) const;
+  unsigned char startsWith(const String &prefix, unsigned int offset) const;
+  unsigned char endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+    getBytes((unsigned char *)buf, bufsize, index);
+  }
+  const char *c_str() const { return _buffer ? _buffer : ""; }
+  char *begin() { return _buffer; }
+  char *end() { return _buffer ? _buffer + _len : nullptr; }
+  const char *begin() const { return c_str(); }
+  const char *end() const { return c_str() + _len; }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String &str, unsigned int fromIndex = 0) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(char ch, unsigned int fromIndex) const;
+  int lastIndexOf(const String &str) const;
+  int lastIndexOf(const String &str, unsigned int fromIndex) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+protected:
+  void invalidate();
+  unsigned char changeBuffer(unsigned int maxStrLen);
+  String &copy(const char *cstr, unsigned int length);
+  void move(String &rhs);
+
+  char *_buffer = nullptr;
+  unsigned int _capacity = 0;
+  unsigned int _len = 0;
+};
+
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String &s) : String(s) {}
+  StringSumHelper(const char *p) : String(p) {}
+  StringSumHelper(char c) : String(c) {}
+  StringSumHelper(int num) : String(num) {}
+  StringSumHelper(unsigned int num) : String(num) {}
+  StringSumHelper(long num) : String(num) {}
+  StringSumHelper(unsigned long num) : String(num) {}
+  StringSumHelper(long long num) : String(num) {}
+  StringSumHelper(unsigned long long num) : String(num) {}
+  StringSumHelper(double num) : String(num) {}
+};
+
+#endif
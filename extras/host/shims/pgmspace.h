@@ -0,0 +1,31 @@
+#ifndef pgmspace_h
+#define pgmspace_h
+
+// There is a single address space on Linux, so flash is plain memory
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+
+inline size_t strlen_P(const char *s) { return strlen(s); }
+inline int strcmp_P(const char *a, const char *b) { return strcmp(a, b); }
+inline int strncmp_P(const char *a, const char *b, size_t n) { return strncmp(a, b, n); }
+inline int strcasecmp_P(const char *a, const char *b) { return strcasecmp(a, b); }
+inline int strncasecmp_P(const char *a, const char *b, size_t n) { return strncasecmp(a, b, n); }
+inline int memcmp_P(const void *a, const void *b, size_t n) { return memcmp(a, b, n); }
+inline void *memcpy_P(void *dst, const void *src, size_t n) { return memcpy(dst, src, n); }
+inline char *strcpy_P(char *dst, const char *src) { return strcpy(dst, src); }
+inline char *strncpy_P(char *dst, const char *src, size_t n) { return strncpy(dst, src, n); }
+inline const char *strstr_P(const char *s, const char *find) { return strstr(s, find); }
+
+#endif
@@ -0,0 +1,162 @@
+#include "HostClient.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+HostClient::HostClient(HostClient &&other) {
+  *this = static_cast<HostClient &&>(other);
+}
+
+HostClient &HostClient::operator=(HostClient &&other) {
+  if (this == &other) return *this;
+  stop();
+  _fd = other._fd;
+  _peerClosed = other._peerClosed;
+  connects = other.connects;
+  bytesSent = other.bytesSent;
+  bytesReceived = other.bytesReceived;
+  other._fd = -1;
+  return *this;
+}
+
+int HostClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip.toString().c_str(), port);
+}
+
+int HostClient::connect(const char *host, uint16_t port) {
+  stop();
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+
+  struct addrinfo *addresses;
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) return 0;
+  for (struct addrinfo *a = addresses; a != nullptr && _fd < 0; a = a->ai_next) {
+    int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+      int on = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      _fd = fd;
+    } else {
+      ::close(fd);
+    }
+  }
+  freeaddrinfo(addresses);
+
+  if (_fd < 0) return 0;
+  _peerClosed = false;
+  connects++;
+  return 1;
+}
+
+size_t HostClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HostClient::write(const uint8_t *buf, size_t size) {
+  size_t sent = 0;
+  while (_fd >= 0 && sent < size) {
+    ssize_t n = send(_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      stop();
+      break;
+    }
+    sent += n;
+  }
+  bytesSent += sent;
+  return sent;
+}
+
+int HostClient::available() {
+  if (_fd < 0) return 0;
+  int pending = 0;
+  if (ioctl(_fd, FIONREAD, &pending) < 0) return 0;
+  if (pending == 0 && !_peerClosed) {
+    // A readable socket with nothing to read has been closed by the peer
+    char c;
+    ssize_t n = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+      _peerClosed = true;
+  }
+  return pending;
+}
+
+int HostClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int HostClient::read(uint8_t *buf, size_t size) {
+  if (_fd < 0 || size == 0) return -1;
+  ssize_t n = recv(_fd, buf, size, MSG_DONTWAIT);
+  if (n == 0) _peerClosed = true;
+  if (n <= 0) return -1;
+  bytesReceived += n;
+  return n;
+}
+
+int HostClient::peek() {
+  if (_fd < 0) return -1;
+  uint8_t c;
+  return recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+void HostClient::stop() {
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+  _peerClosed = false;
+}
+
+uint8_t HostClient::connected() {
+  if (_fd < 0) return 0;
+  return available() > 0 || !_peerClosed;
+}
+
+bool HostServer::begin() {
+  close();
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) return false;
+  int on = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(_port);
+  socklen_t length = sizeof(address);
+  if (bind(_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(_fd, 8) < 0 ||
+      getsockname(_fd, (struct sockaddr *)&address, &length) < 0) {
+    close();
+    return false;
+  }
+  _port = ntohs(address.sin_port);
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+void HostServer::close() {
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+HostClient HostServer::available() {
+  if (_fd < 0) return HostClient();
+  int fd = accept(_fd, nullptr, nullptr);
+  if (fd < 0) return HostClient();
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return HostClient(fd);
+}
@@ -0,0 +1,66 @@
+#ifndef HostClient_h
+#define HostClient_h
+
+#include <Client.h>
+
+/*
+   Client over a plain TCP socket, behaving like the WiFiClient of the
+   ESP cores: reads never block, connected() stays true while received
+   data is left to read. Counts what goes over the wire, so benchmarks
+   can report bytes per call
+ */
+class HostClient : public Client {
+public:
+  HostClient() {}
+  // Takes over a connected socket, as handed out by HostServer
+  explicit HostClient(int fd) : _fd(fd) {}
+  ~HostClient() { stop(); }
+  HostClient(const HostClient &) = delete;
+  HostClient &operator=(const HostClient &) = delete;
+  HostClient(HostClient &&other);
+  HostClient &operator=(HostClient &&other);
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+  using Print::write;
+
+  unsigned long connects = 0;
+  unsigned long bytesSent = 0;
+  unsigned long bytesReceived = 0;
+
+private:
+  int _fd = -1;
+  bool _peerClosed = false;
+};
+
+/*
+   Listening socket on the loopback interface, like WiFiServer.
+   available() hands out the next waiting connection without blocking
+ */
+class HostServer {
+public:
+  explicit HostServer(uint16_t port = 0) : _port(port) {}
+  ~HostServer() { close(); }
+
+  // Port 0 picks a free one, see port()
+  bool begin();
+  void close();
+  uint16_t port() const { return _port; }
+  HostClient available();
+
+private:
+  int _fd = -1;
+  uint16_t _port;
+};
+
+#endif
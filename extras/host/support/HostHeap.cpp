@@ -0,0 +1,186 @@
+#include "HostHeap.h"
+
+#include <atomic>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+// Every block starts with a header telling whether it is tracked, its size
+// and where the underlying glibc block begins
+struct HeapHeader {
+  uint32_t magic;
+  uint32_t offset;
+  size_t size;
+};
+
+static const uint32_t MAGIC_UNTRACKED = 0x48656170;
+static const uint32_t MAGIC_TRACKED = 0x48454150;
+static const size_t HEADER_ALIGNMENT = 16;
+
+static_assert(sizeof(HeapHeader) == HEADER_ALIGNMENT, "the header keeps blocks aligned");
+
+static __thread bool tracking = false;
+static std::atomic<size_t> heapInUse(0);
+static std::atomic<size_t> heapPeak(0);
+static std::atomic<unsigned long> heapAllocations(0);
+static std::atomic<unsigned long long> heapAllocatedBytes(0);
+
+static HeapHeader *headerOf(void *ptr) {
+  HeapHeader *header = (HeapHeader *)ptr - 1;
+  if (header->magic != MAGIC_TRACKED && header->magic != MAGIC_UNTRACKED) return nullptr;
+  return header;
+}
+
+static void *allocate(size_t alignment, size_t size) {
+  if (alignment < HEADER_ALIGNMENT) alignment = HEADER_ALIGNMENT;
+  if (size > SIZE_MAX - alignment) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  char *base = (char *)(alignment == HEADER_ALIGNMENT ? __libc_malloc(size + alignment)
+                                                       : __libc_memalign(alignment, size + alignment));
+  if (base == nullptr) return nullptr;
+
+  char *ptr = base + alignment;
+  HeapHeader *header = (HeapHeader *)ptr - 1;
+  header->magic = tracking ? MAGIC_TRACKED : MAGIC_UNTRACKED;
+  header->offset = (uint32_t)alignment;
+  header->size = size;
+  if (tracking) {
+    size_t now = heapInUse += size;
+    size_t peak = heapPeak;
+    while (now > peak && !heapPeak.compare_exchange_weak(peak, now)) {
+    }
+    heapAllocations++;
+    heapAllocatedBytes += size;
+  }
+  return ptr;
+}
+
+static void release(void *ptr) {
+  if (ptr == nullptr) return;
+  HeapHeader *header = headerOf(ptr);
+  if (header == nullptr) {
+    __libc_free(ptr);
+    return;
+  }
+  if (header->magic == MAGIC_TRACKED) heapInUse -= header->size;
+  header->magic = 0;
+  __libc_free((char *)ptr - header->offset);
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+  return allocate(HEADER_ALIGNMENT, size);
+}
+
+void free(void *ptr) {
+  release(ptr);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (size != 0 && count > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  void *ptr = allocate(HEADER_ALIGNMENT, count * size);
+  if (ptr != nullptr) memset(ptr, 0, count * size);
+  return ptr;
+}
+
+// Always moves the block, like a fragmented heap would
+void *realloc(void *ptr, size_t size) {
+  if (ptr == nullptr) return allocate(HEADER_ALIGNMENT, size);
+  if (size == 0) {
+    release(ptr);
+    return nullptr;
+  }
+  HeapHeader *header = headerOf(ptr);
+  void *moved = allocate(HEADER_ALIGNMENT, size);
+  if (moved == nullptr) return nullptr;
+  size_t old = header != nullptr ? header->size : 0;
+  memcpy(moved, ptr, old < size ? old : size);
+  release(ptr);
+  return moved;
+}
+
+void *memalign(size_t alignment, size_t size) {
+  return allocate(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return allocate(alignment, size);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+  void *ptr = allocate(alignment, size);
+  if (ptr == nullptr) return ENOMEM;
+  *result = ptr;
+  return 0;
+}
+
+void *valloc(size_t size) {
+  return allocate(4096, size);
+}
+
+void *pvalloc(size_t size) {
+  return allocate(4096, (size + 4095) & ~(size_t)4095);
+}
+
+size_t malloc_usable_size(void *ptr) {
+  if (ptr == nullptr) return 0;
+  HeapHeader *header = headerOf(ptr);
+  return header != nullptr ? header->size : 0;
+}
+}
+
+void HostHeap::track(bool on) {
+  tracking = on;
+}
+
+size_t HostHeap::inUse() {
+  return heapInUse;
+}
+
+size_t HostHeap::peak() {
+  return heapPeak;
+}
+
+void HostHeap::resetPeak() {
+  heapPeak = (size_t)heapInUse;
+}
+
+unsigned long HostHeap::allocations() {
+  return heapAllocations;
+}
+
+unsigned long long HostHeap::allocatedBytes() {
+  return heapAllocatedBytes;
+}
+
+void HostHeapSample::start() {
+  HostHeap::resetPeak();
+  _inUse = HostHeap::inUse();
+  _allocations = HostHeap::allocations();
+  _allocatedBytes = HostHeap::allocatedBytes();
+}
+
+unsigned long HostHeapSample::allocations() const {
+  return HostHeap::allocations() - _allocations;
+}
+
+unsigned long long HostHeapSample::allocatedBytes() const {
+  return HostHeap::allocatedBytes() - _allocatedBytes;
+}
+
+size_t HostHeapSample::peak() const {
+  size_t peak = HostHeap::peak();
+  return peak > _inUse ? peak - _inUse : 0;
+}
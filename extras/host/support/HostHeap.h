@@ -0,0 +1,39 @@
+#ifndef HostHeap_h
+#define HostHeap_h
+
+#include <stddef.h>
+
+/*
+   Heap accounting for the host tests and benchmarks. Linking HostHeap.cpp
+   replaces malloc and friends for the whole program. Only allocations made
+   by a thread while it has tracking on are counted, so the replay server
+   running next to the bot does not show up in the figures
+ */
+class HostHeap {
+public:
+  static void track(bool on);
+  // Bytes held by tracked allocations, and the most held at once
+  static size_t inUse();
+  static size_t peak();
+  static void resetPeak();
+  static unsigned long allocations();
+  static unsigned long long allocatedBytes();
+};
+
+// Counts what happens between start() and the calls reading it
+class HostHeapSample {
+public:
+  HostHeapSample() { start(); }
+  void start();
+  unsigned long allocations() const;
+  unsigned long long allocatedBytes() const;
+  // Most bytes held above what was held at start()
+  size_t peak() const;
+
+private:
+  size_t _inUse;
+  unsigned long _allocations;
+  unsigned long long _allocatedBytes;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef MockClient_h
+#define MockClient_h
+
+#include <Client.h>
+
+#include <string>
+
+/*
+   In-memory Client for tests that drive the bot step by step. What the
+   bot writes ends up in sent, what it reads comes from what the test put
+   in received. A read hands out at most readLimit bytes, so responses can
+   be made to trickle in, and stays empty while the test holds data back
+   with available
+ */
+class MockClient : public Client {
+public:
+  int connect(IPAddress, uint16_t port) override { return connect("", port); }
+  int connect(const char *, uint16_t) override {
+    if (refuse) return 0;
+    open = true;
+    _hungUp = false;
+    connects++;
+    return 1;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override {
+    if (_hungUp) return size;
+    if (!open) return 0;
+    if (failNextWrite) {
+      failNextWrite = false;
+      open = false;
+      return 0;
+    }
+    sent.append((const char *)buf, size);
+    if (hangUpOnWrite) {
+      hangUpOnWrite = false;
+      open = false;
+      _hungUp = true;
+    } else if (!nextAnswer.empty()) {
+      reply(nextAnswer);
+      nextAnswer.clear();
+    }
+    return size;
+  }
+  int available() override {
+    size_t left = received.size() - position;
+    return (int)(left < released ? left : released);
+  }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int read(uint8_t *buf, size_t size) override {
+    size_t n = available();
+    if (readLimit > 0 && n > readLimit) n = readLimit;
+    if (n > size) n = size;
+    if (n == 0) return -1;
+    received.copy((char *)buf, n, position);
+    position += n;
+    released -= n < released ? n : released;
+    return (int)n;
+  }
+  int peek() override { return available() > 0 ? (uint8_t)received[position] : -1; }
+  void flush() override {}
+  void stop() override {
+    open = false;
+    stops++;
+  }
+  uint8_t connected() override { return open || available() > 0; }
+  operator bool() override { return open; }
+  using Print::write;
+
+  // Queues bytes for the bot to read
+  void reply(const std::string &data) {
+    received += data;
+    released += data.size();
+  }
+  // Queues bytes the bot only sees after release()
+  void hold(const std::string &data) { received += data; }
+  void release(size_t count = (size_t)-1) {
+    size_t left = received.size() - position;
+    released = count < left ? count : left;
+  }
+  // Queues bytes for the bot to read once it has written its next request,
+  // a request sent before data arrives sees no leftovers
+  void answerNext(const std::string &data) { nextAnswer += data; }
+  // The connection closes from the server side
+  void hangUp() { open = false; }
+  // Forgets what was sent and received so far
+  void clear() {
+    sent.clear();
+    received.clear();
+    position = released = 0;
+  }
+
+  std::string sent;
+  std::string received;
+  size_t position = 0;
+  size_t released = 0;
+  size_t readLimit = 0;
+  std::string nextAnswer;
+  bool open = false;
+  bool refuse = false;
+  // The next write fails and closes the connection
+  bool failNextWrite = false;
+  // The server closes the connection on the next write without answering,
+  // like a kept-alive connection that went stale. The rest of the request
+  // is lost, nextAnswer waits for a request on the next connection
+  bool hangUpOnWrite = false;
+  unsigned connects = 0;
+  unsigned stops = 0;
+
+private:
+  bool _hungUp = false;
+};
+
+#endif
@@ -0,0 +1,353 @@
+#include "ReplayServer.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+// How long a blocked read or accept waits before checking for stop()
+static const int POLL_INTERVAL = 50;
+
+ReplayServer::~ReplayServer() {
+  stop();
+}
+
+bool ReplayServer::load(const char *path) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::stringstream session;
+  session << file.rdbuf();
+  return parse(session.str());
+}
+
+bool ReplayServer::parse(const std::string &session) {
+  std::istringstream lines(session);
+  std::string line;
+  std::vector<ReplayResponse> parsed;
+  std::string body;
+
+  auto finish = [&]() {
+    if (parsed.empty()) return;
+    while (!body.empty() && (body.back() == '\n' || body.back() == '\r')) body.pop_back();
+    parsed.back().body = body;
+    body.clear();
+  };
+
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty() && line[0] == '#') continue;
+    if (line.empty() || line[0] != '@') {
+      if (parsed.empty()) {
+        if (line.find_first_not_of(" \t") != std::string::npos) return false;
+      } else {
+        body += line;
+        body += '\n';
+      }
+      continue;
+    }
+
+    finish();
+    std::istringstream words(line.substr(1));
+    ReplayResponse response;
+    if (!(words >> response.method)) return false;
+    std::string option;
+    while (words >> option) {
+      if (option.compare(0, 7, "status=") == 0) response.status = atoi(option.c_str() + 7);
+      else if (option.compare(0, 6, "delay=") == 0) response.delay = strtoul(option.c_str() + 6, nullptr, 10);
+      else if (option.compare(0, 9, "truncate=") == 0) response.truncate = strtoul(option.c_str() + 9, nullptr, 10);
+      else if (option == "chunked") response.chunked = true;
+      else if (option == "close") response.close = true;
+      else if (option == "hangup") response.hangup = true;
+      else if (option == "drop") response.drop = true;
+      else if (option == "repeat") response.repeat = true;
+      else return false;
+    }
+    parsed.push_back(response);
+  }
+  finish();
+
+  for (const ReplayResponse &response : parsed) add(response);
+  return true;
+}
+
+void ReplayServer::add(const ReplayResponse &response) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _slots.push_back({response, false});
+}
+
+void ReplayServer::add(const char *method, const char *body, int status) {
+  ReplayResponse response;
+  response.method = method;
+  response.body = body;
+  response.status = status;
+  add(response);
+}
+
+bool ReplayServer::start(uint16_t port, bool anyInterface) {
+  stop();
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) return false;
+  int on = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(anyInterface ? INADDR_ANY : INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t length = sizeof(address);
+  if (bind(_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(_fd, 8) < 0 ||
+      getsockname(_fd, (struct sockaddr *)&address, &length) < 0) {
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+  _port = ntohs(address.sin_port);
+  _running = true;
+  _acceptThread = std::thread(&ReplayServer::acceptLoop, this);
+  return true;
+}
+
+void ReplayServer::stop() {
+  if (!_running) return;
+  _running = false;
+  _acceptThread.join();
+  for (std::thread &thread : _threads) thread.join();
+  _threads.clear();
+  close(_fd);
+  _fd = -1;
+}
+
+std::vector<ReplayRequest> ReplayServer::requests() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _requests;
+}
+
+size_t ReplayServer::requestCount() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _requests.size();
+}
+
+size_t ReplayServer::pending() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  size_t count = 0;
+  for (const Slot &slot : _slots)
+    if (!slot.used && !slot.response.repeat) count++;
+  return count;
+}
+
+void ReplayServer::acceptLoop() {
+  while (_running) {
+    struct pollfd waiting = {_fd, POLLIN, 0};
+    if (poll(&waiting, 1, POLL_INTERVAL) <= 0) continue;
+    int fd = accept(_fd, nullptr, nullptr);
+    if (fd < 0) continue;
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    unsigned connection = ++_connections;
+    std::lock_guard<std::mutex> guard(_lock);
+    _threads.push_back(std::thread(&ReplayServer::serve, this, fd, connection));
+  }
+}
+
+// Answers the requests of one connection in the order they came in, which
+// also covers requests the bot pipelines before reading any answer
+void ReplayServer::serve(int fd, unsigned connection) {
+  std::string buffer;
+  for (;;) {
+    ReplayRequest request;
+    request.connection = connection;
+    if (!readRequest(fd, buffer, request)) break;
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      _requests.push_back(request);
+    }
+    if (verbose) printf("[%u] %s\n", connection, request.requestLine.c_str());
+    if (!answer(fd, request)) break;
+  }
+  close(fd);
+}
+
+// Reads more of the connection, false once it is closed or the server stops
+static bool receive(int fd, std::string &buffer, const std::atomic<bool> &running) {
+  while (running) {
+    struct pollfd waiting = {fd, POLLIN, 0};
+    int ready = poll(&waiting, 1, POLL_INTERVAL);
+    if (ready < 0 && errno != EINTR) return false;
+    if (ready <= 0) continue;
+    char block[4096];
+    ssize_t n = recv(fd, block, sizeof(block), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buffer.append(block, n);
+    return true;
+  }
+  return false;
+}
+
+static std::string headerValue(const std::string &headers, const char *name) {
+  size_t length = strlen(name);
+  size_t start = 0;
+  while (start < headers.size()) {
+    size_t end = headers.find("\r\n", start);
+    if (end == std::string::npos) end = headers.size();
+    if (end - start > length && headers[start + length] == ':' &&
+        strncasecmp(headers.c_str() + start, name, length) == 0) {
+      size_t value = headers.find_first_not_of(" \t", start + length + 1);
+      return value < end ? headers.substr(value, end - value) : std::string();
+    }
+    start = end + 2;
+  }
+  return std::string();
+}
+
+bool ReplayServer::readRequest(int fd, std::string &buffer, ReplayRequest &request) {
+  size_t headEnd;
+  while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+    if (!receive(fd, buffer, _running)) return false;
+
+  size_t lineEnd = buffer.find("\r\n");
+  request.requestLine = buffer.substr(0, lineEnd);
+  request.headers = lineEnd < headEnd ? buffer.substr(lineEnd + 2, headEnd - lineEnd) : std::string();
+  buffer.erase(0, headEnd + 4);
+
+  std::string length = headerValue(request.headers, "Content-Length");
+  if (strcasecmp(headerValue(request.headers, "Transfer-Encoding").c_str(), "chunked") == 0) {
+    for (;;) {
+      size_t sizeEnd;
+      while ((sizeEnd = buffer.find("\r\n")) == std::string::npos)
+        if (!receive(fd, buffer, _running)) return false;
+      size_t size = strtoul(buffer.c_str(), nullptr, 16);
+      while (buffer.size() < sizeEnd + 2 + size + 2)
+        if (!receive(fd, buffer, _running)) return false;
+      request.body.append(buffer, sizeEnd + 2, size);
+      buffer.erase(0, sizeEnd + 2 + size + 2);
+      if (size == 0) break;
+    }
+  } else if (!length.empty()) {
+    size_t size = strtoul(length.c_str(), nullptr, 10);
+    while (buffer.size() < size)
+      if (!receive(fd, buffer, _running)) return false;
+    request.body = buffer.substr(0, size);
+    buffer.erase(0, size);
+  }
+
+  // GET /bot<token>/sendMessage?chat_id=1 HTTP/1.1
+  size_t pathStart = request.requestLine.find(' ') + 1;
+  size_t pathEnd = request.requestLine.find_first_of(" ?", pathStart);
+  std::string path = request.requestLine.substr(pathStart, pathEnd - pathStart);
+  if (path.compare(0, 6, "/file/") == 0) request.method = "file";
+  else request.method = path.substr(path.rfind('/') + 1);
+  return true;
+}
+
+ReplayResponse ReplayServer::next(const std::string &method) {
+  std::lock_guard<std::mutex> guard(_lock);
+  for (Slot &slot : _slots) {
+    if (slot.used || (slot.response.method != method && slot.response.method != "*")) continue;
+    if (!slot.response.repeat) slot.used = true;
+    return slot.response;
+  }
+
+  ReplayResponse response;
+  response.method = method;
+  if (method == "getUpdates") {
+    response.body = "{\"ok\":true,\"result\":[]}";
+  } else if (method == "getMe") {
+    response.body = "{\"ok\":true,\"result\":{\"id\":1,\"is_bot\":true,\"first_name\":\"Replay\","
+                    "\"username\":\"replay_bot\"}}";
+  } else if (method == "file") {
+    response.status = 404;
+    response.body = "{\"ok\":false,\"error_code\":404,\"description\":\"Not Found\"}";
+  } else {
+    char body[128];
+    snprintf(body, sizeof(body),
+             "{\"ok\":true,\"result\":{\"message_id\":%lu,\"date\":0,\"chat\":{\"id\":0,\"type\":\"private\"}}}",
+             ++_messageId);
+    response.body = body;
+  }
+  return response;
+}
+
+static const char *reason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default: return "Status";
+  }
+}
+
+static bool sendAll(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+// Returns false when the connection is to be closed
+bool ReplayServer::answer(int fd, const ReplayRequest &request) {
+  ReplayResponse response = next(request.method);
+  if (response.delay > 0) std::this_thread::sleep_for(std::chrono::milliseconds(response.delay));
+  if (response.drop) {
+    if (verbose) printf("[%u] dropped\n", request.connection);
+    return false;
+  }
+
+  char head[256];
+  std::string text;
+  snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n", response.status,
+           reason(response.status));
+  text = head;
+  if (response.chunked) {
+    text += "Transfer-Encoding: chunked\r\n";
+  } else {
+    snprintf(head, sizeof(head), "Content-Length: %u\r\n", (unsigned)response.body.size());
+    text += head;
+  }
+  text += response.close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+
+  if (response.chunked) {
+    // Two chunks, so chunk boundaries fall inside the JSON
+    size_t half = response.body.size() / 2;
+    const std::string parts[] = {response.body.substr(0, half), response.body.substr(half)};
+    for (const std::string &part : parts) {
+      if (part.empty()) continue;
+      snprintf(head, sizeof(head), "%x\r\n", (unsigned)part.size());
+      text += head;
+      text += part;
+      text += "\r\n";
+    }
+    text += "0\r\n\r\n";
+  } else {
+    text += response.body;
+  }
+
+  if (response.truncate > 0 && response.truncate < text.size()) {
+    text.resize(response.truncate);
+    response.close = true;
+  }
+  if (verbose) printf("[%u] %d, %u bytes\n", request.connection, response.status, (unsigned)text.size());
+  return sendAll(fd, text) && !response.close && !response.hangup;
+}
@@ -0,0 +1,110 @@
+#ifndef ReplayServer_h
+#define ReplayServer_h
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One scripted answer. Answers are used up in order, per API method
+struct ReplayResponse {
+  // API method answered, "*" answers any
+  std::string method;
+  int status = 200;
+  std::string body;
+  // Milliseconds waited before answering
+  unsigned long delay = 0;
+  // Send the body in chunked encoding instead of with a Content-Length
+  bool chunked = false;
+  // Close the connection once answered
+  bool close = false;
+  // Close the connection once answered, although the answer says
+  // keep-alive, like a server dropping an idle connection
+  bool hangup = false;
+  // Close the connection without answering
+  bool drop = false;
+  // Send only this many bytes of the answer, then close, 0 sends it all
+  size_t truncate = 0;
+  // Never used up, answers every later request for the method
+  bool repeat = false;
+};
+
+struct ReplayRequest {
+  // Last path segment, "file" for downloads
+  std::string method;
+  std::string requestLine;
+  std::string headers;
+  std::string body;
+  // Which connection it came over, counted from 1
+  unsigned connection;
+};
+
+/*
+   Fake Bot API server. It listens on the loopback interface and answers
+   the bot with responses replayed from a session, which is either loaded
+   from a file or scripted by the test. Methods with nothing scripted get
+   a minimal successful answer. Every request is recorded, so tests can
+   check what the bot sent and over which connection.
+
+   A session file holds answers one after the other, each a line
+
+     @ <method> [status=N] [delay=MS] [chunked] [close] [hangup] [drop] [truncate=N] [repeat]
+
+   followed by the body, up to the next @ line. Lines starting with # are
+   comments.
+ */
+class ReplayServer {
+public:
+  ReplayServer() {}
+  ~ReplayServer();
+  ReplayServer(const ReplayServer &) = delete;
+  ReplayServer &operator=(const ReplayServer &) = delete;
+
+  bool load(const char *path);
+  bool parse(const std::string &session);
+  void add(const ReplayResponse &response);
+  void add(const char *method, const char *body, int status = 200);
+
+  // Port 0 picks a free one. Only the loopback interface is listened on
+  // unless anyInterface is set, which lets a board on the LAN connect
+  bool start(uint16_t port = 0, bool anyInterface = false);
+  void stop();
+  uint16_t port() const { return _port; }
+
+  std::vector<ReplayRequest> requests() const;
+  size_t requestCount() const;
+  unsigned connections() const { return _connections; }
+  // Scripted answers not used yet, repeated ones excluded
+  size_t pending() const;
+
+  // Log every request and answer to stdout
+  bool verbose = false;
+
+private:
+  struct Slot {
+    ReplayResponse response;
+    bool used;
+  };
+
+  void acceptLoop();
+  void serve(int fd, unsigned connection);
+  bool readRequest(int fd, std::string &buffer, ReplayRequest &request);
+  bool answer(int fd, const ReplayRequest &request);
+  ReplayResponse next(const std::string &method);
+
+  mutable std::mutex _lock;
+  std::vector<Slot> _slots;
+  std::vector<ReplayRequest> _requests;
+  std::vector<std::thread> _threads;
+  std::thread _acceptThread;
+  std::atomic<bool> _running{false};
+  std::atomic<unsigned> _connections{0};
+  unsigned long _messageId = 0;
+  int _fd = -1;
+  uint16_t _port = 0;
+};
+
+#endif
@@ -0,0 +1,168 @@
+// Queued requests are sent and answered from loop(), which returns while a
+// response is still on its way
+
+#include <UniversalTelegramBot.h>
+
+#include <vector>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static std::vector<int> outcomes;
+static std::vector<std::string> answers;
+static int updatesReceived = -1;
+
+static void onResponse(UniversalTelegramBot &, int error, const String &answer) {
+  outcomes.push_back(error);
+  answers.push_back(answer.c_str());
+}
+
+static void onUpdates(UniversalTelegramBot &, int newMessages) {
+  updatesReceived = newMessages;
+}
+
+static void runUntilIdle(UniversalTelegramBot &bot) {
+  unsigned long start = millis();
+  while (bot.pendingRequests() > 0 && millis() - start < 2000) bot.loop();
+}
+
+static void testTrickledResponse() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  outcomes.clear();
+  answers.clear();
+
+  CHECK(bot.queueGet("bot123:token/getMe", onResponse));
+  CHECK_EQUAL(1, bot.pendingRequests());
+  client.hold(response("{\"ok\":true,\"result\":{\"username\":\"host_bot\"}}"));
+
+  // Nothing has arrived, loop() does not wait for it
+  unsigned long start = millis();
+  for (int i = 0; i < 5; i++) bot.loop();
+  CHECK(millis() - start < 100);
+  CHECK_CONTAINS(client.sent, "GET /bot123:token/getMe HTTP/1.1\r\n");
+  CHECK_EQUAL(0, outcomes.size());
+
+  // Seven bytes at a time, the callback comes with the last of them
+  client.readLimit = 7;
+  client.release(40);
+  bot.loop();
+  CHECK_EQUAL(0, outcomes.size());
+  CHECK_EQUAL(1, bot.pendingRequests());
+  client.release();
+  runUntilIdle(bot);
+  CHECK_EQUAL(1, outcomes.size());
+  CHECK_EQUAL(TELEGRAM_ERROR_NONE, outcomes[0]);
+  CHECK_CONTAINS(answers[0], "\"username\":\"host_bot\"");
+}
+
+static void testQueuedPostAndMessage() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  outcomes.clear();
+  answers.clear();
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(2)> payload;
+  payload["chat_id"] = 9;
+  payload["action"] = "typing";
+  CHECK(bot.queuePost("bot123:token/sendChatAction", payload.as<JsonObject>(), onResponse));
+  CHECK(bot.sendMessageAsync("9", "hello", "", onResponse));
+  CHECK_EQUAL(2, bot.pendingRequests());
+
+  // With a long time slice, the loop() that finishes a request sends the
+  // next one, however slow the machine running the test
+  bot.loopTimeSlice = 1000;
+  client.answerNext(response("{\"ok\":true,\"result\":true}"));
+  bot.loop();
+  CHECK_EQUAL(1, outcomes.size());
+  CHECK_EQUAL(1, bot.pendingRequests());
+  client.reply(response("{\"ok\":true,\"result\":{\"message_id\":3}}"));
+  runUntilIdle(bot);
+  CHECK_EQUAL(2, outcomes.size());
+  CHECK_EQUAL(TELEGRAM_ERROR_NONE, outcomes[0]);
+  CHECK_EQUAL(TELEGRAM_ERROR_NONE, outcomes[1]);
+  CHECK_CONTAINS(answers[1], "\"message_id\":3");
+  CHECK_CONTAINS(client.sent, "POST /bot123:token/sendChatAction HTTP/1.1\r\n");
+  CHECK_CONTAINS(client.sent, "\"action\":\"typing\"");
+  CHECK_CONTAINS(client.sent, "POST /bot123:token/sendMessage HTTP/1.1\r\n");
+  CHECK_CONTAINS(client.sent, "\"text\":\"hello\"");
+  CHECK_EQUAL(1, client.connects);
+}
+
+static MockClient *mock = nullptr;
+static bool nestedSent = false;
+
+// Answers the first response with a message, sent while the second request
+// is still in flight
+static void onResponseSendMessage(UniversalTelegramBot &bot, int error, const String &answer) {
+  onResponse(bot, error, answer);
+  if (outcomes.size() > 1) return;
+  mock->answerNext(response("{\"ok\":true,\"result\":{\"message_id\":1}}"));
+  nestedSent = bot.sendMessage("9", "answered");
+}
+
+static void testCallbackSendsWhilePipelined() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.pipelineDepth = 2;
+  mock = &client;
+  nestedSent = false;
+  outcomes.clear();
+  answers.clear();
+
+  CHECK(bot.queueGet("bot123:token/getChat?chat_id=1", onResponseSendMessage));
+  CHECK(bot.queueGet("bot123:token/getChat?chat_id=2", onResponseSendMessage));
+  client.answerNext(response("{\"ok\":true,\"result\":{\"id\":1}}") +
+                    response("{\"ok\":true,\"result\":{\"id\":2}}"));
+  runUntilIdle(bot);
+
+  // The second answer reaches its own callback before the message is sent
+  CHECK(nestedSent);
+  CHECK_EQUAL(2, answers.size());
+  CHECK_CONTAINS(answers[0], "\"id\":1");
+  CHECK_CONTAINS(answers[1], "\"id\":2");
+  CHECK_EQUAL(1, bot.last_sent_message_id);
+  CHECK_EQUAL(1, client.connects);
+}
+
+static void testFetchUpdatesAsync() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  updatesReceived = -1;
+
+  CHECK(bot.fetchUpdatesAsync(onUpdates));
+  client.answerNext(response("{\"ok\":true,\"result\":[{\"update_id\":5,\"message\":{\"message_id\":1,"
+                             "\"from\":{\"id\":9,\"first_name\":\"Ada\"},\"chat\":{\"id\":9,\"type\":\"private\"},"
+                             "\"date\":1,\"text\":\"/start\"}}]}"));
+  runUntilIdle(bot);
+  CHECK_EQUAL(1, updatesReceived);
+  CHECK_CONTAINS(client.sent, "GET /bot123:token/getUpdates?offset=1");
+  CHECK(bot.nextMessage() != nullptr);
+  CHECK(bot.nextMessage()->text == "/start");
+  bot.ackMessage();
+
+  // The next fetch asks for what comes after the acknowledged update
+  client.clear();
+  CHECK(bot.fetchUpdatesAsync(onUpdates));
+  client.answerNext(response("{\"ok\":true,\"result\":[]}"));
+  runUntilIdle(bot);
+  CHECK_EQUAL(0, updatesReceived);
+  CHECK_CONTAINS(client.sent, "getUpdates?offset=6");
+}
+
+int main() {
+  RUN_TEST(testTrickledResponse);
+  RUN_TEST(testQueuedPostAndMessage);
+  RUN_TEST(testCallbackSendsWhilePipelined);
+  RUN_TEST(testFetchUpdatesAsync);
+  return hostTestResult();
+}
@@ -0,0 +1,63 @@
+// getCompactUpdates keeps the strings of a batch in an arena sized by
+// maxMessageLength
+
+#include <UniversalTelegramBot.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static std::string updates(long id, const std::string &text) {
+  return "{\"ok\":true,\"result\":[{\"update_id\":" + std::to_string(id) +
+         ",\"message\":{\"message_id\":1,\"from\":{\"id\":9,\"first_name\":\"Ada\"},"
+         "\"chat\":{\"id\":9,\"type\":\"private\"},\"date\":1,\"text\":\"" + text + "\"}}]}";
+}
+
+static void testUpdateFields() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+
+  client.reply(response(updates(41, "/start")));
+  CHECK_EQUAL(1, bot.getCompactUpdates(0));
+  CHECK_EQUAL(41, bot.updates[0].update_id);
+  CHECK(strcmp(bot.updates[0].text, "/start") == 0);
+  CHECK(strcmp(bot.updates[0].from_name, "Ada") == 0);
+  CHECK_EQUAL(9, bot.updates[0].chat_id);
+  CHECK(strcmp(bot.updates[0].chat_title, "") == 0);
+}
+
+static void testArenaFollowsMaxMessageLength() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+
+  client.reply(response(updates(1, "short")));
+  CHECK_EQUAL(1, bot.getCompactUpdates(0));
+  CHECK(strcmp(bot.updates[0].text, "short") == 0);
+
+  // A text longer than the first arena fits once maxMessageLength grows
+  std::string text(2500, 'x');
+  bot.maxMessageLength = 6000;
+  client.answerNext(response(updates(2, text)));
+  CHECK_EQUAL(1, bot.getCompactUpdates(2));
+  CHECK_EQUAL(TELEGRAM_ERROR_NONE, bot._lastError);
+  CHECK(text == bot.updates[0].text);
+
+  bot.maxMessageLength = 1500;
+  client.answerNext(response(updates(3, "after shrinking")));
+  CHECK_EQUAL(1, bot.getCompactUpdates(3));
+  CHECK(strcmp(bot.updates[0].text, "after shrinking") == 0);
+}
+
+int main() {
+  RUN_TEST(testUpdateFields);
+  RUN_TEST(testArenaFollowsMaxMessageLength);
+  return hostTestResult();
+}
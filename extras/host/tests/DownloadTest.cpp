@@ -0,0 +1,127 @@
+// A download that breaks off is resumed with a Range request where it
+// stopped, and ends up in the sink whole and in order
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static const char *GET_FILE =
+    "{\"ok\":true,\"result\":{\"file_id\":\"BQACAgIAAxk\",\"file_unique_id\":\"AgADfw\","
+    "\"file_size\":5000,\"file_path\":\"documents/file_12.bin\"}}";
+
+// Collects what the bot downloads
+class Sink : public Print {
+public:
+  size_t write(uint8_t c) override {
+    data += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    data.append((const char *)buffer, size);
+    return size;
+  }
+  std::string data;
+};
+
+static std::string file() {
+  std::string data;
+  for (int i = 0; i < 5000; i++) data += (char)('a' + (i * 7) % 26);
+  return data;
+}
+
+// Bytes the replay server puts before a body of the given size
+static size_t headLength(int status, size_t size) {
+  char head[256];
+  return snprintf(head, sizeof(head),
+                  "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+                  "Connection: keep-alive\r\n\r\n",
+                  status, status == 200 ? "OK" : "Status", (unsigned)size);
+}
+
+static ReplayResponse download(int status, const std::string &body, size_t truncate = 0) {
+  ReplayResponse response;
+  response.method = "file";
+  response.status = status;
+  response.body = body;
+  response.truncate = truncate;
+  return response;
+}
+
+static void setUp(UniversalTelegramBot &bot, ReplayServer &server) {
+  CHECK(server.start());
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  bot.retryPolicy.baseDelay = 10;
+}
+
+static size_t progressReceived = 0;
+
+static void testBrokenDownloadIsResumed() {
+  std::string data = file();
+  ReplayServer server;
+  server.add("getFile", GET_FILE);
+  server.add(download(200, data, headLength(200, data.size()) + 1200));
+  server.add(download(206, data.substr(1200), headLength(206, data.size() - 1200) + 2000));
+  server.add(download(206, data.substr(3200)));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+  bot.downloadProgress = [](size_t received, size_t, unsigned long) { progressReceived = received; };
+
+  Sink sink;
+  CHECK(bot.downloadFile("BQACAgIAAxk", sink));
+  CHECK(sink.data == data);
+  CHECK_EQUAL(5000, progressReceived);
+
+  std::vector<ReplayRequest> requests = server.requests();
+  CHECK_EQUAL(4, requests.size());
+  CHECK_CONTAINS(requests[1].requestLine, "GET /file/bot123:token/documents/file_12.bin ");
+  CHECK(requests[1].headers.find("Range:") == std::string::npos);
+  CHECK_CONTAINS(requests[2].headers, "Range: bytes=1200-");
+  CHECK_CONTAINS(requests[3].headers, "Range: bytes=3200-");
+  CHECK_EQUAL(0, server.pending());
+}
+
+static void testRangeIgnoredByTheServer() {
+  // The whole file comes again, what arrived before is skipped
+  std::string data = file();
+  ReplayServer server;
+  server.add("getFile", GET_FILE);
+  server.add(download(200, data, headLength(200, data.size()) + 1500));
+  server.add(download(200, data));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  Sink sink;
+  CHECK(bot.downloadFile("BQACAgIAAxk", sink));
+  CHECK(sink.data == data);
+  CHECK_CONTAINS(server.requests()[2].headers, "Range: bytes=1500-");
+}
+
+static void testRetriesRunOut() {
+  std::string data = file();
+  ReplayServer server;
+  server.add("getFile", GET_FILE);
+  ReplayResponse broken = download(200, data, headLength(200, data.size()) + 100);
+  broken.repeat = true;
+  server.add(broken);
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+  bot.retryPolicy.maxAttempts = 2;
+
+  Sink sink;
+  CHECK(!bot.downloadFile("BQACAgIAAxk", sink));
+  // Each attempt got no further than the first 100 bytes, nothing is repeated
+  CHECK(sink.data == data.substr(0, 100));
+}
+
+int main() {
+  RUN_TEST(testBrokenDownloadIsResumed);
+  RUN_TEST(testRangeIgnoredByTheServer);
+  RUN_TEST(testRetriesRunOut);
+  return hostTestResult();
+}
@@ -0,0 +1,161 @@
+// Paths resolved by getFile are used again for the same file until they
+// expire, the least recently used one making room for new files
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static std::string uniqueId(int i) {
+  return "AgAD" + std::to_string(i);
+}
+
+static std::string getFile(int i) {
+  return "{\"ok\":true,\"result\":{\"file_id\":\"BQAC" + std::to_string(i) + "\",\"file_unique_id\":\"" +
+         uniqueId(i) + "\",\"file_size\":" + std::to_string(100 + i) + ",\"file_path\":\"documents/file_" +
+         std::to_string(i) + ".bin\"}}";
+}
+
+static telegramMessage message(int i) {
+  telegramMessage message;
+  message.file_id = ("BQAC" + std::to_string(i)).c_str();
+  message.file_unique_id = uniqueId(i).c_str();
+  message.file_size = 0;
+  return message;
+}
+
+// Counts what the bot downloads
+class CountingSink : public Print {
+public:
+  size_t write(uint8_t) override {
+    bytes++;
+    return 1;
+  }
+  size_t write(const uint8_t *, size_t size) override {
+    bytes += size;
+    return size;
+  }
+  size_t bytes = 0;
+};
+
+static size_t getFileRequests(const ReplayServer &server) {
+  size_t count = 0;
+  for (const ReplayRequest &request : server.requests()) {
+    if (request.method == "getFile") count++;
+  }
+  return count;
+}
+
+static void setUp(UniversalTelegramBot &bot, ReplayServer &server) {
+  CHECK(server.start());
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+}
+
+static void testPathIsResolvedOnce() {
+  ReplayServer server;
+  server.add("getFile", getFile(1).c_str());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  telegramMessage first = message(1);
+  CHECK(first.file_path == "");
+  CHECK(bot.getFilePath(first));
+  CHECK(first.file_path == "https://api.telegram.org/file/bot123:token/documents/file_1.bin");
+  CHECK_EQUAL(101, first.file_size);
+
+  // The same file again, as a later update would carry it
+  telegramMessage again = message(1);
+  CHECK(bot.getFilePath(again));
+  CHECK(again.file_path == first.file_path);
+  CHECK_EQUAL(101, again.file_size);
+  CHECK_EQUAL(1, getFileRequests(server));
+
+  // Without file_unique_id there is nothing to look the path up by
+  telegramMessage unknown = message(1);
+  unknown.file_unique_id = "";
+  server.add("getFile", getFile(1).c_str());
+  CHECK(bot.getFilePath(unknown));
+  CHECK_EQUAL(2, getFileRequests(server));
+}
+
+static void testLeastRecentlyUsedIsEvicted() {
+  ReplayServer server;
+  for (int i = 0; i <= TELEGRAM_FILE_CACHE_SIZE; i++) server.add("getFile", getFile(i).c_str());
+  server.add("getFile", getFile(1).c_str());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  for (int i = 0; i < TELEGRAM_FILE_CACHE_SIZE; i++) {
+    telegramMessage file = message(i);
+    CHECK(bot.getFilePath(file));
+  }
+  // File 0 is used again, which leaves file 1 the oldest
+  telegramMessage file = message(0);
+  CHECK(bot.getFilePath(file));
+  CHECK_EQUAL(TELEGRAM_FILE_CACHE_SIZE, getFileRequests(server));
+
+  file = message(TELEGRAM_FILE_CACHE_SIZE);
+  CHECK(bot.getFilePath(file));
+  CHECK_EQUAL(TELEGRAM_FILE_CACHE_SIZE + 1, getFileRequests(server));
+
+  file = message(0);
+  CHECK(bot.getFilePath(file));
+  CHECK_EQUAL(TELEGRAM_FILE_CACHE_SIZE + 1, getFileRequests(server));
+  file = message(1);
+  CHECK(bot.getFilePath(file));
+  CHECK(file.file_path == "https://api.telegram.org/file/bot123:token/documents/file_1.bin");
+  CHECK_EQUAL(TELEGRAM_FILE_CACHE_SIZE + 2, getFileRequests(server));
+  CHECK_EQUAL(0, server.pending());
+}
+
+static void testPathExpires() {
+  ReplayServer server;
+  server.add("getFile", getFile(1).c_str());
+  server.add("getFile", getFile(1).c_str());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+  bot.filePathLifetime = 100;
+
+  telegramMessage file = message(1);
+  CHECK(bot.getFilePath(file));
+  CHECK(bot.getFilePath(file));
+  CHECK_EQUAL(1, getFileRequests(server));
+
+  delay(150);
+  CHECK(bot.getFilePath(file));
+  CHECK_EQUAL(2, getFileRequests(server));
+}
+
+static void testDownloadUsesTheCache() {
+  ReplayServer server;
+  server.add("getFile", getFile(1).c_str());
+  ReplayResponse download;
+  download.method = "file";
+  download.body = std::string(101, 'x');
+  download.repeat = true;
+  server.add(download);
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  CountingSink sink;
+  telegramMessage file = message(1);
+  CHECK(bot.getFilePath(file));
+  CHECK(bot.downloadFile(file.file_id, sink, file.file_unique_id));
+  CHECK_EQUAL(101, sink.bytes);
+  CHECK_EQUAL(1, getFileRequests(server));
+  CHECK_CONTAINS(server.requests().back().requestLine, "GET /file/bot123:token/documents/file_1.bin ");
+}
+
+int main() {
+  RUN_TEST(testPathIsResolvedOnce);
+  RUN_TEST(testLeastRecentlyUsedIsEvicted);
+  RUN_TEST(testPathExpires);
+  RUN_TEST(testDownloadUsesTheCache);
+  return hostTestResult();
+}
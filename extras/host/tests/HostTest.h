@@ -0,0 +1,52 @@
+#ifndef HostTest_h
+#define HostTest_h
+
+// Minimal checks for the host tests, every test is a program that returns
+// non-zero when a check failed
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+static int hostTestFailures = 0;
+
+#define CHECK(condition)                                                            \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      hostTestFailures++;                                                           \
+    }                                                                               \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                                                \
+  do {                                                                                               \
+    long long e_ = (long long)(expected), a_ = (long long)(actual);                                  \
+    if (e_ != a_) {                                                                                  \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_);    \
+      hostTestFailures++;                                                                            \
+    }                                                                                                \
+  } while (0)
+
+#define CHECK_CONTAINS(haystack, needle)                                                              \
+  do {                                                                                                \
+    std::string h_(haystack);                                                                         \
+    if (h_.find(needle) == std::string::npos) {                                                       \
+      fprintf(stderr, "%s:%d: \"%s\" not found in %s\n", __FILE__, __LINE__, needle, #haystack);       \
+      hostTestFailures++;                                                                             \
+    }                                                                                                 \
+  } while (0)
+
+#define RUN_TEST(test)                \
+  do {                                \
+    int before_ = hostTestFailures;   \
+    test();                           \
+    printf("%s %s\n", hostTestFailures == before_ ? "ok  " : "FAIL", #test); \
+  } while (0)
+
+static int hostTestResult() {
+  if (hostTestFailures > 0) fprintf(stderr, "%d check(s) failed\n", hostTestFailures);
+  return hostTestFailures > 0 ? 1 : 0;
+}
+
+#endif
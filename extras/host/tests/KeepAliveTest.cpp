@@ -0,0 +1,156 @@
+// A request on a kept-alive connection is sent again on a new connection
+// only when the server cannot have seen it
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "MockClient.h"
+#include "ReplayServer.h"
+
+static const char *GET_ME = "{\"ok\":true,\"result\":{\"id\":7,\"is_bot\":true,\"first_name\":\"Host\",\"username\":\"host_bot\"}}";
+static const char *SENT = "{\"ok\":true,\"result\":{\"message_id\":12}}";
+static const char *UPDATES = "{\"ok\":true,\"result\":[{\"update_id\":5,\"message\":{\"message_id\":1,"
+                             "\"chat\":{\"id\":9,\"type\":\"private\"},\"date\":1,\"text\":\"hi\"}}]}";
+
+static std::string response(const char *body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)strlen(body));
+  return std::string(head) + body;
+}
+
+// Request lines the bot started to write, even if the rest got lost
+static int requestsSent(const MockClient &client) {
+  int count = 0;
+  for (const char *method : {"GET /", "POST /"}) {
+    for (size_t at = client.sent.find(method); at != std::string::npos; at = client.sent.find(method, at + 1))
+      count++;
+  }
+  return count;
+}
+
+// A bot with one answered getMe behind it, so the next request reuses the
+// connection
+static void warmUp(UniversalTelegramBot &bot, MockClient &client) {
+  bot.waitForResponse = 50;
+  bot.retryPolicy.maxAttempts = 1;
+  client.answerNext(response(GET_ME));
+  CHECK(bot.getMe());
+}
+
+static void testClosedBeforeAnswerIsResent() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  warmUp(bot, client);
+
+  client.hangUpOnWrite = true;
+  client.answerNext(response(GET_ME));
+  CHECK(bot.getMe());
+  CHECK_EQUAL(2, client.connects);
+  CHECK_EQUAL(3, requestsSent(client));
+}
+
+static void testFailedWriteIsResent() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  warmUp(bot, client);
+
+  client.failNextWrite = true;
+  client.answerNext(response(SENT));
+  CHECK(bot.sendMessage("9", "hello", ""));
+  CHECK_EQUAL(2, client.connects);
+  CHECK_EQUAL(2, requestsSent(client));
+}
+
+static void testStreamedUpdatesAreResent() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  warmUp(bot, client);
+
+  bot.streamUpdates = true;
+  client.hangUpOnWrite = true;
+  client.answerNext(response(UPDATES));
+  CHECK_EQUAL(1, bot.getUpdates(0));
+  CHECK_EQUAL(2, client.connects);
+  CHECK_EQUAL(3, requestsSent(client));
+}
+
+static void testTimeoutIsNotResent() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  warmUp(bot, client);
+  CHECK(!bot.getMe());
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, bot._lastError);
+  CHECK_EQUAL(2, requestsSent(client));
+
+  warmUp(bot, client);
+  CHECK(!bot.sendMessage("9", "hello", ""));
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, bot._lastError);
+  CHECK_EQUAL(4, requestsSent(client));
+
+  warmUp(bot, client);
+  bot.streamUpdates = true;
+  CHECK_EQUAL(0, bot.getUpdates(0));
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, bot._lastError);
+  CHECK_EQUAL(6, requestsSent(client));
+}
+
+static void testNewConnectionIsNotResent() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.keepAlive = false;
+  bot.retryPolicy.maxAttempts = 1;
+
+  client.hangUpOnWrite = true;
+  CHECK(!bot.sendMessage("9", "hello", ""));
+  CHECK_EQUAL(TELEGRAM_ERROR_CONNECTION_CLOSED, bot._lastError);
+  CHECK_EQUAL(1, requestsSent(client));
+}
+
+// Against a real socket: a slow answer and one cut short are not repeated
+static void testServerAnswersAreNotRepeated() {
+  ReplayServer server;
+  ReplayResponse slow;
+  slow.method = "getMe";
+  slow.body = GET_ME;
+  slow.delay = 300;
+  server.add("getMe", GET_ME);
+  server.add(slow);
+  server.add("getMe", GET_ME);
+  ReplayResponse cut;
+  cut.method = "sendMessage";
+  cut.body = SENT;
+  cut.truncate = 40;
+  server.add(cut);
+  CHECK(server.start());
+
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  bot.waitForResponse = 100;
+  bot.retryPolicy.maxAttempts = 1;
+
+  CHECK(bot.getMe());
+  CHECK(!bot.getMe());
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, bot._lastError);
+  CHECK(bot.getMe());
+  CHECK(!bot.sendMessage("9", "hello", ""));
+  CHECK_EQUAL(TELEGRAM_ERROR_CONNECTION_CLOSED, bot._lastError);
+  delay(400);
+  CHECK_EQUAL(4, server.requestCount());
+  CHECK_EQUAL(2, server.connections());
+}
+
+int main() {
+  RUN_TEST(testClosedBeforeAnswerIsResent);
+  RUN_TEST(testFailedWriteIsResent);
+  RUN_TEST(testStreamedUpdatesAreResent);
+  RUN_TEST(testTimeoutIsNotResent);
+  RUN_TEST(testNewConnectionIsNotResent);
+  RUN_TEST(testServerAnswersAreNotRepeated);
+  return hostTestResult();
+}
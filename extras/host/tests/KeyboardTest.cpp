@@ -0,0 +1,62 @@
+// Keyboards built in a buffer, from scratch or from one loaded from flash
+
+#include <TelegramKeyboard.h>
+
+#include "HostTest.h"
+
+static void testBuild() {
+  char buffer[256];
+  TelegramKeyboard keyboard(buffer);
+  CHECK(keyboard.addCallbackButton("On", "lights_on"));
+  CHECK(keyboard.addCallbackButton("Off \"now\"", "lights_off"));
+  CHECK(keyboard.addRow());
+  CHECK(keyboard.addUrlButton("Docs", "https://example.com"));
+  CHECK(std::string(keyboard.c_str()) ==
+        "[[{\"text\":\"On\",\"callback_data\":\"lights_on\"},"
+        "{\"text\":\"Off \\\"now\\\"\",\"callback_data\":\"lights_off\"}],"
+        "[{\"text\":\"Docs\",\"url\":\"https://example.com\"}]]");
+  CHECK(!keyboard.failed());
+}
+
+static void testLoadTrimsWhitespace() {
+  char buffer[64];
+  TelegramKeyboard keyboard(buffer);
+  CHECK(keyboard.load(F("  [[\"Yes\"]]\r\n")));
+  CHECK(keyboard.addButton("No"));
+  CHECK(std::string(keyboard.c_str()) == "[[\"Yes\",{\"text\":\"No\"}]]");
+
+  CHECK(keyboard.load(F("[]\n")));
+  CHECK(keyboard.addButton("Only"));
+  CHECK(std::string(keyboard.c_str()) == "[[{\"text\":\"Only\"}]]");
+}
+
+static void testLoadRejectsOtherJson() {
+  char buffer[64];
+  TelegramKeyboard keyboard(buffer);
+  CHECK(!keyboard.load(F("{\"keyboard\":[[\"Yes\"]]}")));
+  CHECK(keyboard.failed());
+  CHECK(std::string(keyboard.c_str()) == "[]");
+  CHECK(!keyboard.addButton("No"));
+
+  CHECK(!keyboard.load(F("[\"Yes\"]")));
+  CHECK(!keyboard.load(F("  ")));
+  CHECK(keyboard.load(F("[[\"Yes\"]]")));
+  CHECK(!keyboard.failed());
+}
+
+static void testTooSmall() {
+  char buffer[24];
+  TelegramKeyboard keyboard(buffer);
+  CHECK(keyboard.addButton("1234"));
+  CHECK(!keyboard.addButton("too long for the buffer"));
+  CHECK(keyboard.failed());
+  CHECK(std::string(keyboard.c_str()) == "[[{\"text\":\"1234\"}]]");
+}
+
+int main() {
+  RUN_TEST(testBuild);
+  RUN_TEST(testLoadTrimsWhitespace);
+  RUN_TEST(testLoadRejectsOtherJson);
+  RUN_TEST(testTooSmall);
+  return hostTestResult();
+}
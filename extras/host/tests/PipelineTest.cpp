@@ -0,0 +1,119 @@
+// Requests pipelined behind one that times out fail, behind one the server
+// closed the connection after they are sent again
+
+#include <UniversalTelegramBot.h>
+
+#include <vector>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static int count(const std::string &text, const char *what) {
+  int found = 0;
+  for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) found++;
+  return found;
+}
+
+static std::vector<int> outcomes;
+static std::vector<int> recorded;
+
+static void onResponse(UniversalTelegramBot &, int error, const String &) {
+  outcomes.push_back(error);
+}
+
+static void onRequest(const TelegramRequestMetrics &request) {
+  recorded.push_back(request.error);
+}
+
+static void runUntilIdle(UniversalTelegramBot &bot) {
+  unsigned long start = millis();
+  while (bot.pendingRequests() > 0 && millis() - start < 2000) bot.loop();
+}
+
+static void testTimeoutFailsPipelinedRequests() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.pipelineDepth = 3;
+  bot.waitForResponse = 50;
+  bot.metricsSink = onRequest;
+  outcomes.clear();
+  recorded.clear();
+
+  CHECK(bot.queueGet("bot123:token/getMe", onResponse));
+  CHECK(bot.queuePost("bot123:token/sendMessage", JsonObject(), onResponse));
+  CHECK(bot.queueGet("bot123:token/getChat?chat_id=2", onResponse));
+  bot.loop();
+  CHECK_EQUAL(2, count(client.sent, "GET /"));
+  CHECK_EQUAL(1, count(client.sent, "POST /"));
+
+  // Nothing is answered on this connection. The server may have acted on
+  // the requests behind the first one, so they fail rather than being sent
+  // a second time
+  runUntilIdle(bot);
+  CHECK_EQUAL(3, outcomes.size());
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, outcomes[0]);
+  CHECK_EQUAL(TELEGRAM_ERROR_TIMEOUT, recorded[0]);
+  for (size_t i = 1; i < outcomes.size(); i++) CHECK_EQUAL(TELEGRAM_ERROR_CONNECTION_CLOSED, outcomes[i]);
+  CHECK_EQUAL(1, client.connects);
+  CHECK_EQUAL(1, count(client.sent, "POST /"));
+  CHECK_EQUAL(1, count(client.sent, "getChat?chat_id=2"));
+}
+
+static void testConnectionCloseRequeuesPipelinedRequests() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.pipelineDepth = 3;
+  outcomes.clear();
+
+  CHECK(bot.queueGet("bot123:token/getMe", onResponse));
+  CHECK(bot.queueGet("bot123:token/getChat?chat_id=1", onResponse));
+  CHECK(bot.queueGet("bot123:token/getChat?chat_id=2", onResponse));
+  // The server answers the first request and closes, without reading the
+  // others, which the same loop() sends again on the next connection
+  std::string closing = response("{\"ok\":true,\"result\":{}}");
+  closing.replace(closing.find("keep-alive"), 10, "close");
+  client.answerNext(closing);
+  bot.loopTimeSlice = 1000;
+  bot.loop();
+  CHECK_EQUAL(1, outcomes.size());
+  CHECK_EQUAL(2, client.connects);
+  client.reply(response("{\"ok\":true,\"result\":{\"id\":1}}") + response("{\"ok\":true,\"result\":{\"id\":2}}"));
+
+  runUntilIdle(bot);
+  CHECK_EQUAL(3, outcomes.size());
+  for (size_t i = 0; i < outcomes.size(); i++) CHECK_EQUAL(TELEGRAM_ERROR_NONE, outcomes[i]);
+  CHECK_EQUAL(2, client.connects);
+  CHECK_EQUAL(2, count(client.sent, "getChat?chat_id=1"));
+}
+
+static void testPipelinedResponsesAreMatched() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.pipelineDepth = 4;
+  outcomes.clear();
+
+  for (int i = 0; i < 4; i++) CHECK(bot.queueGet("bot123:token/getMe", onResponse));
+  std::string answers;
+  for (int i = 0; i < 4; i++) answers += response("{\"ok\":true,\"result\":{}}");
+  client.answerNext(answers);
+  runUntilIdle(bot);
+  CHECK_EQUAL(4, outcomes.size());
+  CHECK_EQUAL(1, client.connects);
+  CHECK_EQUAL(4, count(client.sent, "GET /"));
+}
+
+int main() {
+  RUN_TEST(testTimeoutFailsPipelinedRequests);
+  RUN_TEST(testConnectionCloseRequeuesPipelinedRequests);
+  RUN_TEST(testPipelinedResponsesAreMatched);
+  return hostTestResult();
+}
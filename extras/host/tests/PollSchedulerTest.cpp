@@ -0,0 +1,114 @@
+// The long-poll timeout grows while polls come back empty, drops as soon as
+// messages arrive and never keeps the sketch waiting longer than maxBlocking
+
+#include <UniversalTelegramBot.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static const unsigned int SLACK = 1500;
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static void testTimeoutGrowsAndResets() {
+  TelegramPollScheduler scheduler;
+  CHECK_EQUAL(0, scheduler.timeout(SLACK));
+
+  // Empty polls double it up to maxTimeout
+  const int grown[] = {1, 2, 4, 8, 16, TELEGRAM_POLL_MAX_TIMEOUT, TELEGRAM_POLL_MAX_TIMEOUT};
+  for (int expected : grown) {
+    scheduler.record(0, false, false, SLACK, 0);
+    CHECK_EQUAL(expected, scheduler.timeout(SLACK));
+    CHECK(scheduler.due(0));
+  }
+
+  // Messages bring it down at once, a full batch to no wait at all
+  scheduler.record(3, false, false, SLACK, 0);
+  CHECK_EQUAL(TELEGRAM_POLL_BURST_TIMEOUT, scheduler.timeout(SLACK));
+  scheduler.record(0, false, false, SLACK, 0);
+  CHECK_EQUAL(2 * TELEGRAM_POLL_BURST_TIMEOUT, scheduler.timeout(SLACK));
+  scheduler.record(10, true, false, SLACK, 0);
+  CHECK_EQUAL(0, scheduler.timeout(SLACK));
+  CHECK(scheduler.due(0));
+
+  CHECK_EQUAL(10, scheduler.polls);
+  CHECK_EQUAL(8, scheduler.emptyPolls);
+  CHECK_EQUAL(0, scheduler.failedPolls);
+}
+
+static void testMaxBlockingCap() {
+  TelegramPollScheduler scheduler;
+  // 5 s, of which the response may take 1.5 s, leave 3 s to wait on the server
+  scheduler.maxBlocking = 5000;
+  for (int i = 0; i < 10; i++) {
+    scheduler.record(0, false, false, SLACK, 0);
+    CHECK(scheduler.timeout(SLACK) <= 3);
+  }
+  CHECK_EQUAL(3, scheduler.timeout(SLACK));
+  CHECK(scheduler.due(0));
+
+  // No room for a long poll, empty polls space out instead
+  scheduler.maxBlocking = SLACK;
+  unsigned long now = 0;
+  unsigned long interval = TELEGRAM_POLL_MIN_INTERVAL;
+  for (int i = 0; i < 8; i++) {
+    scheduler.record(0, false, false, SLACK, now);
+    CHECK_EQUAL(0, scheduler.timeout(SLACK));
+    CHECK(!scheduler.due(now + interval - 1));
+    CHECK(scheduler.due(now + interval));
+    now += interval;
+    interval = interval * 2 > TELEGRAM_POLL_MAX_INTERVAL ? TELEGRAM_POLL_MAX_INTERVAL : interval * 2;
+  }
+
+  // A message ends the pause
+  scheduler.record(1, false, false, SLACK, now);
+  CHECK(scheduler.due(now));
+}
+
+static void testFailuresBackOff() {
+  TelegramPollScheduler scheduler;
+  scheduler.record(0, false, true, SLACK, 0);
+  CHECK(!scheduler.due(TELEGRAM_POLL_MIN_INTERVAL - 1));
+  scheduler.record(0, false, true, SLACK, TELEGRAM_POLL_MIN_INTERVAL);
+  CHECK(!scheduler.due(3 * TELEGRAM_POLL_MIN_INTERVAL - 1));
+  CHECK(scheduler.due(3 * TELEGRAM_POLL_MIN_INTERVAL));
+  CHECK_EQUAL(2, scheduler.failedPolls);
+}
+
+static void testPollUpdatesSendsTheTimeout() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client, 4);
+  bot.longPoll = 60;
+
+  client.answerNext(response("{\"ok\":true,\"result\":[]}"));
+  CHECK_EQUAL(0, bot.pollUpdates());
+  CHECK(client.sent.find("timeout=") == std::string::npos);
+
+  client.clear();
+  client.answerNext(response("{\"ok\":true,\"result\":[]}"));
+  CHECK_EQUAL(0, bot.pollUpdates());
+  CHECK_CONTAINS(client.sent, "&timeout=1 ");
+
+  client.clear();
+  client.answerNext(response("{\"ok\":true,\"result\":[]}"));
+  CHECK_EQUAL(0, bot.pollUpdates());
+  CHECK_CONTAINS(client.sent, "&timeout=2 ");
+
+  // The configured longPoll is left alone
+  CHECK_EQUAL(60, bot.longPoll);
+}
+
+int main() {
+  RUN_TEST(testTimeoutGrowsAndResets);
+  RUN_TEST(testMaxBlockingCap);
+  RUN_TEST(testFailuresBackOff);
+  RUN_TEST(testPollUpdatesSendsTheTimeout);
+  return hostTestResult();
+}
@@ -0,0 +1,56 @@
+// The per chat and per group limits hold with more chats than are tracked
+
+#include <TelegramRateLimiter.h>
+
+#include "HostTest.h"
+
+static std::string group(int i) {
+  return "-100" + std::to_string(i);
+}
+
+static void testMoreGroupsThanTracked() {
+  TelegramRateLimiter limiter;
+  for (int i = 0; i < TELEGRAM_RATE_LIMIT_CHATS; i++) CHECK(limiter.tryAcquire(group(i).c_str(), 0));
+
+  // Every tracked group is inside its window, none is forgotten for a new one
+  CHECK(!limiter.tryAcquire(group(TELEGRAM_RATE_LIMIT_CHATS).c_str(), 1000));
+
+  // A group gets its message back after 60000 / 20 ms
+  unsigned long recovered = 60000ul / TELEGRAM_GROUP_MESSAGES_PER_MINUTE;
+  CHECK(limiter.tryAcquire(group(TELEGRAM_RATE_LIMIT_CHATS).c_str(), recovered));
+}
+
+// Messages the first of groups groups gets through in a minute, with every
+// group sending as often as it may
+static int sentInAMinute(int groups) {
+  TelegramRateLimiter limiter;
+  int sent = 0;
+  for (unsigned long now = 0; now < 60000; now += 100) {
+    for (int i = 0; i < groups; i++) {
+      if (limiter.tryAcquire(group(i).c_str(), now) && i == 0) sent++;
+    }
+  }
+  return sent;
+}
+
+static void testGroupLimitHoldsWhileRotating() {
+  // A group whose entry was forgotten would start over with a full bucket
+  int alone = sentInAMinute(1);
+  CHECK_EQUAL(alone, sentInAMinute(TELEGRAM_RATE_LIMIT_CHATS + 1));
+  CHECK_EQUAL(alone, sentInAMinute(3 * TELEGRAM_RATE_LIMIT_CHATS));
+}
+
+static void testPrivateChatsRecoverWithinASecond() {
+  TelegramRateLimiter limiter;
+  for (int i = 1; i <= TELEGRAM_RATE_LIMIT_CHATS; i++) CHECK(limiter.tryAcquire(std::to_string(i).c_str(), 0));
+  CHECK(!limiter.tryAcquire("99", 500));
+  CHECK(limiter.tryAcquire("99", TELEGRAM_CHAT_MESSAGE_INTERVAL));
+  CHECK(!limiter.tryAcquire("99", TELEGRAM_CHAT_MESSAGE_INTERVAL + 10));
+}
+
+int main() {
+  RUN_TEST(testMoreGroupsThanTracked);
+  RUN_TEST(testGroupLimitHoldsWhileRotating);
+  RUN_TEST(testPrivateChatsRecoverWithinASecond);
+  return hostTestResult();
+}
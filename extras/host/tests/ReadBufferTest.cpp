@@ -0,0 +1,53 @@
+// Bytes read ahead on one connection never end up in a response on the next
+
+#include <UniversalTelegramBot.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static std::string getMe(const char *userName) {
+  return std::string("{\"ok\":true,\"result\":{\"id\":7,\"is_bot\":true,\"first_name\":\"Host\",\"username\":\"") +
+         userName + "\"}}";
+}
+
+static void testLeftoversAreDroppedOnReconnect() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+
+  // Whatever follows the response is read along with it, then the server
+  // closes the connection
+  client.reply(response(getMe("first_bot")) + "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n{}");
+  CHECK(bot.getMe());
+  CHECK(bot.userName == "first_bot");
+  client.hangUp();
+
+  client.answerNext(response(getMe("second_bot")));
+  CHECK(bot.getMe());
+  CHECK(bot.userName == "second_bot");
+  CHECK_EQUAL(2, client.connects);
+}
+
+static void testTrickledResponse() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  client.readLimit = 7;
+
+  client.reply(response(getMe("slow_bot")));
+  CHECK(bot.getMe());
+  CHECK(bot.userName == "slow_bot");
+}
+
+int main() {
+  RUN_TEST(testLeftoversAreDroppedOnReconnect);
+  RUN_TEST(testTrickledResponse);
+  return hostTestResult();
+}
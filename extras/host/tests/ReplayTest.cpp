@@ -0,0 +1,117 @@
+// The bot against the replay server: requests, framing, and reuse of the
+// kept-alive connection
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static void pointAt(UniversalTelegramBot &bot, ReplayServer &server) {
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+}
+
+static void testGetMe() {
+  ReplayServer server;
+  server.add("getMe", "{\"ok\":true,\"result\":{\"id\":7,\"is_bot\":true,\"first_name\":\"Host\",\"username\":\"host_bot\"}}");
+  CHECK(server.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  pointAt(bot, server);
+
+  CHECK(bot.getMe());
+  CHECK(bot.userName == "host_bot");
+  CHECK(bot.name == "Host");
+  std::vector<ReplayRequest> requests = server.requests();
+  CHECK_EQUAL(1, requests.size());
+  CHECK_CONTAINS(requests[0].requestLine, "GET /bot123:token/getMe HTTP/1.1");
+}
+
+static void testSendMessage() {
+  ReplayServer server;
+  CHECK(server.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  pointAt(bot, server);
+
+  CHECK(bot.sendMessage("42", "Hello \"host\"", ""));
+  std::vector<ReplayRequest> requests = server.requests();
+  CHECK_EQUAL(1, requests.size());
+  CHECK(requests[0].method == "sendMessage");
+  CHECK_CONTAINS(requests[0].body, "\"chat_id\":\"42\"");
+  CHECK_CONTAINS(requests[0].body, "\"text\":\"Hello \\\"host\\\"\"");
+}
+
+static void testKeepAlive() {
+  ReplayServer server;
+  CHECK(server.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  pointAt(bot, server);
+
+  for (int i = 0; i < 5; i++) CHECK(bot.getMe());
+  CHECK_EQUAL(1, server.connections());
+  CHECK_EQUAL(1, client.connects);
+
+  bot.keepAlive = false;
+  for (int i = 0; i < 3; i++) CHECK(bot.getMe());
+  CHECK_EQUAL(4, server.connections());
+}
+
+static void testChunkedUpdates() {
+  ReplayServer server;
+  ReplayResponse updates;
+  updates.method = "getUpdates";
+  updates.chunked = true;
+  updates.body = "{\"ok\":true,\"result\":[{\"update_id\":5,\"message\":{\"message_id\":1,"
+                 "\"from\":{\"id\":9,\"first_name\":\"Ada\"},\"chat\":{\"id\":9,\"type\":\"private\"},"
+                 "\"date\":1700000000,\"text\":\"/start\"}}]}";
+  server.add(updates);
+  server.add(updates);
+  CHECK(server.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  pointAt(bot, server);
+
+  CHECK_EQUAL(1, bot.getUpdates(0));
+  CHECK(bot.messages[0].text == "/start");
+  CHECK(bot.messages[0].chat_id == "9");
+  CHECK_EQUAL(5, bot.last_message_received);
+
+  bot.streamUpdates = true;
+  bot.last_message_received = 0;
+  CHECK_EQUAL(1, bot.getUpdates(0));
+  CHECK(bot.messages[0].from_name == "Ada");
+}
+
+static void testSessionFile() {
+  ReplayServer server;
+  CHECK(server.parse("# comment\n"
+                     "@ getMe status=401\n"
+                     "{\"ok\":false,\"error_code\":401,\"description\":\"Unauthorized\"}\n"
+                     "\n"
+                     "@ sendMessage repeat delay=5\n"
+                     "{\"ok\":true,\"result\":{\"message_id\":3}}\n"));
+  CHECK(!server.parse("@ getMe nonsense\n"));
+  CHECK_EQUAL(1, server.pending());
+  CHECK(server.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  pointAt(bot, server);
+
+  CHECK(!bot.getMe());
+  CHECK_EQUAL(401, bot._lastError);
+  CHECK(bot.sendMessage("1", "a", ""));
+  CHECK(bot.sendMessage("1", "b", ""));
+  CHECK_EQUAL(0, server.pending());
+}
+
+int main() {
+  RUN_TEST(testGetMe);
+  RUN_TEST(testSendMessage);
+  RUN_TEST(testKeepAlive);
+  RUN_TEST(testChunkedUpdates);
+  RUN_TEST(testSessionFile);
+  return hostTestResult();
+}
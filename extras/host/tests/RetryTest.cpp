@@ -0,0 +1,108 @@
+// Failed sends are tried again against a scripted server, as often and as
+// late as retryPolicy says
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static const char *SENT = "{\"ok\":true,\"result\":{\"message_id\":7}}";
+
+static ReplayResponse answer(int status, const char *body) {
+  ReplayResponse response;
+  response.method = "sendMessage";
+  response.status = status;
+  response.body = body;
+  return response;
+}
+
+static void setUp(UniversalTelegramBot &bot, ReplayServer &server) {
+  CHECK(server.start());
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  // Short backoffs keep the test quick, a 429 still waits its retry_after
+  bot.retryPolicy.baseDelay = 10;
+}
+
+static void testServerErrorIsRetried() {
+  ReplayServer server;
+  server.add(answer(500, "{\"ok\":false,\"error_code\":500,\"description\":\"Internal Server Error\"}"));
+  ReplayResponse dropped = answer(200, "");
+  dropped.drop = true;
+  server.add(dropped);
+  server.add(answer(200, SENT));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  CHECK(bot.sendMessage("9", "hello"));
+  CHECK_EQUAL(7, bot.last_sent_message_id);
+  CHECK_EQUAL(3, server.requestCount());
+  CHECK_EQUAL(0, server.pending());
+}
+
+static void testRateLimitWaitsRetryAfter() {
+  ReplayServer server;
+  server.add(answer(429, "{\"ok\":false,\"error_code\":429,\"description\":\"Too Many Requests: retry after 1\","
+                         "\"parameters\":{\"retry_after\":1}}"));
+  server.add(answer(200, SENT));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  unsigned long start = millis();
+  CHECK(bot.sendMessage("9", "hello"));
+  CHECK(millis() - start >= 1000);
+  CHECK_EQUAL(2, server.requestCount());
+}
+
+static void testRateLimitTooLongIsNotWaited() {
+  ReplayServer server;
+  server.add(answer(429, "{\"ok\":false,\"error_code\":429,\"description\":\"Too Many Requests: retry after 30\","
+                         "\"parameters\":{\"retry_after\":30}}"));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  CHECK(!bot.sendMessage("9", "hello"));
+  CHECK_EQUAL(429, bot._lastError);
+  CHECK_EQUAL(30, bot.lastResponse.retry_after);
+  CHECK_EQUAL(1, server.requestCount());
+}
+
+static void testClientErrorIsNotRetried() {
+  ReplayServer server;
+  server.add(answer(400, "{\"ok\":false,\"error_code\":400,\"description\":\"Bad Request: chat not found\"}"));
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+
+  CHECK(!bot.sendMessage("9", "hello"));
+  CHECK_EQUAL(400, bot._lastError);
+  CHECK_EQUAL(1, server.requestCount());
+}
+
+static void testGivesUpAfterMaxAttempts() {
+  ReplayServer server;
+  ReplayResponse failing = answer(502, "{\"ok\":false,\"error_code\":502,\"description\":\"Bad Gateway\"}");
+  failing.repeat = true;
+  server.add(failing);
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  setUp(bot, server);
+  bot.retryPolicy.maxAttempts = 4;
+
+  CHECK(!bot.sendMessage("9", "hello"));
+  CHECK_EQUAL(502, bot._lastError);
+  CHECK_EQUAL(4, server.requestCount());
+}
+
+int main() {
+  RUN_TEST(testServerErrorIsRetried);
+  RUN_TEST(testRateLimitWaitsRetryAfter);
+  RUN_TEST(testRateLimitTooLongIsNotWaited);
+  RUN_TEST(testClientErrorIsNotRetried);
+  RUN_TEST(testGivesUpAfterMaxAttempts);
+  return hostTestResult();
+}
@@ -0,0 +1,75 @@
+// Commands are dispatched from a table declared like the examples do
+
+#include <UniversalTelegramBot.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string called;
+static std::string arguments;
+
+static void onStart(UniversalTelegramBot &, telegramMessage &, const char *args) {
+  called = "start";
+  arguments = args;
+}
+
+static void onLights(UniversalTelegramBot &, telegramMessage &, const char *args) {
+  called = "lights";
+  arguments = args;
+}
+
+static void onOther(UniversalTelegramBot &, telegramMessage &message, const char *) {
+  called = std::string("other:") + message.text.c_str();
+}
+
+const TelegramCommand commands[] PROGMEM = {
+  TELEGRAM_COMMAND("start", "Say \"hello\"", onStart),
+  TELEGRAM_COMMAND("lights", nullptr, onLights),
+};
+
+static bool dispatch(UniversalTelegramBot &bot, const TelegramCommandRouter &router, const char *text,
+                     TelegramUpdateType type = TELEGRAM_UPDATE_MESSAGE) {
+  telegramMessage message;
+  message.text = text;
+  message.update_type = type;
+  called.clear();
+  arguments.clear();
+  return router.dispatch(bot, message);
+}
+
+static void testDispatch() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  TelegramCommandRouter router(commands);
+
+  CHECK(dispatch(bot, router, "/start"));
+  CHECK(called == "start");
+  CHECK(dispatch(bot, router, "/lights  on"));
+  CHECK(called == "lights");
+  CHECK(arguments == "on");
+  CHECK(dispatch(bot, router, "lights off", TELEGRAM_UPDATE_CALLBACK_QUERY));
+  CHECK(called == "lights");
+  CHECK(!dispatch(bot, router, "/startx"));
+  CHECK(!dispatch(bot, router, "/star"));
+  CHECK(!dispatch(bot, router, "/start", TELEGRAM_UPDATE_EDITED_MESSAGE));
+
+  bot.userName = "host_bot";
+  CHECK(dispatch(bot, router, "/start@Host_Bot now"));
+  CHECK(arguments == "now");
+  CHECK(!dispatch(bot, router, "/start@other_bot"));
+
+  router.fallback = onOther;
+  CHECK(dispatch(bot, router, "hello"));
+  CHECK(called == "other:hello");
+}
+
+static void testCommandsJson() {
+  TelegramCommandRouter router(commands);
+  CHECK(router.commandsJson() == "[{\"command\":\"start\",\"description\":\"Say \\\"hello\\\"\"}]");
+}
+
+int main() {
+  RUN_TEST(testDispatch);
+  RUN_TEST(testCommandsJson);
+  return hostTestResult();
+}
@@ -0,0 +1,98 @@
+// Messages of the send queue in flight on a pipelined connection survive a
+// synchronous call in between
+
+#include <UniversalTelegramBot.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static const char *GET_ME = "{\"ok\":true,\"result\":{\"id\":7,\"is_bot\":true,\"first_name\":\"Host\",\"username\":\"host_bot\"}}";
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static std::string sentMessage(int id) {
+  return "{\"ok\":true,\"result\":{\"message_id\":" + std::to_string(id) + "}}";
+}
+
+static int count(const std::string &text, const char *what) {
+  int found = 0;
+  for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) found++;
+  return found;
+}
+
+static int delivered = 0;
+static int failed = 0;
+
+static void onSent(UniversalTelegramBot &, int error, const String &) {
+  if (error == TELEGRAM_ERROR_NONE)
+    delivered++;
+  else
+    failed++;
+}
+
+static int updatesCalls = 0;
+
+static void onUpdates(UniversalTelegramBot &, int) {
+  updatesCalls++;
+}
+
+static void testSyncCallWaitsForPipelinedMessages() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.pipelineDepth = 3;
+  bot.waitForResponse = 200;
+  delivered = failed = 0;
+
+  CHECK(bot.queueMessage("1", "one", "", onSent));
+  CHECK(bot.queueMessage("2", "two", "", onSent));
+  CHECK(bot.queueMessage("3", "three", "", onSent));
+  client.hold(response(sentMessage(1)) + response(sentMessage(2)) + response(sentMessage(3)));
+  bot.loop();
+  CHECK_EQUAL(3, count(client.sent, "POST /bot123:token/sendMessage"));
+  CHECK_EQUAL(3, bot.pendingRequests());
+
+  // The answers arrive while the sketch makes a synchronous call
+  client.release();
+  client.answerNext(response(GET_ME));
+  CHECK(bot.getMe());
+  CHECK_EQUAL(3, delivered);
+  CHECK_EQUAL(0, failed);
+  CHECK_EQUAL(0, bot.outgoingMessages());
+  CHECK_EQUAL(0, bot.pendingRequests());
+  CHECK_EQUAL(1, client.connects);
+
+  // Nothing is sent twice
+  for (int i = 0; i < 10; i++) bot.loop();
+  CHECK_EQUAL(3, count(client.sent, "POST /bot123:token/sendMessage"));
+}
+
+static void testSyncCallAbortsLongPoll() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.longPoll = 30;
+  updatesCalls = 0;
+
+  CHECK(bot.fetchUpdatesAsync(onUpdates));
+  bot.loop();
+  CHECK_EQUAL(1, count(client.sent, "GET /bot123:token/getUpdates"));
+
+  client.answerNext(response(GET_ME));
+  unsigned long start = millis();
+  CHECK(bot.getMe());
+  CHECK(millis() - start < 1000);
+  CHECK_EQUAL(1, updatesCalls);
+  CHECK_EQUAL(0, bot.pendingRequests());
+}
+
+int main() {
+  RUN_TEST(testSyncCallWaitsForPipelinedMessages);
+  RUN_TEST(testSyncCallAbortsLongPoll);
+  return hostTestResult();
+}
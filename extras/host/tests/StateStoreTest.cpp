@@ -0,0 +1,115 @@
+// A bot restarted with the same state file picks up after the last update
+// it acknowledged, without asking getMe for its name again
+
+#include <UniversalTelegramBot.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static std::string response(const std::string &body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)body.size());
+  return std::string(head) + body;
+}
+
+static std::string update(long id, const char *text) {
+  return "{\"update_id\":" + std::to_string(id) +
+         ",\"message\":{\"message_id\":1,\"from\":{\"id\":9,\"first_name\":\"Ada\"},"
+         "\"chat\":{\"id\":9,\"type\":\"private\"},\"date\":1,\"text\":\"" + text + "\"}}";
+}
+
+// A fresh file in the temporary directory, removed again by the test
+static std::string tempPath() {
+  char path[] = "/tmp/telegram-state-XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  unlink(path);
+  return path;
+}
+
+static void testRestartResumes() {
+  std::string path = tempPath();
+  {
+    MockClient client;
+    UniversalTelegramBot bot("123:token", client, 4);
+    TelegramFileStateStore store(path.c_str());
+    bot.stateStore = &store;
+    bot.persistInterval = 0;
+    CHECK(!bot.restoreState());
+
+    client.answerNext(response("{\"ok\":true,\"result\":{\"id\":123,\"is_bot\":true,"
+                               "\"first_name\":\"Greenhouse\",\"username\":\"greenhouse_bot\"}}"));
+    CHECK(bot.getMe());
+    client.answerNext(response("{\"ok\":true,\"result\":[" + update(41, "/start") + "," + update(42, "/status") + "]}"));
+    CHECK_EQUAL(2, bot.fetchUpdates());
+    bot.ackMessage();
+    CHECK(bot.persistState());
+  }
+
+  // After the reboot, the unacknowledged update is asked for again
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client, 4);
+  TelegramFileStateStore store(path.c_str());
+  bot.stateStore = &store;
+  CHECK(bot.restoreState());
+  CHECK(bot.name == "Greenhouse");
+  CHECK(bot.userName == "greenhouse_bot");
+  CHECK_EQUAL(41, bot.last_message_acked);
+
+  client.answerNext(response("{\"ok\":true,\"result\":[" + update(42, "/status") + "]}"));
+  CHECK_EQUAL(1, bot.fetchUpdates());
+  CHECK_CONTAINS(client.sent, "getUpdates?offset=42");
+  CHECK(bot.nextMessage()->text == "/status");
+
+  unlink(path.c_str());
+}
+
+static void testOtherStateIsIgnored() {
+  std::string path = tempPath();
+  TelegramFileStateStore store(path.c_str());
+  {
+    MockClient client;
+    UniversalTelegramBot bot("123:token", client);
+    bot.stateStore = &store;
+    client.answerNext(response("{\"ok\":true,\"result\":[" + update(7, "hi") + "]}"));
+    CHECK_EQUAL(1, bot.fetchUpdates());
+    bot.ackMessage();
+    CHECK(bot.persistState());
+  }
+
+  // Kept for another token
+  MockClient client;
+  UniversalTelegramBot other("456:token", client);
+  other.stateStore = &store;
+  CHECK(!other.restoreState());
+
+  // Damaged on the way
+  FILE *file = fopen(path.c_str(), "r+b");
+  CHECK(file != nullptr);
+  fseek(file, offsetof(TelegramBotState, lastAcked), SEEK_SET);
+  fputc(0x55, file);
+  fclose(file);
+  UniversalTelegramBot same("123:token", client);
+  same.stateStore = &store;
+  CHECK(!same.restoreState());
+  CHECK_EQUAL(0, same.last_message_acked);
+
+  // Cut short
+  CHECK(truncate(path.c_str(), sizeof(TelegramBotState) / 2) == 0);
+  CHECK(!same.restoreState());
+
+  unlink(path.c_str());
+}
+
+int main() {
+  RUN_TEST(testRestartResumes);
+  RUN_TEST(testOtherStateIsIgnored);
+  return hostTestResult();
+}
@@ -0,0 +1,66 @@
+// Streamed getUpdates never holds the body, its peak heap stays far below
+// the buffered one for an update carrying fields the bot doesn't read
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static std::string bigUpdate() {
+  std::string preview(4000, 'p');
+  return "{\"ok\":true,\"result\":[{\"update_id\":77,\"message\":{\"message_id\":5,"
+         "\"from\":{\"id\":9,\"is_bot\":false,\"first_name\":\"Ada\",\"language_code\":\"en\"},"
+         "\"chat\":{\"id\":9,\"first_name\":\"Ada\",\"type\":\"private\"},\"date\":1700000000,"
+         "\"text\":\"look at this\",\"link_preview_options\":{\"url\":\"https://example.com/" + preview +
+         "\"}}}]}";
+}
+
+// Peak heap of one getUpdates after a first one put the buffers in place
+static size_t peakOfGetUpdates(bool streamed) {
+  ReplayServer server;
+  ReplayResponse updates;
+  updates.method = "getUpdates";
+  updates.body = bigUpdate();
+  updates.repeat = true;
+  server.add(updates);
+  CHECK(server.start());
+
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  bot.maxMessageLength = 16384;
+  bot.streamUpdates = streamed;
+
+  HostHeap::track(true);
+  CHECK_EQUAL(1, bot.getUpdates(0));
+  // The server answers the same update again
+  bot.last_message_received = 0;
+  HostHeapSample sample;
+  CHECK_EQUAL(1, bot.getUpdates(0));
+  size_t peak = sample.peak();
+  HostHeap::track(false);
+
+  CHECK(bot.messages[0].text == "look at this");
+  CHECK(bot.messages[0].from_name == "Ada");
+  return peak;
+}
+
+static void testStreamingPeakHeap() {
+  size_t body = bigUpdate().size();
+  size_t buffered = peakOfGetUpdates(false);
+  size_t streamed = peakOfGetUpdates(true);
+  printf("body %u bytes, peak heap buffered %u, streamed %u\n", (unsigned)body, (unsigned)buffered,
+         (unsigned)streamed);
+
+  // The buffered call holds the whole body in a String
+  CHECK(buffered >= body);
+  CHECK(streamed < body / 8);
+}
+
+int main() {
+  RUN_TEST(testStreamingPeakHeap);
+  return hostTestResult();
+}
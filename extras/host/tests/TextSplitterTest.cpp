@@ -0,0 +1,119 @@
+// Long texts are cut into parts Telegram accepts: counted in UTF-16 units,
+// on line breaks, and with the markup of every part balanced
+
+#include <UniversalTelegramBot.h>
+
+#include <vector>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static size_t utf16Units(const std::string &text) {
+  size_t units = 0;
+  for (unsigned char c : text) {
+    if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+  }
+  return units;
+}
+
+static int count(const std::string &text, const char *what) {
+  int found = 0;
+  for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) found++;
+  return found;
+}
+
+// Every part with the markup around it, as it is sent
+static std::vector<std::string> split(const std::string &text, const char *parseMode, size_t maxUnits,
+                                      std::string *joined = nullptr) {
+  TelegramTextSplitter splitter(text.c_str(), text.size(), parseMode, maxUnits);
+  std::vector<std::string> parts;
+  const char *part;
+  size_t length;
+  while (splitter.next(part, length)) {
+    parts.push_back(std::string(splitter.opening().c_str()) + std::string(part, length) +
+                    splitter.closing().c_str());
+    if (joined != nullptr) joined->append(part, length);
+    CHECK(utf16Units(parts.back()) <= maxUnits);
+  }
+  return parts;
+}
+
+static void testSurrogatePairs() {
+  // U+1F600 takes four bytes of UTF-8 and two units of UTF-16
+  std::string text;
+  for (int i = 0; i < 25; i++) text += "\xF0\x9F\x98\x80";
+  std::string joined;
+  std::vector<std::string> parts = split(text, "", 10, &joined);
+  CHECK_EQUAL(5, parts.size());
+  for (const std::string &part : parts) CHECK_EQUAL(20, part.size());
+  CHECK(joined == text);
+
+  // Fits when counted in units, although it has more bytes
+  CHECK_EQUAL(1, split(text.substr(0, 20), "", 10).size());
+}
+
+static void testCutsAtLineBreaks() {
+  std::string text;
+  for (int i = 0; i < 10; i++) text += "line " + std::to_string(i) + " with some words in it\n";
+  std::vector<std::string> parts = split(text, "", 100);
+  CHECK(parts.size() > 1);
+  for (size_t i = 0; i + 1 < parts.size(); i++) CHECK_EQUAL('\n', parts[i].back());
+  CHECK_EQUAL(0, parts[1].find("line "));
+}
+
+static void testLongHtmlPre() {
+  std::string log;
+  for (int i = 0; i < 40; i++) log += "  12:00:" + std::to_string(10 + i) + " sensor " + std::to_string(i) + " ok\n";
+  std::string text = "<b>Log</b>\n<pre><code class=\"language-text\">" + log + "</code></pre>";
+  std::string joined;
+  std::vector<std::string> parts = split(text, "HTML", 200, &joined);
+  CHECK(parts.size() > 3);
+  for (const std::string &part : parts) {
+    CHECK_EQUAL(count(part, "<pre>"), count(part, "</pre>"));
+    CHECK_EQUAL(count(part, "<code"), count(part, "</code>"));
+  }
+  CHECK_EQUAL(0, parts[1].find("<pre><code class=\"language-text\">"));
+  // The indentation inside the block survives the cuts
+  CHECK_CONTAINS(parts[2], "\">  12:00:");
+  CHECK(joined == text);
+}
+
+static void testLongMarkdownFence() {
+  std::string code;
+  for (int i = 0; i < 40; i++) code += "print(" + std::to_string(i) + ")\n";
+  std::string text = "Output:\n```python\n" + code + "```";
+  std::vector<std::string> parts = split(text, "MarkdownV2", 150);
+  CHECK(parts.size() > 2);
+  for (const std::string &part : parts) CHECK_EQUAL(0, count(part, "```") % 2);
+  for (size_t i = 1; i < parts.size(); i++) CHECK_EQUAL(0, parts[i].find("```python\nprint("));
+}
+
+static void testNestedStylesAreReopened() {
+  std::string words;
+  for (int i = 0; i < 60; i++) words += "word ";
+  std::vector<std::string> parts = split("<b>bold <i>" + words + "</i></b>", "html", 100);
+  CHECK(parts.size() > 2);
+  for (size_t i = 1; i + 1 < parts.size(); i++) {
+    CHECK_EQUAL(0, parts[i].find("<b><i>"));
+    CHECK(parts[i].size() >= 8 && parts[i].substr(parts[i].size() - 8) == "</i></b>");
+  }
+}
+
+static void testWhitespaceIsNotSent() {
+  CHECK_EQUAL(0, split(std::string(5000, ' '), "", 4096).size());
+
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  CHECK(!bot.sendMessage("9", String(std::string(5000, '\n').c_str())));
+  CHECK(client.sent.empty());
+}
+
+int main() {
+  RUN_TEST(testSurrogatePairs);
+  RUN_TEST(testCutsAtLineBreaks);
+  RUN_TEST(testLongHtmlPre);
+  RUN_TEST(testLongMarkdownFence);
+  RUN_TEST(testNestedStylesAreReopened);
+  RUN_TEST(testWhitespaceIsNotSent);
+  return hostTestResult();
+}
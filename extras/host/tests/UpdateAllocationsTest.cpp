@@ -0,0 +1,77 @@
+// Heap allocations per update, for getUpdates filling telegramMessage
+// Strings and for getCompactUpdates keeping them in its arena. The cost of
+// one update is told apart from the request's own by comparing a batch of
+// one update with a batch of eight
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostHeap.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+static const int BATCH = 8;
+
+static std::string updates(int count) {
+  std::string body = "{\"ok\":true,\"result\":[";
+  for (int i = 1; i <= count; i++) {
+    if (i > 1) body += ",";
+    body += "{\"update_id\":" + std::to_string(i) +
+            ",\"message\":{\"message_id\":" + std::to_string(i) +
+            ",\"from\":{\"id\":9,\"is_bot\":false,\"first_name\":\"Ada\"},"
+            "\"chat\":{\"id\":-1001,\"title\":\"Workshop\",\"type\":\"supergroup\"},\"date\":1700000000,"
+            "\"text\":\"/status of the furnace in the workshop\"}}";
+  }
+  return body + "]}";
+}
+
+// Allocations of one call returning count updates, after a first call put
+// the buffers in place
+static unsigned long allocationsFor(int count, bool compact) {
+  ReplayServer server;
+  ReplayResponse answer;
+  answer.method = "getUpdates";
+  answer.body = updates(count);
+  answer.repeat = true;
+  server.add(answer);
+  CHECK(server.start());
+
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client, BATCH);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = server.port();
+  bot.maxMessageLength = 16384;
+
+  HostHeap::track(true);
+  unsigned long allocations = 0;
+  for (int run = 0; run < 2; run++) {
+    // The server answers the same updates again
+    bot.last_message_received = 0;
+    HostHeapSample sample;
+    CHECK_EQUAL(count, compact ? bot.getCompactUpdates(0) : bot.getUpdates(0));
+    allocations = sample.allocations();
+  }
+  HostHeap::track(false);
+
+  if (compact) {
+    CHECK(strcmp(bot.updates[count - 1].chat_title, "Workshop") == 0);
+  } else {
+    CHECK(bot.messages[count - 1].chat_title == "Workshop");
+  }
+  return allocations;
+}
+
+static void testAllocationsPerUpdate() {
+  double messages = (allocationsFor(BATCH, false) - allocationsFor(1, false)) / double(BATCH - 1);
+  double compact = (allocationsFor(BATCH, true) - allocationsFor(1, true)) / double(BATCH - 1);
+  printf("allocations per update: getUpdates %.1f, getCompactUpdates %.1f\n", messages, compact);
+
+  // The strings of a compact update are views into the arena
+  CHECK(messages >= 1);
+  CHECK(compact == 0);
+}
+
+int main() {
+  RUN_TEST(testAllocationsPerUpdate);
+  return hostTestResult();
+}
@@ -0,0 +1,99 @@
+// Multipart uploads send exactly the Content-Length they announce
+
+#include <UniversalTelegramBot.h>
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "HostTest.h"
+#include "MockClient.h"
+
+static const char *SENT = "{\"ok\":true,\"result\":{\"message_id\":12}}";
+
+static std::string response(const char *body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Connection: keep-alive\r\n\r\n",
+           (unsigned)strlen(body));
+  return std::string(head) + body;
+}
+
+// The body of the request in client.sent, and its Content-Length
+static std::string requestBody(const MockClient &client, long &contentLength) {
+  size_t headEnd = client.sent.find("\r\n\r\n");
+  size_t length = client.sent.find("Content-Length:");
+  contentLength = length == std::string::npos ? -1 : atol(client.sent.c_str() + length + 15);
+  return headEnd == std::string::npos ? std::string() : client.sent.substr(headEnd + 4);
+}
+
+// A camera-like source handing out 100 byte buffers
+static uint8_t frame[100];
+static int buffersLeft = 0;
+
+static bool moreData() {
+  return buffersLeft > 0;
+}
+
+static byte *nextBuffer() {
+  buffersLeft--;
+  return frame;
+}
+
+static int nextBufferLength() {
+  return sizeof(frame);
+}
+
+static void testLastBufferIsClamped() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  memset(frame, 0x01, sizeof(frame));
+  buffersLeft = 3;
+
+  client.answerNext(response(SENT));
+  String answer = bot.sendPhotoByBinary("9", "image/jpeg", 250, moreData, nullptr, nextBuffer, nextBufferLength);
+  CHECK(answer.indexOf("\"message_id\":12") >= 0);
+
+  long contentLength;
+  std::string body = requestBody(client, contentLength);
+  CHECK_EQUAL(contentLength, body.size());
+  CHECK_EQUAL(250, std::count(body.begin(), body.end(), '\x01'));
+  CHECK_CONTAINS(client.sent, "User-Agent: arduino/1.0\r\n");
+  CHECK_CONTAINS(client.sent, "Accept: */*\r\n");
+}
+
+static void testShortSourceFails() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  buffersLeft = 2;
+
+  String answer = bot.sendPhotoByBinary("9", "image/jpeg", 250, moreData, nullptr, nextBuffer, nextBufferLength);
+  CHECK(answer == "");
+  CHECK_EQUAL(TELEGRAM_ERROR_UPLOAD_INCOMPLETE, bot._lastError);
+}
+
+static void testMemoryUpload() {
+  MockClient client;
+  UniversalTelegramBot bot("123:token", client);
+  static uint8_t data[5000];
+  memset(data, 'd', sizeof(data));
+
+  TelegramUpload upload;
+  CHECK(upload.addField("chat_id", "9"));
+  CHECK(upload.addFile("document", "data.bin", "application/octet-stream", data, sizeof(data)));
+  client.answerNext(response(SENT));
+  CHECK(bot.sendMultipart("sendDocument", upload).indexOf("\"ok\":true") >= 0);
+
+  long contentLength;
+  std::string body = requestBody(client, contentLength);
+  CHECK_EQUAL(contentLength, body.size());
+  CHECK_CONTAINS(body, "name=\"document\"; filename=\"data.bin\"");
+}
+
+int main() {
+  RUN_TEST(testLastBufferIsClamped);
+  RUN_TEST(testShortSourceFails);
+  RUN_TEST(testMemoryUpload);
+  return hostTestResult();
+}
@@ -0,0 +1,148 @@
+// Updates POSTed to a webhook listening on localhost are queued and
+// answered like Telegram expects
+
+#include <UniversalTelegramBot.h>
+
+#include "HostClient.h"
+#include "HostTest.h"
+#include "ReplayServer.h"
+
+// Two of the updates recorded in sessions/benchmark.txt
+static const char *COMMAND =
+    "{\"update_id\":810000001,\"message\":{\"message_id\":101,\"from\":{\"id\":123456789,\"is_bot\":false,"
+    "\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"username\":\"ada_l\",\"language_code\":\"en\"},"
+    "\"chat\":{\"id\":123456789,\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"username\":\"ada_l\","
+    "\"type\":\"private\"},\"date\":1700000100,\"text\":\"/start\","
+    "\"entities\":[{\"offset\":0,\"length\":6,\"type\":\"bot_command\"}]}}";
+static const char *CALLBACK =
+    "{\"update_id\":810000003,\"callback_query\":{\"id\":\"4382bfdwdsb323b2d9\",\"from\":{\"id\":123456789,"
+    "\"is_bot\":false,\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"username\":\"ada_l\","
+    "\"language_code\":\"en\"},\"message\":{\"message_id\":103,\"from\":{\"id\":5012345678,\"is_bot\":true,"
+    "\"first_name\":\"Benchmark\",\"username\":\"benchmark_bot\"},\"chat\":{\"id\":123456789,"
+    "\"first_name\":\"Ada\",\"last_name\":\"Lovelace\",\"username\":\"ada_l\",\"type\":\"private\"},"
+    "\"date\":1700000110,\"text\":\"Lights\"},\"chat_instance\":\"-3522516094876342512\","
+    "\"data\":\"lights_on\"}}";
+
+static const char *SECRET = "host-test_secret";
+
+// Sends a request to the webhook the way Telegram would, hands the
+// connection to the bot and returns the answer it got
+static std::string deliver(UniversalTelegramBot &bot, HostServer &webhook, const char *method,
+                           const std::string &body, const char *secret, int &queued) {
+  HostClient telegram;
+  CHECK(telegram.connect("127.0.0.1", webhook.port()));
+  std::string request = std::string(method) + " /telegram HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                        "Content-Type: application/json\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\n";
+  if (secret != nullptr) request += std::string(TELEGRAM_SECRET_TOKEN_HEADER ": ") + secret + "\r\n";
+  request += "\r\n" + body;
+  CHECK_EQUAL(request.size(), telegram.write((const uint8_t *)request.data(), request.size()));
+
+  HostClient accepted;
+  unsigned long start = millis();
+  while (!accepted.connected() && millis() - start < 1000) accepted = webhook.available();
+  CHECK(accepted.connected());
+  queued = bot.handleWebhook(accepted);
+
+  std::string answer;
+  start = millis();
+  while (telegram.connected() && millis() - start < 1000) {
+    int c = telegram.read();
+    if (c >= 0) answer += (char)c;
+  }
+  return answer;
+}
+
+static void testRecordedUpdatesAreQueued() {
+  ReplayServer api;
+  CHECK(api.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client, 4);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = api.port();
+  CHECK(bot.setWebhook("https://example.com/telegram", SECRET));
+
+  HostServer webhook;
+  CHECK(webhook.begin());
+  int queued = 0;
+  std::string answer = deliver(bot, webhook, "POST", COMMAND, SECRET, queued);
+  CHECK_CONTAINS(answer, "HTTP/1.1 200 OK\r\n");
+  CHECK_EQUAL(1, queued);
+  answer = deliver(bot, webhook, "POST", CALLBACK, SECRET, queued);
+  CHECK_CONTAINS(answer, "HTTP/1.1 200 OK\r\n");
+  CHECK_EQUAL(1, queued);
+
+  CHECK_EQUAL(2, bot.queuedMessages());
+  telegramMessage *message = bot.nextMessage();
+  CHECK(message->text == "/start");
+  CHECK(message->chat_id == "123456789");
+  CHECK(message->from_name == "Ada");
+  bot.ackMessage();
+  message = bot.nextMessage();
+  CHECK_EQUAL(TELEGRAM_UPDATE_CALLBACK_QUERY, message->update_type);
+  CHECK(message->text == "lights_on");
+  CHECK(message->query_id == "4382bfdwdsb323b2d9");
+  bot.ackMessage();
+
+  // Telegram delivering an update again does not queue it twice
+  answer = deliver(bot, webhook, "POST", CALLBACK, SECRET, queued);
+  CHECK_CONTAINS(answer, "HTTP/1.1 200 OK\r\n");
+  CHECK_EQUAL(0, queued);
+  CHECK_EQUAL(0, bot.queuedMessages());
+}
+
+static void testOtherRequestsAreRefused() {
+  ReplayServer api;
+  CHECK(api.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = api.port();
+  CHECK(bot.setWebhook("https://example.com/telegram", SECRET));
+
+  HostServer webhook;
+  CHECK(webhook.begin());
+  int queued = 0;
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, nullptr, queued), "HTTP/1.1 401 Unauthorized\r\n");
+  CHECK_EQUAL(0, queued);
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, "guessed", queued), "HTTP/1.1 401 Unauthorized\r\n");
+  CHECK_EQUAL(0, queued);
+  CHECK_CONTAINS(deliver(bot, webhook, "GET", "", SECRET, queued), "HTTP/1.1 405 Method Not Allowed\r\n");
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", "{\"update_id\":", SECRET, queued), "HTTP/1.1 400 Bad Request\r\n");
+  CHECK_EQUAL(0, bot.queuedMessages());
+}
+
+static void testNoSecretRefusesEverything() {
+  ReplayServer api;
+  api.add("setWebhook", "{\"ok\":false,\"error_code\":400,\"description\":\"Bad Request: bad webhook\"}", 400);
+  CHECK(api.start());
+  HostClient client;
+  UniversalTelegramBot bot("123:token", client);
+  bot.serverHost = "127.0.0.1";
+  bot.serverPort = api.port();
+  bot.retryPolicy.baseDelay = 10;
+
+  HostServer webhook;
+  CHECK(webhook.begin());
+  int queued = 0;
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, nullptr, queued), "HTTP/1.1 403 Forbidden\r\n");
+  CHECK_EQUAL(0, queued);
+
+  // A failed setWebhook leaves the bot without a secret
+  CHECK(!bot.setWebhook("https://example.com/telegram", SECRET));
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, SECRET, queued), "HTTP/1.1 403 Forbidden\r\n");
+  CHECK_EQUAL(0, queued);
+
+  // After a reboot the webhook Telegram holds is served with its secret
+  bot.setWebhookSecret(SECRET);
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, SECRET, queued), "HTTP/1.1 200 OK\r\n");
+  CHECK_EQUAL(1, queued);
+  CHECK_CONTAINS(deliver(bot, webhook, "POST", COMMAND, "guessed", queued), "HTTP/1.1 401 Unauthorized\r\n");
+}
+
+int main() {
+  RUN_TEST(testRecordedUpdatesAreQueued);
+  RUN_TEST(testOtherRequestsAreRefused);
+  RUN_TEST(testNoSecretRefusesEverything);
+  return hostTestResult();
+}
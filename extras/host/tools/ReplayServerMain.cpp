@@ -0,0 +1,65 @@
+// Serves a recorded session to a bot on this machine or on the LAN, for
+// instance to the Benchmark example built with FAKE_SERVER_HOST
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ReplayServer.h"
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal(int) {
+  stopping = 1;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [-p port] [-a] [-v] session\n"
+          "  -p port  port to listen on, 8080 by default\n"
+          "  -a       listen on every interface, not only on loopback\n"
+          "  -v       print every request\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  uint16_t port = 8080;
+  bool anyInterface = false;
+  bool verbose = false;
+  int option;
+  while ((option = getopt(argc, argv, "p:av")) != -1) {
+    switch (option) {
+      case 'p': port = (uint16_t)atoi(optarg); break;
+      case 'a': anyInterface = true; break;
+      case 'v': verbose = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  ReplayServer server;
+  server.verbose = verbose;
+  if (!server.load(argv[optind])) {
+    fprintf(stderr, "cannot read session %s\n", argv[optind]);
+    return 1;
+  }
+  if (!server.start(port, anyInterface)) {
+    fprintf(stderr, "cannot listen on port %u\n", port);
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  printf("Replaying %s on port %u\n", argv[optind], server.port());
+  fflush(stdout);
+  while (!stopping) pause();
+
+  server.stop();
+  printf("%u requests over %u connections\n", (unsigned)server.requestCount(), server.connections());
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "TelegramCommandRouter.h"
+#include "UniversalTelegramBot.h"
+
+static uint32_t commandHash(const char *command, size_t length) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) hash = (hash ^ (uint8_t)command[i]) * 16777619UL;
+  return hash;
+}
+
+// Appends a string as a JSON string
+static void appendJsonString(String &json, const char *s) {
+  json += '"';
+  for (char c; (c = *s) != 0; s++) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+      json += c;
+    } else if ((uint8_t)c < 0x20) {
+      char escaped[7];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += c;
+    }
+  }
+  json += '"';
+}
+
+// Looks a command up by its hash, the name is only compared on a match.
+// Entries are read with the _P functions in case the table is in flash
+bool TelegramCommandRouter::find(const char *command, size_t length, TelegramCommand &entry) const {
+  uint32_t hash = commandHash(command, length);
+  for (size_t i = 0; i < _count; i++) {
+    if (pgm_read_dword(&_commands[i].hash) != hash) continue;
+    memcpy_P(&entry, &_commands[i], sizeof(entry));
+    if (strncmp(command, entry.command, length) == 0 && entry.command[length] == 0)
+      return true;
+  }
+  return false;
+}
+
+/***************************************************************
+ * Dispatch - calls the handler of the command the message     *
+ * starts with, or the fallback for any other message          *
+ * Returns false when neither was called, which includes       *
+ * commands addressed to another bot and edited messages       *
+ ***************************************************************/
+bool TelegramCommandRouter::dispatch(UniversalTelegramBot &bot, telegramMessage &message) const {
+  const char *text = message.text.c_str();
+  bool command = false;
+
+  switch (message.update_type) {
+    case TELEGRAM_UPDATE_MESSAGE:
+    case TELEGRAM_UPDATE_CHANNEL_POST:
+      command = *text == '/';
+      if (command) text++;
+      break;
+    case TELEGRAM_UPDATE_CALLBACK_QUERY:
+      command = true;
+      if (*text == '/') text++;
+      break;
+    default:
+      return false;
+  }
+
+  if (command) {
+    size_t length = strcspn(text, " @\n");
+    const char *args = text + length;
+    if (*args == '@') {
+      const char *botName = ++args;
+      args += strcspn(args, " \n");
+      size_t nameLength = args - botName;
+      if (bot.userName.length() > 0 &&
+          (nameLength != bot.userName.length() ||
+           strncasecmp(botName, bot.userName.c_str(), nameLength) != 0))
+        return false;
+    }
+    while (*args == ' ' || *args == '\n') args++;
+
+    TelegramCommand entry;
+    if (length > 0 && find(text, length, entry)) {
+      entry.handler(bot, message, args);
+      return true;
+    }
+  }
+
+  if (fallback == nullptr) return false;
+  fallback(bot, message, "");
+  return true;
+}
+
+// Dispatches the first numNewMessages of bot.messages, as returned by
+// getUpdates. Returns how many of them were handled
+int TelegramCommandRouter::dispatch(UniversalTelegramBot &bot, int numNewMessages) const {
+  int handled = 0;
+  for (int i = 0; i < numNewMessages; i++) {
+    if (dispatch(bot, bot.messages[i])) handled++;
+  }
+  return handled;
+}
+
+// JSON array of the commands that have a description, as taken by
+// setMyCommands()
+String TelegramCommandRouter::commandsJson() const {
+  String json;
+  json.reserve(32 * _count);
+  json += '[';
+  for (size_t i = 0; i < _count; i++) {
+    TelegramCommand entry;
+    memcpy_P(&entry, &_commands[i], sizeof(entry));
+    if (entry.description == nullptr) continue;
+
+    if (json.length() > 1) json += ',';
+    json += F("{\"command\":");
+    appendJsonString(json, entry.command);
+    json += F(",\"description\":");
+    appendJsonString(json, entry.description);
+    json += '}';
+  }
+  json += ']';
+  return json;
+}
@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TelegramCommandRouter_h
+#define TelegramCommandRouter_h
+
+#include <Arduino.h>
+
+class UniversalTelegramBot;
+struct telegramMessage;
+
+// Called for a command with the text following it, an empty string when
+// there is none
+typedef void (*TelegramCommandHandler)(UniversalTelegramBot &bot, telegramMessage &message, const char *args);
+
+// FNV-1a hash of a command name, evaluated by the compiler for the table
+constexpr uint32_t telegramCommandHash(const char *command, uint32_t hash = 2166136261UL) {
+  return *command ? telegramCommandHash(command + 1, (hash ^ (uint8_t)*command) * 16777619UL) : hash;
+}
+
+// Entry of a command table, the name without the leading '/'. Commands
+// without description are dispatched but left out of the bot menu
+struct TelegramCommand {
+  uint32_t hash;
+  const char *command;
+  const char *description;
+  TelegramCommandHandler handler;
+};
+
+#define TELEGRAM_COMMAND(command, description, handler) \
+  { telegramCommandHash(command), command, description, handler }
+
+/*
+   Dispatches messages to the handlers of a static command table. The
+   table can be declared PROGMEM, which keeps the hashes and pointers in
+   flash; the names and descriptions are plain string literals, which
+   boards such as the ESP8266 and AVR copy to RAM. "/cmd@botname" only
+   matches when botname is the bot's userName (as filled by getMe),
+   callback data matches with or without the '/'. The same table gives the
+   commands for setMyCommands()
+ */
+class TelegramCommandRouter {
+public:
+  TelegramCommandRouter(const TelegramCommand *commands, size_t count)
+      : _commands(commands), _count(count) {}
+  template <size_t N>
+  explicit TelegramCommandRouter(const TelegramCommand (&commands)[N])
+      : TelegramCommandRouter(commands, N) {}
+
+  bool dispatch(UniversalTelegramBot &bot, telegramMessage &message) const;
+  int dispatch(UniversalTelegramBot &bot, int numNewMessages) const;
+  String commandsJson() const;
+
+  // Told about messages and callback queries that are not a known command
+  TelegramCommandHandler fallback = nullptr;
+
+private:
+  const TelegramCommand *_commands;
+  size_t _count;
+
+  bool find(const char *command, size_t length, TelegramCommand &entry) const;
+};
+
+#endif
@@ -0,0 +1,439 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "TelegramHttp.h"
+
+TelegramHttpParser::TelegramHttpParser() {
+  reset();
+}
+
+void TelegramHttpParser::reset() {
+  _request = false;
+  post = false;
+  secretTokenValid = false;
+  statusCode = 0;
+  contentLength = -1;
+  chunked = false;
+  keepAlive = true;
+  keepAliveTimeout = 0;
+  _state = STATE_STATUS_LINE;
+  _error = TELEGRAM_ERROR_NONE;
+  _remaining = 0;
+  _lineLength = 0;
+  _overflow = 0;
+}
+
+void TelegramHttpParser::resetRequest() {
+  reset();
+  _request = true;
+}
+
+/***************************************************************
+ * Feed - advances the parser over a received block            *
+ * Stops after the headers and at the first run of body bytes, *
+ * which are the last bodyLength of the consumed ones          *
+ * Returns the number of bytes consumed                        *
+ ***************************************************************/
+size_t TelegramHttpParser::feed(const char *data, size_t length, size_t &bodyLength) {
+  size_t used = 0;
+
+  bodyLength = 0;
+  while (used < length) {
+    switch (_state) {
+      case STATE_BODY_UNTIL_CLOSE:
+        bodyLength = length - used;
+        return length;
+
+      case STATE_BODY:
+      case STATE_CHUNK_DATA:
+        bodyLength = length - used;
+        if (bodyLength > _remaining) bodyLength = _remaining;
+        _remaining -= bodyLength;
+        if (_remaining == 0)
+          _state = _state == STATE_BODY ? STATE_COMPLETE : STATE_CHUNK_DATA_END;
+        return used + bodyLength;
+
+      case STATE_COMPLETE:
+      case STATE_ERROR:
+        return used;
+
+      default: {
+        // Everything else is line based, look for the end of the line
+        const char *start = data + used;
+        const char *end = (const char *)memchr(start, '\n', length - used);
+        size_t lineLength = end != nullptr ? end - start : length - used;
+        size_t copied = TELEGRAM_HTTP_LINE_LENGTH - 1 - _lineLength;
+        if (copied > lineLength) copied = lineLength;
+        memcpy(_line + _lineLength, start, copied);
+        _lineLength += copied;
+        if (copied < lineLength) matchOverflow(start + copied, lineLength - copied);
+        used += lineLength;
+
+        if (end != nullptr) {
+          used++;
+          if (_lineLength > 0 && _line[_lineLength - 1] == '\r') _lineLength--;
+          _line[_lineLength] = '\0';
+          bool inHeaders = !headersComplete();
+          processLine();
+          _lineLength = 0;
+          _overflow = 0;
+          // Let the caller see where the headers end
+          if (inHeaders && headersComplete()) return used;
+        }
+        break;
+      }
+    }
+  }
+  return used;
+}
+
+// The connection was closed by the server
+void TelegramHttpParser::finish() {
+  if (_state == STATE_BODY_UNTIL_CLOSE) {
+    _state = STATE_COMPLETE;
+  } else if (_state != STATE_COMPLETE && _state != STATE_ERROR) {
+    fail(TELEGRAM_ERROR_CONNECTION_CLOSED);
+  }
+}
+
+void TelegramHttpParser::processLine() {
+  switch (_state) {
+    case STATE_STATUS_LINE:
+      processStatusLine();
+      break;
+
+    case STATE_HEADERS:
+      if (_lineLength == 0) endHeaders();
+      else processHeaderLine();
+      break;
+
+    case STATE_CHUNK_SIZE:
+      processChunkSize();
+      break;
+
+    case STATE_CHUNK_DATA_END:
+      // Chunk data is followed by an empty line
+      if (_lineLength == 0) _state = STATE_CHUNK_SIZE;
+      else fail(TELEGRAM_ERROR_MALFORMED_RESPONSE);
+      break;
+
+    case STATE_TRAILERS:
+      if (_lineLength == 0) _state = STATE_COMPLETE;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void TelegramHttpParser::processStatusLine() {
+  // Tolerate stray empty lines in front of the response
+  if (_lineLength == 0) return;
+
+  if (_request) {
+    // Request line, "POST /path HTTP/1.1"
+    const char *version = strstr(_line, " HTTP/1.");
+    if (version == nullptr) {
+      fail(TELEGRAM_ERROR_MALFORMED_RESPONSE);
+      return;
+    }
+    keepAlive = version[8] != '0';
+    post = strncmp(_line, "POST ", 5) == 0;
+    _state = STATE_HEADERS;
+    return;
+  }
+
+  if (strncmp(_line, "HTTP/1.", 7) != 0 || _lineLength < 12) {
+    fail(TELEGRAM_ERROR_MALFORMED_RESPONSE);
+    return;
+  }
+  // HTTP/1.0 closes the connection unless told otherwise
+  keepAlive = _line[7] != '0';
+  statusCode = atoi(_line + 9);
+  _state = STATE_HEADERS;
+}
+
+void TelegramHttpParser::processHeaderLine() {
+  char *value = strchr(_line, ':');
+  if (value == nullptr) return;
+  *value++ = '\0';
+  while (*value == ' ' || *value == '\t') value++;
+
+  if (strcasecmp(_line, "Content-Length") == 0) {
+    contentLength = atol(value);
+  } else if (strcasecmp(_line, "Transfer-Encoding") == 0) {
+    chunked = strstr(value, "chunked") != nullptr;
+  } else if (strcasecmp(_line, "Connection") == 0) {
+    if (strncasecmp(value, "close", 5) == 0) keepAlive = false;
+    else if (strncasecmp(value, "keep-alive", 10) == 0) keepAlive = true;
+  } else if (strcasecmp(_line, "Keep-Alive") == 0) {
+    const char *timeout = strstr(value, "timeout=");
+    if (timeout != nullptr) keepAliveTimeout = atoi(timeout + 8);
+  } else if (secretToken != nullptr && strcasecmp(_line, TELEGRAM_SECRET_TOKEN_HEADER) == 0) {
+    // Tokens can be longer than _line, the rest has been compared already
+    size_t inLine = strlen(value);
+    secretTokenValid = strncmp(value, secretToken, inLine) == 0 &&
+                       (_overflow == 0 || _overflowMatches) &&
+                       strlen(secretToken) == inLine + _overflow;
+  }
+}
+
+// Where the value of a secret token header starts in _line, or nullptr if
+// that is not the header being read
+const char *TelegramHttpParser::secretTokenValue(size_t lineLength) {
+  const size_t nameLength = sizeof(TELEGRAM_SECRET_TOKEN_HEADER) - 1;
+  if (_state != STATE_HEADERS || secretToken == nullptr || lineLength <= nameLength ||
+      strncasecmp(_line, TELEGRAM_SECRET_TOKEN_HEADER, nameLength) != 0 ||
+      _line[nameLength] != ':') return nullptr;
+
+  const char *value = _line + nameLength + 1;
+  while (*value == ' ' || *value == '\t') value++;
+  return value;
+}
+
+// Compares the part of a secret token header that did not fit into _line
+void TelegramHttpParser::matchOverflow(const char *data, size_t length) {
+  const char *value = secretTokenValue(_lineLength);
+
+  if (_overflow == 0) _overflowMatches = value != nullptr;
+  if (!_overflowMatches) return;
+
+  size_t tokenLength = strlen(secretToken);
+  size_t offset = (_line + _lineLength - value) + _overflow;
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == '\r') continue;
+    if (offset >= tokenLength || secretToken[offset] != data[i]) _overflowMatches = false;
+    offset++;
+    _overflow++;
+  }
+}
+
+void TelegramHttpParser::processChunkSize() {
+  // Chunk extensions after a ';' are ignored
+  char *end;
+  unsigned long size = strtoul(_line, &end, 16);
+  if (end == _line) {
+    fail(TELEGRAM_ERROR_MALFORMED_RESPONSE);
+  } else if (size == 0) {
+    _state = STATE_TRAILERS;
+  } else {
+    _remaining = size;
+    _state = STATE_CHUNK_DATA;
+  }
+}
+
+void TelegramHttpParser::endHeaders() {
+  if (_request) {
+    // A request without Content-Length or chunked encoding has no body
+    if (chunked) {
+      _state = STATE_CHUNK_SIZE;
+    } else if (contentLength > 0) {
+      _remaining = contentLength;
+      _state = STATE_BODY;
+    } else {
+      _state = STATE_COMPLETE;
+    }
+  } else if (statusCode >= 100 && statusCode < 200) {
+    // Interim response, the real one follows
+    reset();
+  } else if (statusCode == 204 || statusCode == 304) {
+    _state = STATE_COMPLETE;
+  } else if (chunked) {
+    _state = STATE_CHUNK_SIZE;
+  } else if (contentLength == 0) {
+    _state = STATE_COMPLETE;
+  } else if (contentLength > 0) {
+    _remaining = contentLength;
+    _state = STATE_BODY;
+  } else {
+    // No framing given, the body ends when the server closes the connection
+    keepAlive = false;
+    _state = STATE_BODY_UNTIL_CLOSE;
+  }
+}
+
+void TelegramHttpParser::fail(int error) {
+  _error = error;
+  keepAlive = false;
+  _state = STATE_ERROR;
+}
+
+// Reads a block if nothing is buffered, returns the number of bytes buffered
+size_t TelegramReadBuffer::fill(Client &client) {
+  if (_start == _end && client.available()) {
+    int received = client.read((uint8_t *)_data, TELEGRAM_READ_BUFFER_SIZE);
+    _start = 0;
+    _end = received > 0 ? received : 0;
+    _received += _end;
+    // Kept odd, 0 means nothing has arrived
+    if (_end > 0 && _firstBlock == 0) _firstBlock = millis() | 1;
+  }
+  return length();
+}
+
+void TelegramReadBuffer::consume(size_t length) {
+  _start += length;
+  if (_start >= _end) _start = _end = 0;
+}
+
+// Appends length buffered bytes starting at from, in one go
+void TelegramReadBuffer::appendTo(String &s, char *from, size_t length) {
+  if (length == 0) return;
+  char next = from[length];
+  from[length] = '\0';
+  s += from;
+  from[length] = next;
+}
+
+TelegramHttpBodyStream::TelegramHttpBodyStream(Client &client, TelegramHttpParser &parser,
+                                               TelegramReadBuffer &buffer)
+    : _client(client), _parser(parser), _buffer(buffer) {
+}
+
+/***************************************************************
+ * ReadHeaders - consumes the status line and headers          *
+ * Returns false if they did not arrive within the timeout     *
+ ***************************************************************/
+bool TelegramHttpBodyStream::readHeaders(unsigned long timeout) {
+  unsigned long start = millis();
+
+  while (!_parser.headersComplete()) {
+    if (_buffer.length() > 0 || _buffer.fill(_client) > 0) {
+      size_t bodyLength;
+      _buffer.consume(_parser.feed(_buffer.data(), _buffer.length(), bodyLength));
+      if (_parser.failed()) return false;
+    } else if (!_client.connected()) {
+      _parser.finish();
+      return false;
+    } else if (millis() - start >= timeout) {
+      return false;
+    }
+  }
+  return !_parser.failed();
+}
+
+/***************************************************************
+ * ReadBlock - hands out the body bytes that have arrived, as  *
+ * they lie in the read buffer, waiting for them if need be    *
+ * data stays valid until the stream is used again             *
+ * Returns their number, 0 at the end of the body              *
+ ***************************************************************/
+size_t TelegramHttpBodyStream::readBlock(const uint8_t *&data) {
+  if (_bodyLength == 0 && !nextBodySpan(_timeout)) return 0;
+
+  size_t length = _bodyLength;
+  data = (const uint8_t *)_buffer.data();
+  _buffer.consume(length);
+  _bodyLength = 0;
+  return length;
+}
+
+// Skips whatever is left of the body so the connection can be reused
+void TelegramHttpBodyStream::drain() {
+  _peeked = -1;
+  do {
+    _buffer.consume(_bodyLength);
+    _bodyLength = 0;
+  } while (nextBodySpan(_timeout));
+}
+
+int TelegramHttpBodyStream::available() {
+  if (_peeked >= 0) return 1;
+  if (_bodyLength > 0) return _bodyLength;
+  if (_parser.complete() || _parser.failed()) return 0;
+  // May include framing bytes, but never reports data that isn't there
+  return _buffer.length() + _client.available();
+}
+
+int TelegramHttpBodyStream::read() {
+  if (_peeked >= 0) {
+    int c = _peeked;
+    _peeked = -1;
+    return c;
+  }
+  return nextBodyByte();
+}
+
+int TelegramHttpBodyStream::peek() {
+  if (_peeked < 0) _peeked = nextBodyByte();
+  return _peeked;
+}
+
+int TelegramHttpBodyStream::nextBodyByte() {
+  if (_bodyLength == 0 && !nextBodySpan(_timeout)) return -1;
+
+  uint8_t c = *_buffer.data();
+  _buffer.consume(1);
+  _bodyLength--;
+  return c;
+}
+
+// Waits up to timeout for the next run of body bytes in the buffer
+bool TelegramHttpBodyStream::nextBodySpan(unsigned long timeout) {
+  unsigned long start = millis();
+
+  while (!_parser.complete() && !_parser.failed()) {
+    if (_buffer.length() > 0 || _buffer.fill(_client) > 0) {
+      size_t used = _parser.feed(_buffer.data(), _buffer.length(), _bodyLength);
+      // Drop the framing in front of the body bytes
+      _buffer.consume(used - _bodyLength);
+      if (_bodyLength > 0) return true;
+      start = millis();
+    } else if (!_client.connected()) {
+      _parser.finish();
+    } else if (millis() - start >= timeout) {
+      break;
+    }
+  }
+  return false;
+}
+
+size_t TelegramBufferedPrint::write(uint8_t c) {
+  if (_length == TELEGRAM_WRITE_BUFFER_SIZE) flush();
+  _buffer[_length++] = c;
+  return 1;
+}
+
+size_t TelegramBufferedPrint::write(const uint8_t *buffer, size_t size) {
+  // Blocks that don't fit go to the client directly
+  if (_length + size > TELEGRAM_WRITE_BUFFER_SIZE) {
+    flush();
+    if (size >= TELEGRAM_WRITE_BUFFER_SIZE) {
+      send(buffer, size);
+      return size;
+    }
+  }
+  memcpy(_buffer + _length, buffer, size);
+  _length += size;
+  return size;
+}
+
+void TelegramBufferedPrint::flush() {
+  if (_length == 0) return;
+  send(_buffer, _length);
+  _length = 0;
+}
+
+void TelegramBufferedPrint::send(const uint8_t *buffer, size_t size) {
+  size_t accepted = _client.write(buffer, size);
+  _written += accepted;
+  if (accepted != size) _failed = true;
+}
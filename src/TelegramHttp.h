@@ -0,0 +1,209 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TelegramHttp_h
+#define TelegramHttp_h
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Values of _lastError. Positive values are the HTTP status of a non 2xx
+// response, negative values mean no usable response was received
+#define TELEGRAM_ERROR_NONE 0
+#define TELEGRAM_ERROR_CONNECTION -1
+#define TELEGRAM_ERROR_TIMEOUT -2
+#define TELEGRAM_ERROR_CONNECTION_CLOSED -3
+#define TELEGRAM_ERROR_MALFORMED_RESPONSE -4
+#define TELEGRAM_ERROR_RESPONSE_TOO_LARGE -5
+#define TELEGRAM_ERROR_UPLOAD_INCOMPLETE -6
+#define TELEGRAM_ERROR_DOWNLOAD_INCOMPLETE -7
+
+// Longest status, header or chunk size line that is inspected, anything
+// beyond it is ignored
+#define TELEGRAM_HTTP_LINE_LENGTH 64
+
+// Responses are read from the client in blocks of this size
+#ifndef TELEGRAM_READ_BUFFER_SIZE
+#define TELEGRAM_READ_BUFFER_SIZE 256
+#endif
+
+// Outgoing requests are collected in a buffer of this size, so the client
+// sees a few large writes instead of one per byte
+#ifndef TELEGRAM_WRITE_BUFFER_SIZE
+#define TELEGRAM_WRITE_BUFFER_SIZE 128
+#endif
+
+// Header Telegram sends the secret token of a webhook in
+#define TELEGRAM_SECRET_TOKEN_HEADER "X-Telegram-Bot-Api-Secret-Token"
+
+/*
+   Incremental HTTP/1.1 response parser. Blocks are fed as they arrive,
+   feed() tells which of their bytes belong to the body. The body is framed
+   by Content-Length, chunked transfer encoding or, failing both, the server
+   closing the connection.
+   After resetRequest() it parses a request instead, as sent to a webhook.
+ */
+class TelegramHttpParser {
+public:
+  enum State {
+    STATE_STATUS_LINE,
+    STATE_HEADERS,
+    STATE_BODY,
+    STATE_BODY_UNTIL_CLOSE,
+    STATE_CHUNK_SIZE,
+    STATE_CHUNK_DATA,
+    STATE_CHUNK_DATA_END,
+    STATE_TRAILERS,
+    STATE_COMPLETE,
+    STATE_ERROR
+  };
+
+  TelegramHttpParser();
+  void reset();
+  void resetRequest();
+  size_t feed(const char *data, size_t length, size_t &bodyLength);
+  void finish();
+
+  bool headersComplete() const { return _state > STATE_HEADERS; }
+  bool complete() const { return _state == STATE_COMPLETE; }
+  bool failed() const { return _state == STATE_ERROR; }
+  int error() const { return _error; }
+
+  int statusCode;
+  long contentLength;
+  bool chunked;
+  bool keepAlive;
+  unsigned int keepAliveTimeout;
+
+  // Requests only: the method was POST, and whether the secret token header
+  // matched secretToken (nullptr to not look for it)
+  bool post;
+  const char *secretToken = nullptr;
+  bool secretTokenValid;
+
+private:
+  bool _request;
+  State _state;
+  int _error;
+  unsigned long _remaining;
+  char _line[TELEGRAM_HTTP_LINE_LENGTH];
+  uint8_t _lineLength;
+  // Bytes of the current line that did not fit into _line
+  uint16_t _overflow;
+  bool _overflowMatches;
+
+  void processLine();
+  void matchOverflow(const char *data, size_t length);
+  const char *secretTokenValue(size_t lineLength);
+  void processStatusLine();
+  void processHeaderLine();
+  void processChunkSize();
+  void endHeaders();
+  void fail(int error);
+};
+
+/*
+   Staging buffer between the client and the parser, so the client is asked
+   for a block at a time with read(buf, len) instead of once per byte.
+   Whatever has not been consumed yet is kept for the next call
+ */
+class TelegramReadBuffer {
+public:
+  size_t fill(Client &client);
+  char *data() { return _data + _start; }
+  size_t length() const { return _end - _start; }
+  void consume(size_t length);
+  void clear() { _start = _end = 0; }
+  void appendTo(String &s, char *from, size_t length);
+
+  // Bytes read from the client so far, and when the first block after the
+  // last call to expectResponse() arrived (0 while none has). Bytes already
+  // waiting in the buffer count as arriving then
+  unsigned long received() const { return _received; }
+  void expectResponse() { _firstBlock = length() > 0 ? millis() | 1 : 0; }
+  unsigned long firstBlock() const { return _firstBlock; }
+
+private:
+  // One spare byte, so a block can be terminated in place
+  char _data[TELEGRAM_READ_BUFFER_SIZE + 1];
+  size_t _start = 0;
+  size_t _end = 0;
+  unsigned long _received = 0;
+  unsigned long _firstBlock = 0;
+};
+
+/*
+   Stream over the body of a response, the framing is decoded on the fly so
+   it can be handed straight to deserializeJson
+ */
+class TelegramHttpBodyStream : public Stream {
+public:
+  TelegramHttpBodyStream(Client &client, TelegramHttpParser &parser, TelegramReadBuffer &buffer);
+
+  bool readHeaders(unsigned long timeout);
+  size_t readBlock(const uint8_t *&data);
+  void drain();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  Client &_client;
+  TelegramHttpParser &_parser;
+  TelegramReadBuffer &_buffer;
+  // Body bytes at the front of _buffer
+  size_t _bodyLength = 0;
+  int _peeked = -1;
+
+  bool nextBodySpan(unsigned long timeout);
+  int nextBodyByte();
+};
+
+/*
+   Print that collects what is written in a fixed buffer and passes it to
+   the client in blocks. Requests and JSON payloads are written straight
+   through it without building a String first
+ */
+class TelegramBufferedPrint : public Print {
+public:
+  explicit TelegramBufferedPrint(Client &client) : _client(client) {}
+  ~TelegramBufferedPrint() { flush(); }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  void flush();
+  bool failed() const { return _failed; }
+  // Bytes the client accepted so far
+  size_t written() const { return _written; }
+
+private:
+  Client &_client;
+  uint8_t _buffer[TELEGRAM_WRITE_BUFFER_SIZE];
+  size_t _length = 0;
+  size_t _written = 0;
+  bool _failed = false;
+
+  void send(const uint8_t *buffer, size_t size);
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramJsonArena.h"
+
+TelegramJsonArena::~TelegramJsonArena() {
+  if (_owned) free(_buffer);
+}
+
+// Builds the documents in buffer from now on, it must outlive the bot
+void TelegramJsonArena::use(char *buffer, size_t size) {
+  if (_owned) free(_buffer);
+  _buffer = buffer;
+  _size = buffer != nullptr ? size : 0;
+  _owned = false;
+}
+
+/***************************************************************
+ * Reserve - makes sure the arena holds size bytes, growing    *
+ * one the bot allocated itself if need be                     *
+ * Returns the size available, less if memory ran out or a     *
+ * supplied buffer is smaller                                  *
+ ***************************************************************/
+size_t TelegramJsonArena::reserve(size_t size) {
+  if (size <= _size || (_buffer != nullptr && !_owned)) return _size;
+
+  // The contents are not kept, so there is no point in realloc()
+  free(_buffer);
+  _buffer = nullptr;
+#if defined(ESP32) && TELEGRAM_JSON_PSRAM
+  _buffer = (char *)ps_malloc(size);
+#endif
+  if (_buffer == nullptr) _buffer = (char *)malloc(size);
+  _size = _buffer != nullptr ? size : 0;
+  _owned = true;
+  return _size;
+}
+
+TelegramJsonReservation::TelegramJsonReservation(TelegramJsonArena &arena, size_t capacity,
+                                                 size_t offset) {
+  // ArduinoJson places its slots at both ends of the pool, so it has to
+  // start and end on a pointer boundary
+  const size_t align = sizeof(void *);
+  offset = (offset + align - 1) & ~(align - 1);
+
+  size_t size = arena.reserve(offset + capacity);
+  if (size > offset) {
+    _reserved = arena.data() + offset;
+    _reservedCapacity = size - offset < capacity ? size - offset : capacity;
+    _reservedCapacity &= ~(align - 1);
+  } else {
+    _reserved = nullptr;
+    _reservedCapacity = 0;
+  }
+}
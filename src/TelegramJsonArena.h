@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramJsonArena_h
+#define TelegramJsonArena_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Put the arena into PSRAM on ESP32 boards that have it
+#ifndef TELEGRAM_JSON_PSRAM
+#define TELEGRAM_JSON_PSRAM 0
+#endif
+
+/*
+   Memory the bot's JSON documents are built in. It is allocated once, or
+   supplied by the sketch, and reused by every call. An allocated arena only
+   grows when a larger document is asked for, a supplied one never changes
+ */
+class TelegramJsonArena {
+public:
+  TelegramJsonArena() {}
+  ~TelegramJsonArena();
+  TelegramJsonArena(const TelegramJsonArena&) = delete;
+  TelegramJsonArena& operator=(const TelegramJsonArena&) = delete;
+
+  void use(char *buffer, size_t size);
+  size_t reserve(size_t size);
+  char *data() { return _buffer; }
+  size_t size() const { return _size; }
+
+private:
+  char *_buffer = nullptr;
+  size_t _size = 0;
+  bool _owned = false;
+};
+
+// Reserves the room of a TelegramJsonDocument before its pool is set up
+struct TelegramJsonReservation {
+  TelegramJsonReservation(TelegramJsonArena &arena, size_t capacity, size_t offset);
+  char *_reserved;
+  size_t _reservedCapacity;
+};
+
+/*
+   JsonDocument over the arena, from offset on. Documents used at the same
+   time must not overlap, and the arena has to be reserved for all of them
+   before the first is declared. Nothing is freed when it goes out of scope
+ */
+class TelegramJsonDocument : private TelegramJsonReservation, public JsonDocument {
+public:
+  TelegramJsonDocument(TelegramJsonArena &arena, size_t capacity, size_t offset = 0)
+      : TelegramJsonReservation(arena, capacity, offset),
+        JsonDocument(_reserved, _reservedCapacity) {}
+};
+
+#endif
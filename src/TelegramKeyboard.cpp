@@ -0,0 +1,180 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "TelegramKeyboard.h"
+
+// Length of s as a JSON string, quotes included
+static size_t jsonStringLength(const char *s) {
+  size_t length = 2;
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') length += 2;
+    else if ((uint8_t)*s < 0x20) length += 6;
+    else length++;
+  }
+  return length;
+}
+
+static char *writeJsonString(char *out, const char *s) {
+  *out++ = '"';
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      *out++ = '\\';
+      *out++ = *s;
+    } else if ((uint8_t)*s < 0x20) {
+      // The terminator snprintf adds is overwritten by what follows
+      out += snprintf(out, 7, "\\u%04x", *s);
+    } else {
+      *out++ = *s;
+    }
+  }
+  *out++ = '"';
+  return out;
+}
+
+TelegramKeyboard::TelegramKeyboard(char *buffer, size_t size) : _buffer(buffer), _size(size) {
+  clear();
+}
+
+// Starts over with a keyboard without rows
+void TelegramKeyboard::clear() {
+  _failed = _size < 3;
+  if (_failed) {
+    _length = 0;
+    if (_size > 0) _buffer[0] = 0;
+    return;
+  }
+  strcpy(_buffer, "[]");
+  _length = 2;
+}
+
+/***************************************************************
+ * Load - replaces the keyboard by a prebuilt one kept in      *
+ * flash, written as an array of rows. Buttons can be added to *
+ * its last row or new rows afterwards, so it has to be []   *
+ * or end in "]]", whitespace around it is dropped             *
+ * Returns false if it doesn't fit or is not an array of rows  *
+ ***************************************************************/
+bool TelegramKeyboard::load(const __FlashStringHelper *json) {
+  const char *p = reinterpret_cast<const char *>(json);
+  size_t length = strlen_P(p);
+  while (length > 0 && isspace(pgm_read_byte(p))) {
+    p++;
+    length--;
+  }
+  while (length > 0 && isspace(pgm_read_byte(p + length - 1))) length--;
+  if (length < 2 || length >= _size) {
+    #ifdef TELEGRAM_DEBUG
+      Serial.println(F("TelegramKeyboard: keyboard does not fit"));
+    #endif
+    _failed = true;
+    return false;
+  }
+  memcpy_P(_buffer, p, length);
+  _buffer[length] = 0;
+  _length = length;
+  _failed = false;
+
+  // Buttons go in front of the closing "]]"
+  if (_buffer[0] != '[' ||
+      (length > 2 ? strcmp(_buffer + length - 2, "]]") != 0 : _buffer[1] != ']')) {
+    #ifdef TELEGRAM_DEBUG
+      Serial.println(F("TelegramKeyboard: not an array of rows"));
+    #endif
+    clear();
+    _failed = true;
+    return false;
+  }
+  return true;
+}
+
+// Opens room for length bytes at position, keeping the terminator
+bool TelegramKeyboard::insert(size_t position, size_t length) {
+  if (_failed || _length + length + 1 > _size) {
+    #ifdef TELEGRAM_DEBUG
+      Serial.println(F("TelegramKeyboard: buffer too small"));
+    #endif
+    _failed = true;
+    return false;
+  }
+  memmove(_buffer + position + length, _buffer + position, _length - position + 1);
+  _length += length;
+  return true;
+}
+
+// Starts a new row, buttons are added to the last row
+bool TelegramKeyboard::addRow() {
+  // Insert before the closing bracket of the keyboard
+  bool first = _length <= 2;
+  size_t position = _length - 1;
+  if (!insert(position, first ? 2 : 3)) return false;
+  char *out = _buffer + position;
+  if (!first) *out++ = ',';
+  *out++ = '[';
+  *out = ']';
+  return true;
+}
+
+bool TelegramKeyboard::addButton(const char *text) {
+  return addButton(text, nullptr, nullptr);
+}
+
+bool TelegramKeyboard::addCallbackButton(const char *text, const char *callbackData) {
+  size_t length = strlen(callbackData);
+  if (length == 0 || length > TELEGRAM_CALLBACK_DATA_LENGTH) {
+    #ifdef TELEGRAM_DEBUG
+      Serial.print(F("TelegramKeyboard: invalid callback_data "));
+      Serial.println(callbackData);
+    #endif
+    _failed = true;
+    return false;
+  }
+  return addButton(text, "callback_data", callbackData);
+}
+
+bool TelegramKeyboard::addUrlButton(const char *text, const char *url) {
+  return addButton(text, "url", url);
+}
+
+// Adds {"text":text,"key":value} to the last row, or {"text":text}
+// without key
+bool TelegramKeyboard::addButton(const char *text, const char *key, const char *value) {
+  if (_length <= 2 && !addRow()) return false;
+
+  // The last row ends in "]]", it is empty when preceded by '['
+  bool first = _buffer[_length - 3] == '[';
+  size_t length = (first ? 0 : 1) + 8 + jsonStringLength(text) + 1;
+  if (key != nullptr) length += 1 + jsonStringLength(key) + 1 + jsonStringLength(value);
+
+  size_t position = _length - 2;
+  if (!insert(position, length)) return false;
+  char *out = _buffer + position;
+  if (!first) *out++ = ',';
+  memcpy(out, "{\"text\":", 8);
+  out = writeJsonString(out + 8, text);
+  if (key != nullptr) {
+    *out++ = ',';
+    out = writeJsonString(out, key);
+    *out++ = ':';
+    out = writeJsonString(out, value);
+  }
+  *out = '}';
+  return true;
+}
@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TelegramKeyboard_h
+#define TelegramKeyboard_h
+
+#include <Arduino.h>
+
+// Longest callback_data Telegram accepts, in bytes
+#define TELEGRAM_CALLBACK_DATA_LENGTH 64
+
+/*
+   Builds the JSON of an inline or reply keyboard in a buffer supplied by
+   the sketch, so menus can be redrawn without allocating. The buffer holds
+   a complete keyboard after every call; a button that doesn't fit or has
+   invalid callback_data is left out and marks the keyboard as failed.
+   Keyboards that never change can be kept in flash and copied in with
+   load() when they are sent
+ */
+class TelegramKeyboard {
+public:
+  TelegramKeyboard(char *buffer, size_t size);
+  template <size_t N>
+  explicit TelegramKeyboard(char (&buffer)[N]) : TelegramKeyboard(buffer, N) {}
+
+  void clear();
+  bool load(const __FlashStringHelper *json);
+  bool addRow();
+  // Reply keyboards: sends text when pressed
+  bool addButton(const char *text);
+  // Inline keyboards
+  bool addCallbackButton(const char *text, const char *callbackData);
+  bool addUrlButton(const char *text, const char *url);
+
+  const char *c_str() const { return _buffer; }
+  size_t length() const { return _length; }
+  bool failed() const { return _failed; }
+
+private:
+  char *_buffer;
+  size_t _size;
+  size_t _length = 0;
+  bool _failed = false;
+
+  bool addButton(const char *text, const char *key, const char *value);
+  bool insert(size_t position, size_t length);
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramMetrics.h"
+
+void TelegramHistogram::record(unsigned long duration) {
+  uint8_t bucket = 0;
+  while (bucket < TELEGRAM_METRICS_BUCKETS - 1 && duration >= (1ul << bucket)) bucket++;
+  buckets[bucket]++;
+  count++;
+  total += duration;
+  if (duration > max) max = duration;
+}
+
+TelegramMetrics::TelegramMetrics() {
+  reset();
+}
+
+void TelegramMetrics::reset() {
+  memset(endpoints, 0, sizeof(endpoints));
+  for (TelegramHistogram &histogram : latency) histogram = TelegramHistogram();
+  parse = TelegramHistogram();
+  bytesOut = 0;
+  bytesIn = 0;
+  handshakes = 0;
+  minFreeHeap = 0;
+}
+
+/***************************************************************
+ * Endpoint - counters of the method a command calls, e.g.     *
+ * "sendMessage" for "bot<token>/sendMessage?...", or "file"   *
+ * for a download. A free slot is taken for a new method       *
+ ***************************************************************/
+TelegramEndpointMetrics &TelegramMetrics::endpoint(const char *command) {
+  const char *name = command;
+  if (strncmp(command, "bot", 3) == 0) {
+    const char *slash = strchr(command, '/');
+    if (slash != nullptr) name = slash + 1;
+  }
+  size_t length = strcspn(name, "/?");
+  if (length >= TELEGRAM_METRICS_NAME_LENGTH) length = TELEGRAM_METRICS_NAME_LENGTH - 1;
+
+  for (TelegramEndpointMetrics &slot : endpoints) {
+    if (slot.name[0] == '\0') {
+      memcpy(slot.name, name, length);
+      slot.name[length] = '\0';
+      return slot;
+    }
+    if (strncmp(slot.name, name, length) == 0 && slot.name[length] == '\0') return slot;
+  }
+  return endpoints[TELEGRAM_METRICS_ENDPOINTS - 1];
+}
+
+void TelegramMetrics::record(TelegramEndpointMetrics &endpoint, const TelegramRequestMetrics &request) {
+  endpoint.requests++;
+  if (request.error != 0) endpoint.failures++;
+  sampleHeap();
+  // Without a response the phases tell little
+  if (request.error < 0) return;
+
+  for (uint8_t phase = 0; phase < TELEGRAM_PHASE_COUNT; phase++) {
+    // A reused connection has no connect phase to speak of
+    if (phase == TELEGRAM_PHASE_CONNECT && !request.newConnection) continue;
+    latency[phase].record(request.phases[phase]);
+  }
+}
+
+void TelegramMetrics::sampleHeap() {
+#if defined(ESP8266) || defined(ESP32)
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (minFreeHeap == 0 || freeHeap < minFreeHeap) minFreeHeap = freeHeap;
+#endif
+}
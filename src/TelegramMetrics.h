@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramMetrics_h
+#define TelegramMetrics_h
+
+#include <Arduino.h>
+
+// Buckets of a latency histogram, bucket i counts durations below 2^i ms and
+// the last one everything longer
+#ifndef TELEGRAM_METRICS_BUCKETS
+#define TELEGRAM_METRICS_BUCKETS 16
+#endif
+// Number of Bot API methods counted separately, once they are all taken the
+// remaining methods share the last one
+#ifndef TELEGRAM_METRICS_ENDPOINTS
+#define TELEGRAM_METRICS_ENDPOINTS 8
+#endif
+#define TELEGRAM_METRICS_NAME_LENGTH 24
+
+// Phases of a request. Connecting includes the TLS handshake, as the client
+// does both in connect()
+enum TelegramPhase : uint8_t {
+  TELEGRAM_PHASE_CONNECT,
+  TELEGRAM_PHASE_SEND,
+  TELEGRAM_PHASE_FIRST_BYTE,
+  TELEGRAM_PHASE_BODY,
+  TELEGRAM_PHASE_COUNT
+};
+
+// Durations in ms, counted in power of two buckets
+class TelegramHistogram {
+public:
+  void record(unsigned long duration);
+
+  uint32_t buckets[TELEGRAM_METRICS_BUCKETS] = {};
+  uint32_t count = 0;
+  unsigned long total = 0;
+  unsigned long max = 0;
+};
+
+struct TelegramEndpointMetrics {
+  char name[TELEGRAM_METRICS_NAME_LENGTH];
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t retries;
+};
+
+// One finished request as handed to the sink, durations are in ms and
+// phases that didn't take place are 0
+struct TelegramRequestMetrics {
+  const char *endpoint;
+  int error;
+  bool newConnection;
+  unsigned long phases[TELEGRAM_PHASE_COUNT];
+  size_t bytesOut;
+  size_t bytesIn;
+};
+
+typedef void (*TelegramMetricsSink)(const TelegramRequestMetrics &request);
+
+/*
+   Totals over all requests since the last reset(). Nothing is printed or
+   allocated while they are collected, read them whenever it suits
+ */
+class TelegramMetrics {
+public:
+  TelegramMetrics();
+
+  void reset();
+  TelegramEndpointMetrics &endpoint(const char *command);
+  void record(TelegramEndpointMetrics &endpoint, const TelegramRequestMetrics &request);
+  void sampleHeap();
+
+  TelegramEndpointMetrics endpoints[TELEGRAM_METRICS_ENDPOINTS];
+  TelegramHistogram latency[TELEGRAM_PHASE_COUNT];
+  // Time spent deserializing responses
+  TelegramHistogram parse;
+  unsigned long bytesOut;
+  unsigned long bytesIn;
+  unsigned long handshakes;
+  // Lowest free heap seen after a request, 0 where it can't be measured
+  uint32_t minFreeHeap;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramPollScheduler.h"
+
+/***************************************************************
+ * Timeout - long-poll timeout in seconds for the next poll,   *
+ * slack is the time in ms the response may take on top of it  *
+ ***************************************************************/
+int TelegramPollScheduler::timeout(unsigned int slack) const {
+  int timeout = _timeout < maxTimeout ? _timeout : maxTimeout;
+  if (maxBlocking > 0) {
+    long budget = maxBlocking > slack ? (maxBlocking - slack) / 1000 : 0;
+    if (timeout > budget) timeout = budget;
+  }
+  return timeout;
+}
+
+// Takes the outcome of a poll into account for the next one
+void TelegramPollScheduler::record(int messages, bool full, bool failed, unsigned int slack,
+                                   unsigned long now) {
+  polls++;
+  _last = now;
+
+  if (failed) {
+    failedPolls++;
+    backOff();
+  } else if (messages > 0) {
+    // More are likely to follow, full batches mean some are waiting already
+    _timeout = full ? 0 : burstTimeout;
+    _interval = 0;
+  } else {
+    emptyPolls++;
+    _timeout = _timeout < 1 ? 1 : _timeout * 2;
+    if (_timeout > maxTimeout) _timeout = maxTimeout;
+    // A long poll has done the waiting already
+    if (timeout(slack) > 0) _interval = 0;
+    else backOff();
+  }
+}
+
+void TelegramPollScheduler::backOff() {
+  _interval = _interval < minInterval ? minInterval : _interval * 2;
+  if (_interval > maxInterval) _interval = maxInterval;
+}
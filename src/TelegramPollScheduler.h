@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramPollScheduler_h
+#define TelegramPollScheduler_h
+
+#include <Arduino.h>
+
+// Longest long-poll timeout in seconds, reached after a run of empty polls
+#ifndef TELEGRAM_POLL_MAX_TIMEOUT
+#define TELEGRAM_POLL_MAX_TIMEOUT 20
+#endif
+// Timeout while messages keep coming in
+#ifndef TELEGRAM_POLL_BURST_TIMEOUT
+#define TELEGRAM_POLL_BURST_TIMEOUT 1
+#endif
+// Pause between polls that can't wait on the server, doubled while they
+// come back empty or fail
+#ifndef TELEGRAM_POLL_MIN_INTERVAL
+#define TELEGRAM_POLL_MIN_INTERVAL 1000
+#endif
+#ifndef TELEGRAM_POLL_MAX_INTERVAL
+#define TELEGRAM_POLL_MAX_INTERVAL 16000
+#endif
+
+/*
+   Decides when the next getUpdates is made and how long it waits on the
+   server. A full batch is followed by an immediate poll without timeout so
+   the backlog drains, any other batch by a short one. Empty polls double
+   the timeout up to maxTimeout, or the pause between polls where blocking
+   for a long poll isn't allowed. Failures back off the same way
+ */
+class TelegramPollScheduler {
+public:
+  bool due(unsigned long now) const { return now - _last >= _interval; }
+  int timeout(unsigned int slack) const;
+  void record(int messages, bool full, bool failed, unsigned int slack, unsigned long now);
+
+  // Longest a poll may keep the sketch waiting in ms, the waitForResponse
+  // slack included, 0 for no limit other than maxTimeout
+  unsigned long maxBlocking = 0;
+  int maxTimeout = TELEGRAM_POLL_MAX_TIMEOUT;
+  int burstTimeout = TELEGRAM_POLL_BURST_TIMEOUT;
+  unsigned long minInterval = TELEGRAM_POLL_MIN_INTERVAL;
+  unsigned long maxInterval = TELEGRAM_POLL_MAX_INTERVAL;
+
+  unsigned long polls = 0;
+  unsigned long emptyPolls = 0;
+  unsigned long failedPolls = 0;
+
+private:
+  int _timeout = 0;
+  unsigned long _interval = 0;
+  unsigned long _last = 0;
+
+  void backOff();
+};
+
+#endif
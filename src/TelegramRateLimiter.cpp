@@ -0,0 +1,109 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramRateLimiter.h"
+
+void TelegramTokenBucket::begin(uint16_t capacity, unsigned long interval, unsigned long now) {
+  _capacity = capacity;
+  _tokens = capacity;
+  _interval = interval;
+  _lastRefill = now;
+}
+
+// Adds the tokens gained since the last call, true if one is left
+bool TelegramTokenBucket::available(unsigned long now) {
+  unsigned long gained = (now - _lastRefill) / _interval;
+  if (gained > 0) {
+    _tokens = gained >= (unsigned long)(_capacity - _tokens) ? _capacity : _tokens + gained;
+    _lastRefill += gained * _interval;
+  }
+  if (_tokens == _capacity) _lastRefill = now;
+  return _tokens > 0;
+}
+
+TelegramRateLimiter::TelegramRateLimiter() {
+  _global.begin(TELEGRAM_GLOBAL_MESSAGES_PER_SECOND,
+                (1000 + TELEGRAM_GLOBAL_MESSAGES_PER_SECOND - 1) / TELEGRAM_GLOBAL_MESSAGES_PER_SECOND, 0);
+  for (int i = 0; i < TELEGRAM_RATE_LIMIT_CHATS; i++) _chats[i].used = false;
+}
+
+/***************************************************************
+ * TryAcquire - takes a token for a message to chat_id         *
+ * Returns false, taking nothing, if the message has to wait   *
+ ***************************************************************/
+bool TelegramRateLimiter::tryAcquire(const char *chat_id, unsigned long now) {
+  if (_floodWait) {
+    if ((long)(now - _floodWaitUntil) < 0) return false;
+    _floodWait = false;
+  }
+  if (!_global.available(now)) return false;
+
+  ChatRate* rate = chatRate(chat_id, now);
+  if (rate == nullptr || !rate->chat.available(now)) return false;
+  // Group and channel ids are negative, channels may also be given by name
+  bool group = chat_id[0] == '-' || chat_id[0] == '@';
+  if (group && !rate->group.available(now)) return false;
+
+  _global.take();
+  rate->chat.take();
+  if (group) rate->group.take();
+  rate->lastUsed = now;
+  return true;
+}
+
+// Telegram answered 429, nothing is sent until retry_after has passed
+void TelegramRateLimiter::floodWait(unsigned long seconds, unsigned long now) {
+  _floodWait = true;
+  _floodWaitUntil = now + seconds * 1000ul;
+}
+
+// Finds the entry for chat_id. A chat that isn't tracked yet takes over the
+// least recently used entry whose limits have recovered, forgetting one that
+// is still inside its window would let a burst through. Returns nullptr if
+// there is no such entry, the message has to wait then
+TelegramRateLimiter::ChatRate* TelegramRateLimiter::chatRate(const char *chat_id, unsigned long now) {
+  // FNV-1a hash of the id
+  uint32_t key = 2166136261u;
+  for (const char *p = chat_id; *p; p++) key = (key ^ (uint8_t)*p) * 16777619u;
+
+  ChatRate *oldest = nullptr;
+  for (int i = 0; i < TELEGRAM_RATE_LIMIT_CHATS; i++) {
+    ChatRate& rate = _chats[i];
+    if (rate.used && rate.key == key) return &rate;
+    if (rate.used) {
+      rate.chat.available(now);
+      rate.group.available(now);
+      if (!rate.chat.full() || !rate.group.full()) continue;
+    }
+    if (oldest == nullptr || (oldest->used && (!rate.used || now - rate.lastUsed > now - oldest->lastUsed)))
+      oldest = &rate;
+  }
+  if (oldest == nullptr) return nullptr;
+
+  oldest->key = key;
+  oldest->used = true;
+  oldest->lastUsed = now;
+  oldest->chat.begin(1, TELEGRAM_CHAT_MESSAGE_INTERVAL, now);
+  oldest->group.begin(TELEGRAM_GROUP_MESSAGES_PER_MINUTE,
+                      60000ul / TELEGRAM_GROUP_MESSAGES_PER_MINUTE, now);
+  return oldest;
+}
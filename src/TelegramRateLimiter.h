@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramRateLimiter_h
+#define TelegramRateLimiter_h
+
+#include <Arduino.h>
+
+// Limits of the Bot API: about 30 messages per second overall, no more than
+// one per second to the same chat and 20 per minute to the same group
+#ifndef TELEGRAM_GLOBAL_MESSAGES_PER_SECOND
+#define TELEGRAM_GLOBAL_MESSAGES_PER_SECOND 30
+#endif
+#ifndef TELEGRAM_CHAT_MESSAGE_INTERVAL
+#define TELEGRAM_CHAT_MESSAGE_INTERVAL 1000
+#endif
+#ifndef TELEGRAM_GROUP_MESSAGES_PER_MINUTE
+#define TELEGRAM_GROUP_MESSAGES_PER_MINUTE 20
+#endif
+// Number of chats whose rate is tracked at the same time, a message to one
+// more waits until the limits of a tracked chat have recovered
+#ifndef TELEGRAM_RATE_LIMIT_CHATS
+#define TELEGRAM_RATE_LIMIT_CHATS 8
+#endif
+
+/*
+   Token bucket: holds up to capacity tokens and gains one every interval
+   milliseconds, sending a message takes one
+ */
+class TelegramTokenBucket {
+public:
+  void begin(uint16_t capacity, unsigned long interval, unsigned long now);
+  bool available(unsigned long now);
+  void take() { if (_tokens > 0) _tokens--; }
+  bool full() const { return _tokens == _capacity; }
+
+private:
+  uint16_t _capacity = 1;
+  uint16_t _tokens = 1;
+  unsigned long _interval = 1000;
+  unsigned long _lastRefill = 0;
+};
+
+/*
+   Decides whether a message may be sent to a chat right now without
+   exceeding the global, per chat and per group limits
+ */
+class TelegramRateLimiter {
+public:
+  TelegramRateLimiter();
+
+  bool tryAcquire(const char *chat_id, unsigned long now);
+  void floodWait(unsigned long seconds, unsigned long now);
+
+private:
+  struct ChatRate {
+    uint32_t key;
+    bool used;
+    unsigned long lastUsed;
+    TelegramTokenBucket chat;
+    TelegramTokenBucket group;
+  };
+
+  TelegramTokenBucket _global;
+  ChatRate _chats[TELEGRAM_RATE_LIMIT_CHATS];
+  unsigned long _floodWaitUntil = 0;
+  bool _floodWait = false;
+
+  ChatRate* chatRate(const char *chat_id, unsigned long now);
+};
+
+#endif
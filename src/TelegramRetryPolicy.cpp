@@ -0,0 +1,70 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramRetryPolicy.h"
+
+TelegramFailure TelegramRetryPolicy::classify(int error) {
+  if (error == TELEGRAM_ERROR_NONE) return TELEGRAM_FAILURE_NONE;
+  if (error == 429) return TELEGRAM_FAILURE_RATE_LIMITED;
+  if (error >= 500) return TELEGRAM_FAILURE_SERVER;
+  // A body that can't be held gets no smaller by asking again, a file that
+  // ran out no longer and a sink that is full no emptier
+  if (error < 0 && error != TELEGRAM_ERROR_RESPONSE_TOO_LARGE &&
+      error != TELEGRAM_ERROR_UPLOAD_INCOMPLETE &&
+      error != TELEGRAM_ERROR_DOWNLOAD_INCOMPLETE) return TELEGRAM_FAILURE_TRANSPORT;
+  return TELEGRAM_FAILURE_PERMANENT;
+}
+
+/***************************************************************
+ * NextAttempt - called after an attempt failed with error     *
+ * (retryAfter: seconds asked for by a 429 response)           *
+ * Returns true if the call should be tried again, after       *
+ * waiting delay() milliseconds                                *
+ ***************************************************************/
+bool TelegramRetryPolicy::nextAttempt(int error, unsigned long retryAfter) {
+  _delay = 0;
+  if (_attempts >= maxAttempts) return false;
+
+  switch (classify(error)) {
+    case TELEGRAM_FAILURE_RATE_LIMITED:
+      _delay = (retryAfter > 0 ? retryAfter : 1) * 1000;
+      if (_delay > maxDelay) return false;
+      break;
+
+    case TELEGRAM_FAILURE_TRANSPORT:
+    case TELEGRAM_FAILURE_SERVER: {
+      unsigned long backoff = maxDelay;
+      if (_attempts <= 16 && (baseDelay << (_attempts - 1)) < maxDelay)
+        backoff = baseDelay << (_attempts - 1);
+      // Half fixed, half random, so devices that failed together don't
+      // come back together
+      _delay = backoff / 2 + random(backoff / 2 + 1);
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  _attempts++;
+  return true;
+}
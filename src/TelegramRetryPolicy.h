@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramRetryPolicy_h
+#define TelegramRetryPolicy_h
+
+#include <Arduino.h>
+#include <TelegramHttp.h>
+
+// Attempts made for one call, the first one included
+#ifndef TELEGRAM_RETRY_MAX_ATTEMPTS
+#define TELEGRAM_RETRY_MAX_ATTEMPTS 3
+#endif
+// Wait before the first retry, doubled for every further one
+#ifndef TELEGRAM_RETRY_BASE_DELAY
+#define TELEGRAM_RETRY_BASE_DELAY 500
+#endif
+// Longest wait between attempts, a 429 asking for more is not retried
+#ifndef TELEGRAM_RETRY_MAX_DELAY
+#define TELEGRAM_RETRY_MAX_DELAY 8000
+#endif
+
+enum TelegramFailure : uint8_t {
+  TELEGRAM_FAILURE_NONE,
+  TELEGRAM_FAILURE_TRANSPORT,    // no usable response, worth another try
+  TELEGRAM_FAILURE_RATE_LIMITED, // 429, retry after the time Telegram asks for
+  TELEGRAM_FAILURE_SERVER,       // 5xx, worth another try
+  TELEGRAM_FAILURE_PERMANENT     // 4xx and anything else, retrying won't help
+};
+
+/*
+   Decides whether a failed call is tried again and how long to wait first.
+   Transport errors and 5xx back off exponentially with jitter, 429 waits for
+   retry_after, permanent errors are given up on straight away
+ */
+class TelegramRetryPolicy {
+public:
+  static TelegramFailure classify(int error);
+
+  void begin() { _attempts = 1; }
+  bool nextAttempt(int error, unsigned long retryAfter = 0);
+  unsigned long delay() const { return _delay; }
+  uint8_t attempts() const { return _attempts; }
+
+  uint8_t maxAttempts = TELEGRAM_RETRY_MAX_ATTEMPTS;
+  unsigned long baseDelay = TELEGRAM_RETRY_BASE_DELAY;
+  unsigned long maxDelay = TELEGRAM_RETRY_MAX_DELAY;
+
+private:
+  uint8_t _attempts = 1;
+  unsigned long _delay = 0;
+};
+
+#endif
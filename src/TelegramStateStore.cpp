@@ -0,0 +1,90 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "TelegramStateStore.h"
+
+#if !defined(ESP8266)
+#include <stdio.h>
+#endif
+#if defined(ESP8266) || defined(ESP32)
+#include <EEPROM.h>
+#endif
+
+// FNV-1a, for the token fingerprint and the checksum
+uint32_t TelegramBotState::hash(const char *data, size_t length, uint32_t hash) {
+  for (size_t i = 0; i < length; i++) hash = (hash ^ (uint8_t)data[i]) * 16777619UL;
+  return hash;
+}
+
+// Copies from into a field of size bytes plus terminator, without cutting
+// a UTF-8 sequence in two
+void TelegramBotState::copy(char *to, const String& from, size_t size) {
+  size_t length = from.length();
+  if (length > size) {
+    length = size;
+    while (length > 0 && ((uint8_t)from[length] & 0xC0) == 0x80) length--;
+  }
+  memcpy(to, from.c_str(), length);
+  memset(to + length, 0, size + 1 - length);
+}
+
+void TelegramBotState::seal() {
+  magic = TELEGRAM_STATE_MAGIC;
+  checksum = hash((const char *)this, offsetof(TelegramBotState, checksum));
+}
+
+// Whether the state is complete and belongs to the bot with tokenHash
+bool TelegramBotState::valid(uint32_t tokenHash) const {
+  return magic == TELEGRAM_STATE_MAGIC && this->tokenHash == tokenHash &&
+         checksum == hash((const char *)this, offsetof(TelegramBotState, checksum)) &&
+         name[TELEGRAM_STATE_NAME_LENGTH] == 0 && userName[TELEGRAM_STATE_USERNAME_LENGTH] == 0;
+}
+
+#if !defined(ESP8266)
+bool TelegramFileStateStore::load(TelegramBotState &state) {
+  FILE *file = fopen(_path, "rb");
+  if (file == nullptr) return false;
+  bool read = fread(&state, sizeof(state), 1, file) == 1;
+  fclose(file);
+  return read;
+}
+
+bool TelegramFileStateStore::save(const TelegramBotState &state) {
+  FILE *file = fopen(_path, "wb");
+  if (file == nullptr) return false;
+  bool written = fwrite(&state, sizeof(state), 1, file) == 1;
+  return fclose(file) == 0 && written;
+}
+#endif
+
+#if defined(ESP8266) || defined(ESP32)
+bool TelegramEepromStateStore::load(TelegramBotState &state) {
+  if (_address + sizeof(state) > EEPROM.length()) return false;
+  EEPROM.get(_address, state);
+  return true;
+}
+
+bool TelegramEepromStateStore::save(const TelegramBotState &state) {
+  if (_address + sizeof(state) > EEPROM.length()) return false;
+  EEPROM.put(_address, state);
+  return EEPROM.commit();
+}
+#endif
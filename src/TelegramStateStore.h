@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TelegramStateStore_h
+#define TelegramStateStore_h
+
+#include <Arduino.h>
+
+// Changes of the saved state are written at most once per this many ms, to
+// spare flash. The first change after a reboot is written right away
+#ifndef TELEGRAM_PERSIST_INTERVAL
+#define TELEGRAM_PERSIST_INTERVAL 60000UL
+#endif
+
+#define TELEGRAM_STATE_MAGIC 0x54474231UL
+// Bytes kept of the bot's name and userName, longer ones are shortened
+#define TELEGRAM_STATE_NAME_LENGTH 64
+#define TELEGRAM_STATE_USERNAME_LENGTH 32
+
+/*
+   What the bot keeps across reboots: where the updates it has seen end
+   and its identity, so it neither handles an update twice nor needs getMe()
+   to start. A plain record that can be copied into any memory as it is,
+   the token fingerprint and checksum tell whether it can be used
+ */
+struct TelegramBotState {
+  uint32_t magic;
+  uint32_t tokenHash;
+  int32_t lastReceived;
+  int32_t lastAcked;
+  char name[TELEGRAM_STATE_NAME_LENGTH + 1];
+  char userName[TELEGRAM_STATE_USERNAME_LENGTH + 1];
+  uint32_t checksum;
+
+  void seal();
+  bool valid(uint32_t tokenHash) const;
+
+  static uint32_t hash(const char *data, size_t length, uint32_t hash = 2166136261UL);
+  static void copy(char *to, const String& from, size_t size);
+};
+
+/*
+   Where the state is kept, such as a file, EEPROM or RTC memory. load()
+   fills state and returns false if there is none, save() returns false if
+   it couldn't be written
+ */
+class TelegramStateStore {
+public:
+  virtual ~TelegramStateStore() {}
+  virtual bool load(TelegramBotState &state) = 0;
+  virtual bool save(const TelegramBotState &state) = 0;
+};
+
+#if !defined(ESP8266)
+/*
+   Keeps the state in a file through stdio, on ESP32 under a mounted VFS
+   path (e.g. "/littlefs/telegram.bin") and on a host build anywhere
+ */
+class TelegramFileStateStore : public TelegramStateStore {
+public:
+  explicit TelegramFileStateStore(const char *path) : _path(path) {}
+  bool load(TelegramBotState &state) override;
+  bool save(const TelegramBotState &state) override;
+
+private:
+  const char *_path;
+};
+#endif
+
+#if defined(ESP8266) || defined(ESP32)
+/*
+   Keeps the state in the emulated EEPROM at address. The sketch calls
+   EEPROM.begin() with room for sizeof(TelegramBotState) from there on
+ */
+class TelegramEepromStateStore : public TelegramStateStore {
+public:
+  explicit TelegramEepromStateStore(int address = 0) : _address(address) {}
+  bool load(TelegramBotState &state) override;
+  bool save(const TelegramBotState &state) override;
+
+private:
+  int _address;
+};
+#endif
+
+#endif
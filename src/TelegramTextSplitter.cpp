@@ -0,0 +1,302 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "TelegramTextSplitter.h"
+
+static bool startsWith(const char *p, const char *end, const char *prefix) {
+  for (; *prefix; p++, prefix++) {
+    if (p >= end || *p != *prefix) return false;
+  }
+  return true;
+}
+
+// Length of text in UTF-16 code units
+static size_t utf16Units(const char *text, const char *end) {
+  size_t units = 0;
+  for (const char *p = text; p < end; p++) {
+    uint8_t c = *p;
+    if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+  }
+  return units;
+}
+
+static bool tagNamed(const char *tag, uint8_t nameLength, const char *name) {
+  return nameLength == strlen(name) && strncasecmp(tag + 1, name, nameLength) == 0;
+}
+
+bool TelegramTextSplitter::MarkupState::verbatim() const {
+  if (markup != MARKUP_HTML) return code || pre;
+  for (int i = 0; i < depth && i < TELEGRAM_SPLIT_MARKUP_DEPTH; i++) {
+    if (tagNamed(tags[i], nameLength[i], "pre") || tagNamed(tags[i], nameLength[i], "code")) return true;
+  }
+  return false;
+}
+
+size_t TelegramTextSplitter::MarkupState::read(const char *p, const char *end) {
+  char c = *p;
+
+  if (markup == MARKUP_HTML) {
+    if (tag) {
+      tag = c != '>';
+    } else if (entity) {
+      entity = c != ';' && c != ' ' && c != '\n';
+    } else if (c == '<') {
+      tag = true;
+      if (startsWith(p + 1, end, "/")) {
+        if (depth > 0) depth--;
+      } else {
+        if (depth < TELEGRAM_SPLIT_MARKUP_DEPTH) {
+          const char *q = p + 1;
+          while (q < end && *q != '>' && *q != ' ' && q - p < 255) q++;
+          nameLength[depth] = q - p - 1;
+          while (q < end && *q != '>' && q - p < 254) q++;
+          tags[depth] = p;
+          tagLength[depth] = q - p + 1;
+        }
+        depth++;
+      }
+    } else if (c == '&') {
+      entity = true;
+    }
+    return 1;
+  }
+
+  if (markup != MARKUP_MARKDOWN && markup != MARKUP_MARKDOWN_V2) return 1;
+  bool v2 = markup == MARKUP_MARKDOWN_V2;
+
+  if (escaped) {
+    escaped = false;
+    return 1;
+  }
+  if (c == '\\') {
+    escaped = true;
+    return 1;
+  }
+  if (!code && startsWith(p, end, "```")) {
+    pre = !pre;
+    if (pre) {
+      // The language, if one follows, is opened again along with the fence
+      const char *q = p + 3;
+      while (q < end && q - p < 64 && (isalnum((uint8_t)*q) || *q == '-' || *q == '+' || *q == '_')) q++;
+      fence = p;
+      fenceLength = q < end && *q == '\n' ? q - p + 1 : 3;
+    }
+    return 3;
+  }
+  if (pre) return 1;
+  if (c == '`') {
+    code = !code;
+    return 1;
+  }
+  if (code) return 1;
+
+  if (link == 2) {
+    if (c == ')') link = 0;
+    return 1;
+  }
+  if (c == '[') {
+    link = 1;
+  } else if (c == ']' && link == 1) {
+    link = startsWith(p + 1, end, "(") ? 2 : 0;
+  } else if (c == '*') {
+    styles ^= 1;
+  } else if (v2 && startsWith(p, end, "__")) {
+    styles ^= 4;
+    return 2;
+  } else if (c == '_') {
+    styles ^= 2;
+  } else if (v2 && c == '~') {
+    styles ^= 8;
+  } else if (v2 && startsWith(p, end, "||")) {
+    styles ^= 16;
+    return 2;
+  }
+  return 1;
+}
+
+// Markdown style markers, in the order of the bits of styles
+static const char *const STYLE_MARKERS[] = {"*", "_", "__", "~", "||"};
+
+// The markup that opens what is open, to start the next part with
+void TelegramTextSplitter::MarkupState::opening(String& markup) const {
+  if (this->markup == MARKUP_HTML) {
+    for (int i = 0; i < depth && i < TELEGRAM_SPLIT_MARKUP_DEPTH; i++) markup.concat(tags[i], tagLength[i]);
+    return;
+  }
+  for (int i = 0; i < 5; i++) {
+    if (styles & (1 << i)) markup += STYLE_MARKERS[i];
+  }
+  if (pre) markup.concat(fence, fenceLength);
+  if (code) markup += '`';
+}
+
+// The markup that closes what is open, to end a part with
+void TelegramTextSplitter::MarkupState::closing(String& markup) const {
+  if (this->markup == MARKUP_HTML) {
+    for (int i = (depth < TELEGRAM_SPLIT_MARKUP_DEPTH ? depth : TELEGRAM_SPLIT_MARKUP_DEPTH) - 1; i >= 0; i--) {
+      markup += F("</");
+      markup.concat(tags[i] + 1, nameLength[i]);
+      markup += '>';
+    }
+    return;
+  }
+  if (code) markup += '`';
+  if (pre) markup += F("```");
+  for (int i = 4; i >= 0; i--) {
+    if (styles & (1 << i)) markup += STYLE_MARKERS[i];
+  }
+}
+
+size_t TelegramTextSplitter::MarkupState::closingUnits() const {
+  if (this->markup == MARKUP_HTML) {
+    size_t units = 0;
+    for (int i = 0; i < depth && i < TELEGRAM_SPLIT_MARKUP_DEPTH; i++) units += nameLength[i] + 3;
+    return units;
+  }
+  size_t units = (code ? 1 : 0) + (pre ? 3 : 0);
+  for (int i = 0; i < 5; i++) {
+    if (styles & (1 << i)) units += strlen(STYLE_MARKERS[i]);
+  }
+  return units;
+}
+
+// Takes in the character at p with the markup it starts, or a UTF-8
+// sequence with its continuation bytes, returns where the next one starts
+static const char *advance(const char *p, const char *end, size_t read) {
+  const char *next = p + read;
+  while (next < end && ((uint8_t)*next & 0xC0) == 0x80) next++;
+  return next > end ? end : next;
+}
+
+TelegramTextSplitter::TelegramTextSplitter(const char *text, size_t length, const char *parseMode,
+                                           size_t maxUnits)
+    : _text(text), _end(text + length), _maxUnits(maxUnits > 0 ? maxUnits : 1) {
+  if (strcasecmp(parseMode, "HTML") == 0) _markup = MARKUP_HTML;
+  else if (strcasecmp(parseMode, "Markdown") == 0) _markup = MARKUP_MARKDOWN;
+  else if (strcasecmp(parseMode, "MarkdownV2") == 0) _markup = MARKUP_MARKDOWN_V2;
+  else _markup = MARKUP_NONE;
+  _open.markup = _markup;
+
+  // Two bytes of UTF-8 make at least one UTF-16 unit, so short texts need
+  // no counting
+  _single = length <= _maxUnits || utf16Units(text, _end) <= _maxUnits;
+}
+
+// Line breaks and spaces a part was cut at are left out, as Telegram
+// would drop them anyway, unless they are part of a code block
+void TelegramTextSplitter::skipBreaks() {
+  if (_single || _open.verbatim()) return;
+  while (_text < _end && (*_text == '\n' || *_text == ' ')) _text++;
+}
+
+bool TelegramTextSplitter::done() {
+  skipBreaks();
+  return _text >= _end;
+}
+
+/***************************************************************
+ * Next - the next part of the text                            *
+ * Returns false when the whole text has been handed out       *
+ ***************************************************************/
+bool TelegramTextSplitter::next(const char *&part, size_t &length) {
+  _opening = String();
+  _closing = String();
+  if (done()) return false;
+  if (_single) {
+    part = _text;
+    length = _end - _text;
+    _text = _end;
+    return true;
+  }
+
+  // What the previous part left open is opened again, unless that would
+  // leave hardly any room for the text
+  _open.opening(_opening);
+  size_t budget = _maxUnits;
+  size_t openingUnits = utf16Units(_opening.c_str(), _opening.c_str() + _opening.length());
+  if (openingUnits < budget / 2) {
+    budget -= openingUnits;
+  } else {
+    _open = MarkupState();
+    _open.markup = _markup;
+    _opening = String();
+  }
+
+  MarkupState state = _open;
+  const char *p = _text;
+  size_t units = 0;
+  // Where the part could end, and its length in units if it did. An
+  // entity too long for a part has to be cut, though not in a tag
+  const char *line = nullptr, *space = nullptr, *safe = nullptr;
+  const char *looseLine = nullptr, *looseBreak = nullptr, *loose = nullptr;
+  size_t lineUnits = 0, looseLineUnits = 0;
+
+  while (p < _end) {
+    if (p > _text && state.between()) {
+      loose = p;
+      if (p[-1] == '\n' || p[-1] == ' ') looseBreak = p;
+      if (p[-1] == '\n') {
+        looseLine = p;
+        looseLineUnits = units;
+      }
+    }
+    if (p > _text && state.closed()) {
+      safe = p;
+      if (p[-1] == '\n') {
+        line = p;
+        lineUnits = units;
+      } else if (p[-1] == ' ') {
+        space = p;
+      }
+    }
+
+    // Markup is taken in as a whole, a UTF-8 sequence along with its
+    // continuation bytes. Room is left to close what is open
+    const char *next = advance(p, _end, state.read(p, _end));
+    size_t nextUnits = units + utf16Units(p, next);
+    if (nextUnits + state.closingUnits() > budget && p > _text) break;
+
+    p = next;
+    units = nextUnits;
+  }
+
+  const char *cut = p;
+  if (p < _end) {
+    // Rather a line break than a space, as long as the part doesn't get
+    // much shorter for it
+    if (line != nullptr && (lineUnits >= budget / 2 || space == nullptr)) cut = line;
+    else if (space != nullptr) cut = space;
+    else if (safe != nullptr) cut = safe;
+    else if (looseLine != nullptr && (looseLineUnits >= budget / 2 || looseBreak == nullptr)) cut = looseLine;
+    else if (looseBreak != nullptr) cut = looseBreak;
+    else if (loose != nullptr) cut = loose;
+  }
+
+  // The markup open at the cut is closed here and opened again in the
+  // next part
+  for (const char *q = _text; q < cut;) q = advance(q, _end, _open.read(q, _end));
+  _open.closing(_closing);
+
+  part = _text;
+  length = cut - _text;
+  _text = cut;
+  return true;
+}
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TelegramTextSplitter_h
+#define TelegramTextSplitter_h
+
+#include <Arduino.h>
+
+// Longest message text Telegram accepts, in UTF-16 code units
+#ifndef TELEGRAM_MESSAGE_LENGTH
+#define TELEGRAM_MESSAGE_LENGTH 4096
+#endif
+
+// HTML tags still open where a text is cut that are closed at the end of the
+// part and opened again at the start of the next one, deeper ones are not
+#ifndef TELEGRAM_SPLIT_MARKUP_DEPTH
+#define TELEGRAM_SPLIT_MARKUP_DEPTH 4
+#endif
+
+/*
+   Cuts a UTF-8 text into parts of at most maxUnits UTF-16 code units, the
+   way Telegram counts the length of a message. Parts end on a line break
+   where possible, else on a space, and never inside a multibyte sequence,
+   an HTML tag or entity, or HTML/Markdown markup that is still open.
+   Markup too long for one part, like a long <pre> block or ``` fence, is
+   cut on a line break inside it. It is then closed with closing() at the
+   end of the part and opened again with opening() at the start of the
+   next, so every part is balanced on its own. The parts point into the
+   text, only the markup around them is copied
+ */
+class TelegramTextSplitter {
+public:
+  TelegramTextSplitter(const char *text, size_t length, const char *parseMode,
+                       size_t maxUnits = TELEGRAM_MESSAGE_LENGTH);
+
+  bool next(const char *&part, size_t &length);
+  // Markup to put before and after the part last handed out
+  const String& opening() const { return _opening; }
+  const String& closing() const { return _closing; }
+  // Whether the text fits into one part, and whether all of it was handed out
+  bool single() const { return _single; }
+  bool done();
+
+private:
+  enum Markup : uint8_t { MARKUP_NONE, MARKUP_HTML, MARKUP_MARKDOWN, MARKUP_MARKDOWN_V2 };
+
+  // Whether the text read so far leaves markup open, so a part can't end here
+  struct MarkupState {
+    Markup markup = MARKUP_NONE;
+    bool tag = false;
+    bool entity = false;
+    int depth = 0;
+    bool escaped = false;
+    bool code = false;
+    bool pre = false;
+    // Bold, italic, underline, strikethrough and spoiler, one bit each
+    uint8_t styles = 0;
+    // 1 in the text of a link, 2 in its url
+    uint8_t link = 0;
+    // The open HTML tags, or the ``` fence of a Markdown pre block with its
+    // language, as found in the text
+    const char *tags[TELEGRAM_SPLIT_MARKUP_DEPTH];
+    uint8_t tagLength[TELEGRAM_SPLIT_MARKUP_DEPTH];
+    uint8_t nameLength[TELEGRAM_SPLIT_MARKUP_DEPTH];
+    const char *fence = nullptr;
+    uint8_t fenceLength = 0;
+
+    // Not inside a tag, an HTML entity or after an escape
+    bool between() const { return !tag && !entity && !escaped; }
+    bool closed() const {
+      return between() && depth == 0 && !code && !pre && styles == 0 && link == 0;
+    }
+    // Inside code or pre, where whitespace matters
+    bool verbatim() const;
+
+    // Takes in the character at p, returns the bytes of markup it starts
+    // that have to be taken in together with it
+    size_t read(const char *p, const char *end);
+    void opening(String& markup) const;
+    void closing(String& markup) const;
+    size_t closingUnits() const;
+  };
+
+  const char *_text;
+  const char *_end;
+  size_t _maxUnits;
+  Markup _markup;
+  bool _single;
+  // Markup open where the current part starts
+  MarkupState _open;
+  String _opening;
+  String _closing;
+
+  void skipBreaks();
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+   Copyright (c) 2018 Brian Lough. All right reserved.
+
+   UniversalTelegramBot - Library to create your own Telegram Bot using
+   ESP8266 or ESP32 on Arduino IDE.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+#include "TelegramUpload.h"
+
+// Counts what is printed to it, to measure the parts before sending them
+class TelegramCountingPrint : public Print {
+public:
+  size_t write(uint8_t) override { count++; return 1; }
+  size_t write(const uint8_t *, size_t size) override { count += size; return size; }
+  size_t count = 0;
+};
+
+TelegramUpload::Part *TelegramUpload::addPart(PartType type, const char *name) {
+  if (_count == TELEGRAM_UPLOAD_PARTS) return nullptr;
+
+  Part &part = _parts[_count++];
+  part.type = type;
+  part.name = name;
+  part.fileName = nullptr;
+  part.contentType = nullptr;
+  part.size = 0;
+  return &part;
+}
+
+bool TelegramUpload::addField(const char *name, const String &value) {
+  Part *part = addPart(PART_FIELD, name);
+  if (part == nullptr) return false;
+  part->value = value;
+  part->size = value.length();
+  return true;
+}
+
+bool TelegramUpload::addFile(const char *name, const char *fileName, const char *contentType,
+                             Stream &source, size_t size) {
+  Part *part = addPart(PART_STREAM, name);
+  if (part == nullptr) return false;
+  part->fileName = fileName;
+  part->contentType = contentType;
+  part->stream = &source;
+  part->size = size;
+  return true;
+}
+
+bool TelegramUpload::addFile(const char *name, const char *fileName, const char *contentType,
+                             const uint8_t *data, size_t size) {
+  Part *part = addPart(PART_BUFFER, name);
+  if (part == nullptr) return false;
+  part->fileName = fileName;
+  part->contentType = contentType;
+  part->data = data;
+  part->size = size;
+  return true;
+}
+
+bool TelegramUpload::addFile(const char *name, const char *fileName, const char *contentType,
+                             size_t size, MoreDataAvailable moreDataAvailableCallback,
+                             GetNextByte getNextByteCallback, GetNextBuffer getNextBufferCallback,
+                             GetNextBufferLen getNextBufferLenCallback) {
+  Part *part = addPart(PART_CALLBACKS, name);
+  if (part == nullptr) return false;
+  part->fileName = fileName;
+  part->contentType = contentType;
+  part->size = size;
+  part->moreDataAvailable = moreDataAvailableCallback;
+  part->getNextByte = getNextByteCallback;
+  part->getNextBuffer = getNextBufferCallback;
+  part->getNextBufferLen = getNextBufferLenCallback;
+  return true;
+}
+
+// Length of the request body, for the Content-Length header
+size_t TelegramUpload::contentLength() const {
+  TelegramCountingPrint counter;
+  for (uint8_t i = 0; i < _count; i++) {
+    writePartHead(counter, _parts[i]);
+    counter.count += _parts[i].size + 2;
+  }
+  counter.print(F("--" TELEGRAM_MULTIPART_BOUNDARY "--\r\n"));
+  return counter.count;
+}
+
+void TelegramUpload::writePartHead(Print &out, const Part &part) {
+  out.print(F("--" TELEGRAM_MULTIPART_BOUNDARY "\r\n"
+              "content-disposition: form-data; name=\""));
+  out.print(part.name);
+  if (part.fileName != nullptr) {
+    out.print(F("\"; filename=\""));
+    out.print(part.fileName);
+  }
+  out.print(F("\"\r\n"));
+  if (part.contentType != nullptr) {
+    out.print(F("Content-Type: "));
+    out.print(part.contentType);
+    out.print(F("\r\n"));
+  }
+  out.print(F("\r\n"));
+}
+
+/***************************************************************
+ * WriteTo - sends the body of the upload. File data is passed *
+ * on in blocks of chunkSize, memory parts without copying     *
+ * Returns false if a source ran out before its size           *
+ ***************************************************************/
+bool TelegramUpload::writeTo(Print &out, uint8_t *chunk, size_t chunkSize,
+                             TelegramUploadProgress progress) const {
+  size_t total = contentLength();
+  size_t sent = 0;
+  unsigned long start = millis();
+
+  for (uint8_t i = 0; i < _count; i++) {
+    const Part &part = _parts[i];
+    TelegramCountingPrint head;
+    writePartHead(head, part);
+    writePartHead(out, part);
+    sent += head.count;
+
+    if (writePartData(out, part, chunk, chunkSize, sent, total, start, progress) != part.size)
+      return false;
+    out.print(F("\r\n"));
+    sent += 2;
+  }
+  out.print(F("--" TELEGRAM_MULTIPART_BOUNDARY "--\r\n"));
+  if (progress != nullptr) progress(total, total, millis() - start);
+  return true;
+}
+
+// Returns the number of bytes of the part that were sent
+size_t TelegramUpload::writePartData(Print &out, const Part &part, uint8_t *chunk,
+                                     size_t chunkSize, size_t &sent, size_t total,
+                                     unsigned long start, TelegramUploadProgress progress) {
+  size_t written = 0;
+
+  while (written < part.size) {
+    const uint8_t *block = chunk;
+    size_t length = part.size - written < chunkSize ? part.size - written : chunkSize;
+
+    switch (part.type) {
+      case PART_FIELD:
+        block = (const uint8_t *)part.value.c_str() + written;
+        break;
+
+      case PART_BUFFER:
+        block = part.data + written;
+        break;
+
+      case PART_STREAM:
+        length = part.stream->readBytes((char *)chunk, length);
+        break;
+
+      case PART_CALLBACKS:
+        if (!part.moreDataAvailable()) {
+          length = 0;
+        } else if (part.getNextByte == nullptr) {
+          // The callbacks hand out their own buffers, whatever lies beyond
+          // the size of the part is not sent
+          block = part.getNextBuffer();
+          size_t available = part.getNextBufferLen();
+          length = available < part.size - written ? available : part.size - written;
+        } else {
+          size_t filled = 0;
+          while (filled < length && (filled == 0 || part.moreDataAvailable()))
+            chunk[filled++] = part.getNextByte();
+          length = filled;
+        }
+        break;
+    }
+    if (length == 0) break;
+
+    out.write(block, length);
+    written += length;
+    sent += length;
+    if (progress != nullptr) progress(sent, total, millis() - start);
+  }
+  return written;
+}
@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2018 Brian Lough. All right reserved.
+
+UniversalTelegramBot - Library to create your own Telegram Bot using
+ESP8266 or ESP32 on Arduino IDE.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef TelegramUpload_h
+#define TelegramUpload_h
+
+#include <Arduino.h>
+
+// Separates the parts of a multipart/form-data upload
+#define TELEGRAM_MULTIPART_BOUNDARY "------------------------b8f610217e83e29b"
+
+// Maximum number of parts (fields and files) of one upload
+#ifndef TELEGRAM_UPLOAD_PARTS
+#define TELEGRAM_UPLOAD_PARTS 6
+#endif
+// Default size of the blocks file data is copied and sent in
+#ifndef TELEGRAM_UPLOAD_CHUNK_SIZE
+#define TELEGRAM_UPLOAD_CHUNK_SIZE 2048
+#endif
+
+typedef bool (*MoreDataAvailable)();
+typedef byte (*GetNextByte)();
+typedef byte* (*GetNextBuffer)();
+typedef int (GetNextBufferLen)();
+// Called after every block sent, elapsed is the time in milliseconds since
+// the upload started, so sent / elapsed is the throughput in kB/s
+typedef void (*TelegramUploadProgress)(size_t sent, size_t total, unsigned long elapsed);
+
+/*
+   The parts of a multipart/form-data upload: text fields and files read
+   from a Stream (such as a File), from memory (such as a camera frame
+   buffer) or from the older callbacks. Nothing is copied when a part is
+   added, names, file names, content types and sources have to stay valid
+   until the upload has been sent.
+   Every file has to deliver exactly the size it was added with, which goes
+   into Content-Length up front. A source that runs out early fails the
+   upload; bytes past the size, such as the end of the last buffer handed
+   out by the callbacks, are left out. The callbacks are asked about
+   moreDataAvailable before every byte or buffer.
+ */
+class TelegramUpload {
+public:
+  bool addField(const char *name, const String &value);
+  bool addFile(const char *name, const char *fileName, const char *contentType,
+               Stream &source, size_t size);
+  bool addFile(const char *name, const char *fileName, const char *contentType,
+               const uint8_t *data, size_t size);
+  bool addFile(const char *name, const char *fileName, const char *contentType, size_t size,
+               MoreDataAvailable moreDataAvailableCallback, GetNextByte getNextByteCallback,
+               GetNextBuffer getNextBufferCallback, GetNextBufferLen getNextBufferLenCallback);
+
+  size_t contentLength() const;
+  bool writeTo(Print &out, uint8_t *chunk, size_t chunkSize, TelegramUploadProgress progress) const;
+
+private:
+  enum PartType : uint8_t { PART_FIELD, PART_STREAM, PART_BUFFER, PART_CALLBACKS };
+  struct Part {
+    PartType type;
+    const char *name;
+    const char *fileName;
+    const char *contentType;
+    size_t size;
+    String value;
+    Stream *stream;
+    const uint8_t *data;
+    MoreDataAvailable moreDataAvailable;
+    GetNextByte getNextByte;
+    GetNextBuffer getNextBuffer;
+    GetNextBufferLen *getNextBufferLen;
+  };
+  Part _parts[TELEGRAM_UPLOAD_PARTS];
+  uint8_t _count = 0;
+
+  Part *addPart(PartType type, const char *name);
+  static void writePartHead(Print &out, const Part &part);
+  static size_t writePartData(Print &out, const Part &part, uint8_t *chunk, size_t chunkSize,
+                              size_t &sent, size_t total, unsigned long start,
+                              TelegramUploadProgress progress);
+};
+
+#endif
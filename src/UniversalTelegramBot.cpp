@@ -21,16 +21,16 @@
 
 /*
    **** Note Regarding Client Connection Keeping ****
-   Client connection is established in functions that directly involve use of
-   client, i.e sendGetToTelegram, sendPostToTelegram, and
-   sendMultipartFormDataToTelegram. It is closed at the end of
-   sendMultipartFormDataToTelegram, but not at the end of sendGetToTelegram and
-   sendPostToTelegram as these may need to keep the connection alive for respose
-   / response checking. Re-establishing a connection then wastes time which is
-   noticeable in user experience. Due to this, it is important that connection
-   be closed manually after calling sendGetToTelegram or sendPostToTelegram by
-   calling closeClient(); Failure to close connection causes memory leakage and
-   SSL errors
+   Client connection is established lazily by connectClient() in functions that
+   directly involve use of client, i.e sendGetToTelegram, sendPostToTelegram,
+   and sendMultipartFormDataToTelegram. Re-establishing a connection means a
+   new TLS handshake, which takes 1-3 seconds on an ESP8266, so when keepAlive
+   is set (the default) the public methods hand the connection back with
+   releaseClient() instead of closing it. It is then reused by the next call
+   unless the server asked for "Connection: close", it has been idle for longer
+   than keepAliveTimeout (or the server's Keep-Alive timeout), or the server has
+   half-closed it. Any failure still calls closeClient(), as a connection in an
+   unknown state causes memory leakage and SSL errors
  */
 
 #include "UniversalTelegramBot.h"
@@ -38,9 +38,47 @@
 #define ZERO_COPY(STR)    ((char*)STR.c_str())
 #define BOT_CMD(STR)      buildCommand(F(STR))
 
-UniversalTelegramBot::UniversalTelegramBot(const String& token, Client &client) {
+// Update types the server is asked for, as selected by TELEGRAM_READ_*
+static const char* const ALLOWED_UPDATES[] = {
+#if TELEGRAM_READ_MESSAGES
+  "message",
+#endif
+#if TELEGRAM_READ_EDITED_MESSAGES
+  "edited_message",
+#endif
+#if TELEGRAM_READ_CHANNEL_POSTS
+  "channel_post",
+#endif
+#if TELEGRAM_READ_CALLBACK_QUERIES
+  "callback_query",
+#endif
+  nullptr
+};
+
+// Appends allowed_updates to a getUpdates command, as URL encoded JSON
+static void appendAllowedUpdates(String& command) {
+  command += F("&allowed_updates=%5B");
+  for (int i = 0; ALLOWED_UPDATES[i] != nullptr; i++) {
+    if (i > 0) command += F("%2C");
+    command += F("%22");
+    command += ALLOWED_UPDATES[i];
+    command += F("%22");
+  }
+  command += F("%5D");
+}
+
+UniversalTelegramBot::UniversalTelegramBot(const String& token, Client &client, int messageQueueSize)
+    : messageQueueSize(messageQueueSize > 0 ? messageQueueSize : 1) {
   updateToken(token);
   this->client = &client;
+  // Allocated once, the slots are reused for every batch of updates
+  messages = new telegramMessage[this->messageQueueSize];
+}
+
+UniversalTelegramBot::~UniversalTelegramBot() {
+  delete[] messages;
+  delete[] updates;
+  delete[] _arena;
 }
 
 void UniversalTelegramBot::updateToken(const String& token) {
@@ -64,77 +102,272 @@ String UniversalTelegramBot::buildCommand(const String& cmd) {
 
 String UniversalTelegramBot::sendGetToTelegram(const String& command) {
   String body, headers;
-  
-  // Connect with api.telegram.org if not already connected
-  if (!client->connected()) {
-    #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT]Connecting to server"));
-    #endif
-    if (!client->connect(TELEGRAM_HOST, TELEGRAM_SSL_PORT)) {
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT]Conection error"));
-      #endif
-    }
-  }
-  if (client->connected()) {
-
-    #ifdef TELEGRAM_DEBUG  
-        Serial.println("sending: " + command);
-    #endif  
 
-    client->print(F("GET /"));
-    client->print(command);
-    client->println(F(" HTTP/1.1"));
-    client->println(F("Host:" TELEGRAM_HOST));
-    client->println(F("Accept: application/json"));
-    client->println(F("Cache-Control: no-cache"));
-    client->println();
+  abortAsyncRequest();
 
-    readHTTPAnswer(body, headers);
+  bool sent = sendGetRequest(command);
+  if ((!sent || !readHTTPAnswer(body, headers)) && resendOnNewConnection(sent)) {
+    if (sendGetRequest(command)) readHTTPAnswer(body, headers);
   }
 
   return body;
 }
 
+bool UniversalTelegramBot::sendGetRequest(const String& command) {
+  startMetrics(command);
+  if (!connectClient()) return false;
+
+  #ifdef TELEGRAM_DEBUG  
+      Serial.println("sending: " + command);
+  #endif  
+
+  TelegramBufferedPrint request(*client);
+  writeRequestHead(request, F("GET"), command, -1);
+  return endRequest(request);
+}
+
+// Request line and headers, contentLength < 0 means there is no body
+void UniversalTelegramBot::writeRequestHead(Print& request, const __FlashStringHelper* method,
+                                            const String& command, long contentLength,
+                                            bool multipart) {
+  request.print(method);
+  request.print(F(" /"));
+  request.print(command);
+  request.println(F(" HTTP/1.1"));
+  // Host header
+  request.print(F("Host:"));
+  request.println(serverHost);
+  if (contentLength < 0) {
+    request.println(F("Accept: application/json"));
+    request.println(F("Cache-Control: no-cache"));
+  } else if (multipart) {
+    // As uploads always had them
+    request.println(F("User-Agent: arduino/1.0"));
+    request.println(F("Accept: */*"));
+    request.println(F("Content-Type: multipart/form-data; boundary=" TELEGRAM_MULTIPART_BOUNDARY));
+    request.print(F("Content-Length:"));
+    request.println(contentLength);
+  } else {
+    // JSON content type
+    request.println(F("Content-Type: application/json"));
+    request.print(F("Content-Length:"));
+    request.println(contentLength);
+  }
+  request.println(F("Connection: keep-alive"));
+  // End of headers
+  request.println();
+}
+
+/***************************************************************
+ * ReadHTTPAnswer - reads one complete response, the body is   *
+ * framed by Content-Length or chunked transfer encoding       *
+ * Bodies longer than maxMessageLength are truncated but still *
+ * read to the end so the connection stays usable              *
+ * Returns false if no complete response was received, the    *
+ * reason is left in _lastError                                *
+ ***************************************************************/
 bool UniversalTelegramBot::readHTTPAnswer(String &body, String &headers) {
-  int ch_count = 0;
-  unsigned long now = millis();
-  bool finishedHeaders = false;
-  bool currentLineIsBlank = true;
-  bool responseReceived = false;
-
-  while (millis() - now < longPoll * 1000 + waitForResponse) {
-    while (client->available()) {
-      char c = client->read();
-      responseReceived = true;
-
-      if (!finishedHeaders) {
-        if (currentLineIsBlank && c == '\n') {
-          finishedHeaders = true;
-        } else {
-          headers += c;
-        }
-      } else {
-        if (ch_count < maxMessageLength) {
-          body += c;
-          ch_count++;
+  unsigned long timeout = longPoll * 1000 + waitForResponse;
+  unsigned long lastReceived = millis();
+  bool tooLarge = false;
+
+  _http.reset();
+  while (!_http.complete() && !_http.failed()) {
+    if (_rx.length() > 0 || _rx.fill(*client) > 0) {
+      bool inHeaders = !_http.headersComplete();
+      size_t bodyLength;
+      size_t used = _http.feed(_rx.data(), _rx.length(), bodyLength);
+
+      if (inHeaders) {
+        _rx.appendTo(headers, _rx.data(), used - bodyLength);
+        if (_http.headersComplete() && _http.contentLength > 0)
+          body.reserve(min(_http.contentLength, (long)maxMessageLength));
+      }
+      if (bodyLength > 0) {
+        char *bodyStart = _rx.data() + used - bodyLength;
+        unsigned int room = body.length() < (unsigned int)maxMessageLength
+                                ? maxMessageLength - body.length() : 0;
+        if (bodyLength > room) {
+          bodyLength = room;
+          tooLarge = true;
         }
+        _rx.appendTo(body, bodyStart, bodyLength);
       }
+      _rx.consume(used);
+      // The response has started, from now on only wait for gaps
+      lastReceived = millis();
+      timeout = waitForResponse;
+    } else if (!client->connected()) {
+      // Half-closed by the server, nothing more is coming
+      _http.finish();
+    } else if (millis() - lastReceived >= timeout) {
+      break;
+    }
+  }
+
+  #ifdef TELEGRAM_DEBUG  
+    Serial.println();
+    Serial.println(body);
+    Serial.println();
+  #endif
+  finishResponse();
+  if (tooLarge && _http.complete()) _lastError = TELEGRAM_ERROR_RESPONSE_TOO_LARGE;
+  return _http.complete();
+}
 
-      if (c == '\n') currentLineIsBlank = true;
-      else if (c != '\r') currentLineIsBlank = false;
+// Records the outcome of the response in _http and whether the connection
+// can be used for the next request
+void UniversalTelegramBot::finishResponse() {
+  _lastActivity = millis();
+  _connectionReusable = _http.complete() && _http.keepAlive;
+  _serverKeepAliveTimeout = _http.keepAliveTimeout;
+
+  if (_http.complete()) {
+    if (_http.statusCode >= 200 && _http.statusCode < 300)
+      _lastError = TELEGRAM_ERROR_NONE;
+    else
+      _lastError = _http.statusCode;
+  } else if (_http.failed()) {
+    _lastError = _http.error();
+  } else {
+    _lastError = TELEGRAM_ERROR_TIMEOUT;
+  }
+
+  if (_requestPending) {
+    unsigned long firstBlock = _rx.firstBlock();
+    if (firstBlock != 0) {
+      _request.phases[TELEGRAM_PHASE_FIRST_BYTE] = firstBlock - _phaseStart;
+      _request.phases[TELEGRAM_PHASE_BODY] = _lastActivity - firstBlock;
+    } else {
+      _request.phases[TELEGRAM_PHASE_FIRST_BYTE] = _lastActivity - _phaseStart;
     }
+    finishMetrics();
+  }
+}
 
-    if (responseReceived) {
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println();
-        Serial.println(body);
-        Serial.println();
-      #endif
-      break;
+/*
+   **** Metrics ****
+   startMetrics() opens a record for a request, connectClient() and
+   endRequest() time the connect and send phases, finishResponse() the wait
+   for the first byte and the rest of the body. A request that fails before
+   its response is recorded where it fails, one left open otherwise is
+   recorded when the next one starts
+ */
+
+void UniversalTelegramBot::startMetrics(const String& command) {
+  finishMetrics();
+  _requestEndpoint = &metrics.endpoint(command.c_str());
+  _request = TelegramRequestMetrics();
+  _request.endpoint = _requestEndpoint->name;
+  _requestPending = true;
+  _requestReceived = _rx.received();
+  _phaseStart = millis();
+}
+
+// Sends what is left of a request, true if the client accepted all of it
+bool UniversalTelegramBot::endRequest(TelegramBufferedPrint& request) {
+  request.flush();
+  metrics.bytesOut += request.written();
+  _rx.expectResponse();
+  if (_requestPending) {
+    unsigned long now = millis();
+    _request.bytesOut += request.written();
+    _request.phases[TELEGRAM_PHASE_SEND] = now - _phaseStart;
+    _phaseStart = now;
+  }
+  if (request.failed()) {
+    _lastError = TELEGRAM_ERROR_CONNECTION;
+    finishMetrics();
+    return false;
+  }
+  return true;
+}
+
+// Adds the open record to the totals and hands it to the sink
+void UniversalTelegramBot::finishMetrics() {
+  if (!_requestPending) return;
+  _requestPending = false;
+
+  _request.error = _lastError;
+  _request.bytesIn = _rx.received() - _requestReceived;
+  metrics.bytesIn += _request.bytesIn;
+  metrics.record(*_requestEndpoint, _request);
+  if (metricsSink != nullptr) metricsSink(_request);
+}
+
+/***************************************************************
+ * ConnectClient - makes sure there is a usable connection to  *
+ * api.telegram.org. An open connection is reused unless it    *
+ * has been idle for longer than the keep-alive timeout or     *
+ * still holds unread data, otherwise a new one is opened      *
+ ***************************************************************/
+bool UniversalTelegramBot::connectClient() {
+  _reusedConnection = false;
+
+  if (client->connected()) {
+    unsigned long idleLimit = keepAliveTimeout;
+    if (_serverKeepAliveTimeout > 0 && _serverKeepAliveTimeout < idleLimit)
+      idleLimit = _serverKeepAliveTimeout;
+
+    if (!keepAlive || !_connectionReusable ||
+        millis() - _lastActivity >= idleLimit * 1000ul) {
+      // The last response went wrong or the server has most likely dropped
+      // the connection already
+      closeClient();
+    } else if (_rx.length() > 0 || client->available()) {
+      // Leftovers from an earlier response, we lost track of the framing
+      closeClient();
+    } else {
+      _reusedConnection = true;
+      return true;
     }
   }
-  return responseReceived;
+
+  // Nothing read on an earlier connection belongs to the new one, also when
+  // the server closed it before we did
+  _rx.clear();
+  _http.reset();
+
+  #ifdef TELEGRAM_DEBUG  
+      Serial.println(F("[BOT Client]Connecting to server"));
+  #endif
+  if (!client->connect(serverHost, serverPort)) {
+    #ifdef TELEGRAM_DEBUG  
+      Serial.println(F("[BOT Client]Conection error"));
+    #endif
+    _lastError = TELEGRAM_ERROR_CONNECTION;
+    finishMetrics();
+    return false;
+  }
+  metrics.handshakes++;
+  _lastActivity = millis();
+  if (_requestPending) {
+    _request.newConnection = true;
+    _request.phases[TELEGRAM_PHASE_CONNECT] = _lastActivity - _phaseStart;
+    _phaseStart = _lastActivity;
+  }
+  _serverKeepAliveTimeout = 0;
+  _connectionReusable = true;
+  return true;
+}
+
+/***************************************************************
+ * ResendOnNewConnection - called when a request on a kept-    *
+ * alive connection failed. The connection may have gone stale *
+ * without us noticing, the request is only repeated if the    *
+ * server cannot have seen it: the write failed, or the        *
+ * connection was closed before any byte of the response.      *
+ * Never after a timeout, the server may be handling it        *
+ * Returns true, with the client closed, to send it again      *
+ ***************************************************************/
+bool UniversalTelegramBot::resendOnNewConnection(bool sent) {
+  if (!_reusedConnection) return false;
+
+  bool stale = sent ? _http.failed() && _http.error() == TELEGRAM_ERROR_CONNECTION_CLOSED &&
+                          _rx.firstBlock() == 0
+                    : _lastError == TELEGRAM_ERROR_CONNECTION;
+  if (stale) closeClient();
+  return stale;
 }
 
 String UniversalTelegramBot::sendPostToTelegram(const String& command, JsonObject payload) {
@@ -142,46 +375,143 @@ String UniversalTelegramBot::sendPostToTelegram(const String& command, JsonObjec
   String body;
   String headers;
 
-  // Connect with api.telegram.org if not already connected
-  if (!client->connected()) {
-    #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT Client]Connecting to server"));
-    #endif
-    if (!client->connect(TELEGRAM_HOST, TELEGRAM_SSL_PORT)) {
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT Client]Conection error"));
-      #endif
+  abortAsyncRequest();
+
+  bool sent = sendPostRequest(command, payload);
+  if ((!sent || !readHTTPAnswer(body, headers)) && resendOnNewConnection(sent)) {
+    if (sendPostRequest(command, payload)) readHTTPAnswer(body, headers);
+  }
+
+  return body;
+}
+
+bool UniversalTelegramBot::sendPostRequest(const String& command, JsonObject payload) {
+  startMetrics(command);
+  if (!connectClient()) return false;
+
+  // The payload is serialized straight into the request, no copy of it is
+  // ever held in memory
+  TelegramBufferedPrint request(*client);
+  writeRequestHead(request, F("POST"), command, measureJson(payload));
+  // POST message body
+  serializeJson(payload, request);
+  #ifdef TELEGRAM_DEBUG
+      Serial.print(F("Posting:"));
+      serializeJson(payload, Serial);
+      Serial.println();
+  #endif
+  return endRequest(request);
+}
+
+// Same as above for a payload that has been serialized already
+bool UniversalTelegramBot::sendPostRequest(const String& command, const String& payload) {
+  startMetrics(command);
+  if (!connectClient()) return false;
+
+  TelegramBufferedPrint request(*client);
+  writeRequestHead(request, F("POST"), command, payload.length());
+  request.print(payload);
+  #ifdef TELEGRAM_DEBUG
+      Serial.println("Posting:" + payload);
+  #endif
+  return endRequest(request);
+}
+
+// Short escape of a character in a JSON string, 0 if it has none
+static char jsonEscape(char c) {
+  switch (c) {
+    case '"': return '"';
+    case '\\': return '\\';
+    case '\b': return 'b';
+    case '\f': return 'f';
+    case '\n': return 'n';
+    case '\r': return 'r';
+    case '\t': return 't';
+    default: return 0;
+  }
+}
+
+static size_t jsonStringLength(const char *s, size_t length) {
+  size_t size = 2;
+  for (size_t i = 0; i < length; i++) {
+    if (jsonEscape(s[i])) size += 2;
+    else if ((uint8_t)s[i] < 0x20) size += 6;
+    else size++;
+  }
+  return size;
+}
+
+// The characters of a JSON string, escaped, without the quotes
+static void printJsonChars(Print& out, const char *s, size_t length) {
+  size_t start = 0;
+  for (size_t i = 0; i < length; i++) {
+    char escape = jsonEscape(s[i]);
+    if (escape == 0 && (uint8_t)s[i] >= 0x20) continue;
+
+    out.write((const uint8_t *)s + start, i - start);
+    start = i + 1;
+    if (escape) {
+      out.print('\\');
+      out.print(escape);
+    } else {
+      char unicode[7];
+      snprintf(unicode, sizeof(unicode), "\\u%04x", s[i]);
+      out.print(unicode);
     }
   }
-  if (client->connected()) {
-    // POST URI
-    client->print(F("POST /"));
-    client->print(command);
-    client->println(F(" HTTP/1.1"));
-    // Host header
-    client->println(F("Host:" TELEGRAM_HOST));
-    // JSON content type
-    client->println(F("Content-Type: application/json"));
-
-    // Content length
-    int length = measureJson(payload);
-    client->print(F("Content-Length:"));
-    client->println(length);
-    // End of headers
-    client->println();
-    // POST message body
-    String out;
-    serializeJson(payload, out);
-    
-    client->println(out);
-    #ifdef TELEGRAM_DEBUG
-        Serial.println(String("Posting:") + out);
-    #endif
+  out.write((const uint8_t *)s + start, length - start);
+}
 
-    readHTTPAnswer(body, headers);
+/***************************************************************
+ * SendPostRequest - POSTs payload with part of a long text as *
+ * its "text" member. The part is escaped as it is written     *
+ * into the request instead of being copied into the payload   *
+ ***************************************************************/
+bool UniversalTelegramBot::sendPostRequest(const String& command, JsonObject payload,
+                                           const TextPart& part) {
+  startMetrics(command);
+  if (!connectClient()) return false;
+
+  // {"text":"...","key":value,...}
+  long contentLength = 5 + jsonStringLength(part.text, part.length) +
+                       jsonStringLength(part.opening->c_str(), part.opening->length()) +
+                       jsonStringLength(part.closing->c_str(), part.closing->length());
+  for (JsonPair member : payload) {
+    const char *key = member.key().c_str();
+    if (strcmp(key, "text") == 0 || (!part.last && strcmp(key, "reply_markup") == 0)) continue;
+    contentLength += strlen(key) + 4 + measureJson(member.value());
   }
 
-  return body;
+  TelegramBufferedPrint request(*client);
+  writeRequestHead(request, F("POST"), command, contentLength);
+  request.print(F("{\"text\":\""));
+  printJsonChars(request, part.opening->c_str(), part.opening->length());
+  printJsonChars(request, part.text, part.length);
+  printJsonChars(request, part.closing->c_str(), part.closing->length());
+  request.print('"');
+  for (JsonPair member : payload) {
+    const char *key = member.key().c_str();
+    if (strcmp(key, "text") == 0 || (!part.last && strcmp(key, "reply_markup") == 0)) continue;
+    request.print(F(",\""));
+    request.print(key);
+    request.print(F("\":"));
+    serializeJson(member.value(), request);
+  }
+  request.print('}');
+  #ifdef TELEGRAM_DEBUG
+      Serial.print(F("Posting part of "));
+      Serial.print(part.length);
+      Serial.println(F(" bytes"));
+  #endif
+  return endRequest(request);
+}
+
+// GET of command without payload, else a POST of it or a part of its text
+bool UniversalTelegramBot::sendRequest(const String& command, JsonObject *payload,
+                                       const TextPart *part) {
+  if (payload == nullptr) return sendGetRequest(command);
+  if (part != nullptr) return sendPostRequest(command, *payload, *part);
+  return sendPostRequest(command, *payload);
 }
 
 String UniversalTelegramBot::sendMultipartFormDataToTelegram(
@@ -192,124 +522,68 @@ String UniversalTelegramBot::sendMultipartFormDataToTelegram(
     GetNextBuffer getNextBufferCallback,
     GetNextBufferLen getNextBufferLenCallback) {
 
+  TelegramUpload upload;
+  upload.addField("chat_id", chat_id);
+  upload.addFile(binaryPropertyName.c_str(), fileName.c_str(), contentType.c_str(), fileSize,
+                 moreDataAvailableCallback, getNextByteCallback,
+                 getNextBufferCallback, getNextBufferLenCallback);
+  return sendMultipart(command, upload);
+}
+
+/***************************************************************
+ * SendMultipart - uploads the fields and files of upload to   *
+ * the Bot API method (e.g. "sendDocument")                    *
+ * File data is sent in blocks of uploadChunkSize, the         *
+ * progress is reported to uploadProgress                      *
+ * Returns the response                                        *
+ ***************************************************************/
+String UniversalTelegramBot::sendMultipart(const String& method, const TelegramUpload& upload) {
   String body;
   String headers;
-  
-  const String boundary = F("------------------------b8f610217e83e29b");
 
-  // Connect with api.telegram.org if not already connected
-  if (!client->connected()) {
-    #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT Client]Connecting to server"));
-    #endif
-    if (!client->connect(TELEGRAM_HOST, TELEGRAM_SSL_PORT)) {
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println(F("[BOT Client]Conection error"));
-      #endif
-    }
-  }
-  if (client->connected()) {
-    String start_request;
-    String end_request;
-    
+  abortAsyncRequest();
 
-    start_request += F("--");
-    start_request += boundary;
-    start_request += F("\r\ncontent-disposition: form-data; name=\"chat_id\"\r\n\r\n");
-    start_request += chat_id;
-    start_request += F("\r\n" "--");
-    start_request += boundary;
-    start_request += F("\r\ncontent-disposition: form-data; name=\"");
-    start_request += binaryPropertyName;
-    start_request += F("\"; filename=\"");
-    start_request += fileName;
-    start_request += F("\"\r\n" "Content-Type: ");
-    start_request += contentType;
-    start_request += F("\r\n" "\r\n");
-
-    end_request += F("\r\n" "--");
-    end_request += boundary;
-    end_request += F("--" "\r\n");
-
-    client->print(F("POST /"));
-    client->print(buildCommand(command));
-    client->println(F(" HTTP/1.1"));
-    // Host header
-    client->println(F("Host: " TELEGRAM_HOST)); // bugfix - https://github.com/witnessmenow/Universal-Arduino-Telegram-Bot/issues/186
-    client->println(F("User-Agent: arduino/1.0"));
-    client->println(F("Accept: */*"));
-
-    int contentLength = fileSize + start_request.length() + end_request.length();
-    #ifdef TELEGRAM_DEBUG  
-        Serial.println("Content-Length: " + String(contentLength));
-    #endif
-    client->print(F("Content-Length: "));
-    client->println(String(contentLength));
-    client->print(F("Content-Type: multipart/form-data; boundary="));
-    client->println(boundary);
-    client->println();
-    client->print(start_request);
+  String command = buildCommand(method);
+  startMetrics(command);
+  if (connectClient()) {
+    TelegramBufferedPrint request(*client);
+    writeRequestHead(request, F("POST"), command, upload.contentLength(), true);
 
-    #ifdef TELEGRAM_DEBUG  
-     Serial.print("Start request: " + start_request);
-    #endif
+    // The block buffer only exists while uploading
+    uint8_t *chunk = new uint8_t[uploadChunkSize];
+    bool sent = chunk != nullptr && upload.writeTo(request, chunk, uploadChunkSize, uploadProgress);
+    delete[] chunk;
 
-    if (getNextByteCallback == nullptr) {
-        while (moreDataAvailableCallback()) {
-            client->write((const uint8_t *)getNextBufferCallback(), getNextBufferLenCallback());
-            #ifdef TELEGRAM_DEBUG  
-             Serial.println(F("Sending photo from buffer"));
-            #endif
-            }
+    if (endRequest(request) && sent) {
+      readHTTPAnswer(body, headers);
     } else {
-        #ifdef TELEGRAM_DEBUG  
-            Serial.println(F("Sending photo by binary"));
-        #endif
-        byte buffer[512];
-        int count = 0;
-        while (moreDataAvailableCallback()) {
-            buffer[count] = getNextByteCallback();
-            count++;
-            if (count == 512) {
-                // yield();
-                #ifdef TELEGRAM_DEBUG  
-                    Serial.println(F("Sending binary photo full buffer"));
-                #endif
-                client->write((const uint8_t *)buffer, 512);
-                count = 0;
-            }
-        }
-        
-        if (count > 0) {
-            #ifdef TELEGRAM_DEBUG  
-                Serial.println(F("Sending binary photo remaining buffer"));
-            #endif
-            client->write((const uint8_t *)buffer, count);
-        }
+      #ifdef TELEGRAM_DEBUG  
+          Serial.println(F("Upload incomplete"));
+      #endif
+      // The server is still waiting for the rest of the body
+      _lastError = sent ? TELEGRAM_ERROR_CONNECTION : TELEGRAM_ERROR_UPLOAD_INCOMPLETE;
+      finishMetrics();
+      closeClient();
     }
-
-    client->print(end_request);
-    #ifdef TELEGRAM_DEBUG  
-        Serial.print("End request: " + end_request);
-    #endif
-    readHTTPAnswer(body, headers);
   }
 
-  closeClient();
+  checkForOkResponse(body);
+  releaseClient();
   return body;
 }
 
 
 bool UniversalTelegramBot::getMe() {
   String response = sendGetToTelegram(BOT_CMD("getMe")); // receive reply from telegram.org
-  DynamicJsonDocument doc(maxMessageLength);
+  TelegramJsonDocument doc(_json, maxMessageLength);
   DeserializationError error = deserializeJson(doc, ZERO_COPY(response));
-  closeClient();
+  releaseClient();
 
   if (!error) {
     if (doc.containsKey("result")) {
       name = doc["result"]["first_name"].as<String>();
       userName = doc["result"]["username"].as<String>();
+      stateChanged();
       return true;
     }
   }
@@ -317,6 +591,77 @@ bool UniversalTelegramBot::getMe() {
   return false;
 }
 
+/***************************************************************
+ * RestoreState - takes the update offsets, name and userName  *
+ * over from stateStore, if it holds them for this token       *
+ * Returns true if they were restored, getMe() isn't needed    *
+ * then and the next getUpdates picks up where the bot was     *
+ ***************************************************************/
+bool UniversalTelegramBot::restoreState() {
+  TelegramBotState state;
+  if (stateStore == nullptr || !stateStore->load(state) ||
+      !state.valid(TelegramBotState::hash(_token.c_str(), _token.length()))) return false;
+
+  // The queue starts out empty, so with fetchUpdates whatever wasn't
+  // acknowledged has to be received again
+  last_message_received = state.lastAcked > 0 ? state.lastAcked : state.lastReceived;
+  last_message_acked = state.lastAcked;
+  name = state.name;
+  userName = state.userName;
+  _stateDirty = false;
+  #ifdef TELEGRAM_DEBUG
+    Serial.print(F("Restored state, last update "));
+    Serial.println(last_message_received);
+  #endif
+  return true;
+}
+
+// Writes the state to stateStore right away, if it changed
+bool UniversalTelegramBot::persistState() {
+  if (stateStore == nullptr) return false;
+  if (!_stateDirty) return true;
+
+  TelegramBotState state;
+  // Padding included, as the checksum covers it
+  memset(&state, 0, sizeof(state));
+  state.tokenHash = TelegramBotState::hash(_token.c_str(), _token.length());
+  state.lastReceived = last_message_received;
+  state.lastAcked = last_message_acked;
+  TelegramBotState::copy(state.name, name, TELEGRAM_STATE_NAME_LENGTH);
+  TelegramBotState::copy(state.userName, userName, TELEGRAM_STATE_USERNAME_LENGTH);
+  state.seal();
+
+  _stateSaved = true;
+  _stateSavedAt = millis();
+  if (!stateStore->save(state)) return false;
+  _stateDirty = false;
+  return true;
+}
+
+void UniversalTelegramBot::stateChanged() {
+  _stateDirty = true;
+  persistStateIfDue();
+}
+
+// Coalesces writes: the first change is written at once, later ones once
+// persistInterval has passed since the last write
+void UniversalTelegramBot::persistStateIfDue() {
+  if (!_stateDirty || stateStore == nullptr) return;
+  if (_stateSaved && millis() - _stateSavedAt < persistInterval) return;
+  persistState();
+}
+
+/***************************************************************
+ * SetJsonBuffer - builds the JSON documents of the bot in     *
+ * buffer, e.g. a static array, instead of memory it allocates *
+ * itself. It must outlive the bot and should hold             *
+ * maxMessageLength bytes, with streamUpdates or webhooks     *
+ * TELEGRAM_UPDATES_FILTER_SIZE more                           *
+ ***************************************************************/
+void UniversalTelegramBot::setJsonBuffer(char *buffer, size_t size) {
+  _json.use(buffer, size);
+}
+
 /*********************************************************************************
  * SetMyCommands - Update the command list of the bot on the telegram server     *
  * (Argument to pass: Serialied array of BotCommand)                             *
@@ -324,35 +669,102 @@ bool UniversalTelegramBot::getMe() {
  * Returns true, if the command list was updated successfully                    *
  ********************************************************************************/
 bool UniversalTelegramBot::setMyCommands(const String& commandArray) {
-  DynamicJsonDocument payload(maxMessageLength);
-  payload["commands"] = serialized(commandArray);
+  StaticJsonDocument<JSON_OBJECT_SIZE(1)> payload;
+  payload["commands"] = serialized(commandArray.c_str(), commandArray.length());
+  JsonObject object = payload.as<JsonObject>();
   bool sent = false;
-  String response = "";
   #if defined(_debug)
   Serial.println(F("sendSetMyCommands: SEND Post /setMyCommands"));
   #endif  // defined(_debug)
-  unsigned long sttime = millis();
+  retryPolicy.begin();
 
-  while (millis() - sttime < 8000ul) { // loop for a while to send the message
-    response = sendPostToTelegram(BOT_CMD("setMyCommands"), payload.as<JsonObject>());
-    #ifdef _debug  
-    Serial.println("setMyCommands response" + response);
-    #endif
-    sent = checkForOkResponse(response);
-    if (sent) break;
-  }
+  do {
+    sent = sendForResponse(BOT_CMD("setMyCommands"), &object);
+  } while (!sent && retryFailedSend());
 
-  closeClient();
+  releaseClient();
   return sent;
 }
 
+// Sets the bot menu from the commands of a router, so it lists exactly
+// what is dispatched
+bool UniversalTelegramBot::setMyCommands(const TelegramCommandRouter& router) {
+  return setMyCommands(router.commandsJson());
+}
+
 
 /***************************************************************
  * GetUpdates - function to receive messages from telegram *
  * (Argument to pass: the last+1 message to read)             *
- * Returns the number of new messages           *
+ * Returns the number of new messages, stored from messages[0] *
+ * Anything still queued from fetchUpdates is dropped          *
  ***************************************************************/
 int UniversalTelegramBot::getUpdates(long offset) {
+  _queueHead = 0;
+  _queueCount = 0;
+  return requestUpdates(offset, messageQueueSize, TARGET_MESSAGES);
+}
+
+/***************************************************************
+ * PollUpdates - getUpdates for the next unseen update, to be  *
+ * called from loop() as often as liked. pollScheduler decides *
+ * whether a poll is due and the longPoll timeout it waits     *
+ * with, which adapts to how busy the bot is                   *
+ * Returns the number of messages, 0 when no poll was made     *
+ ***************************************************************/
+int UniversalTelegramBot::pollUpdates() {
+  unsigned long now = millis();
+  if (!pollScheduler.due(now)) return 0;
+
+  int configured = longPoll;
+  longPoll = pollScheduler.timeout(waitForResponse);
+  _lastError = TELEGRAM_ERROR_NONE;
+  int received = getUpdates(last_message_received + 1);
+  longPoll = configured;
+
+  pollScheduler.record(received, received == messageQueueSize,
+                       _lastError != TELEGRAM_ERROR_NONE, waitForResponse, millis());
+  return received;
+}
+
+/***************************************************************
+ * FetchUpdates - queues up to messageQueueSize updates in the *
+ * ring buffer, to be drained with nextMessage / ackMessage    *
+ * Updates are only confirmed to telegram (by the offset of    *
+ * the next request) once they have been acknowledged, so      *
+ * unacknowledged ones are delivered again after a reboot      *
+ * Returns the number of newly queued messages                 *
+ ***************************************************************/
+int UniversalTelegramBot::fetchUpdates() {
+  if (_queueCount == messageQueueSize) return 0;
+
+  // Telegram sends the unacknowledged updates we already hold again, they
+  // are skipped, so ask for enough to fill the free slots behind them
+  return requestUpdates(last_message_acked + 1, messageQueueSize, TARGET_QUEUE);
+}
+
+int UniversalTelegramBot::queuedMessages() {
+  return _queueCount;
+}
+
+// The oldest queued message, or nullptr if the queue is empty
+telegramMessage* UniversalTelegramBot::nextMessage() {
+  if (_queueCount == 0) return nullptr;
+  return &messages[_queueHead];
+}
+
+// Marks the oldest queued message as handled and frees its slot
+void UniversalTelegramBot::ackMessage() {
+  if (_queueCount == 0) return;
+  last_message_acked = messages[_queueHead].update_id;
+  _queueHead = (_queueHead + 1) % messageQueueSize;
+  _queueCount--;
+  stateChanged();
+}
+
+int UniversalTelegramBot::requestUpdates(long offset, int limit, UpdateTarget target) {
+  // Changes held back since the last write go out once they are due
+  persistStateIfDue();
 
   #ifdef TELEGRAM_DEBUG  
     Serial.println(F("GET Update Messages"));
@@ -360,12 +772,16 @@ int UniversalTelegramBot::getUpdates(long offset) {
   String command = BOT_CMD("getUpdates?offset=");
   command += offset;
   command += F("&limit=");
-  command += HANDLE_MESSAGES;
+  command += limit;
 
   if (longPoll > 0) {
     command += F("&timeout=");
     command += String(longPoll);
   }
+  // The server remembers it, so it's only sent until a batch got through
+  if (!_allowedUpdatesSent) appendAllowedUpdates(command);
+  if (streamUpdates) return getUpdatesStreaming(command, target);
+
   String response = sendGetToTelegram(command); // receive reply from telegram.org
 
   if (response == "") {
@@ -383,37 +799,17 @@ int UniversalTelegramBot::getUpdates(long offset) {
     #endif
 
     // Parse response into Json object
-    DynamicJsonDocument doc(maxMessageLength);
+    unsigned long parseStart = millis();
+    TelegramJsonDocument doc(_json, maxMessageLength);
     DeserializationError error = deserializeJson(doc, ZERO_COPY(response));
+    metrics.parse.record(millis() - parseStart);
       
     if (!error) {
-      #ifdef TELEGRAM_DEBUG  
-        Serial.print(F("GetUpdates parsed jsonObj: "));
-        serializeJson(doc, Serial);
-        Serial.println();
-      #endif
-      if (doc.containsKey("result")) {
-        int resultArrayLength = doc["result"].size();
-        if (resultArrayLength > 0) {
-          int newMessageIndex = 0;
-          // Step through all results
-          for (int i = 0; i < resultArrayLength; i++) {
-            JsonObject result = doc["result"][i];
-            if (processResult(result, newMessageIndex)) newMessageIndex++;
-          }
-          // We will keep the client open because there may be a response to be
-          // given
-          return newMessageIndex;
-        } else {
-          #ifdef TELEGRAM_DEBUG  
-            Serial.println(F("no new messages"));
-          #endif
-        }
-      } else {
-        #ifdef TELEGRAM_DEBUG  
-            Serial.println(F("Response contained no 'result'"));
-        #endif
-      }
+      // We will keep the client open because there may be a response to be
+      // given
+      int newMessages = processUpdates(doc, target);
+      releaseClient();
+      return newMessages;
     } else { // Parsing failed
       if (response.length() < 2) { // Too short a message. Maybe a connection issue
         #ifdef TELEGRAM_DEBUG  
@@ -429,101 +825,533 @@ int UniversalTelegramBot::getUpdates(long offset) {
         #endif     
       }
     }
-    // Close the client as no response is to be given
+    // Close the client, we can't tell where the response ended
     closeClient();
     return 0;
   }
 }
 
-bool UniversalTelegramBot::processResult(JsonObject result, int messageIndex) {
-  int update_id = result["update_id"];
-  // Check have we already dealt with this message (this shouldn't happen!)
-  if (last_message_received != update_id) {
-    last_message_received = update_id;
-    messages[messageIndex].update_id = update_id;
-    messages[messageIndex].text = F("");
-    messages[messageIndex].from_id = F("");
-    messages[messageIndex].from_name = F("");
-    messages[messageIndex].longitude = 0;
-    messages[messageIndex].latitude = 0;
-    messages[messageIndex].reply_to_message_id = 0;
-    messages[messageIndex].reply_to_text = F("");
-    messages[messageIndex].query_id = F("");
-
-    if (result.containsKey("message")) {
-      JsonObject message = result["message"];
-      messages[messageIndex].type = F("message");
-      messages[messageIndex].from_id = message["from"]["id"].as<String>();
-      messages[messageIndex].from_name = message["from"]["first_name"].as<String>();
-      messages[messageIndex].date = message["date"].as<String>();
-      messages[messageIndex].chat_id = message["chat"]["id"].as<String>();
-      messages[messageIndex].chat_title = message["chat"]["title"].as<String>();
-      messages[messageIndex].hasDocument = false;
-      messages[messageIndex].message_id = message["message_id"].as<int>();  // added message id
-      if (message.containsKey("text")) {
-        messages[messageIndex].text = message["text"].as<String>();
-          
-      } else if (message.containsKey("location")) {
-        messages[messageIndex].longitude = message["location"]["longitude"].as<float>();
-        messages[messageIndex].latitude  = message["location"]["latitude"].as<float>();
-      } else if (message.containsKey("document")) {
-        String file_id = message["document"]["file_id"].as<String>();
-        messages[messageIndex].file_caption = message["caption"].as<String>();
-        messages[messageIndex].file_name = message["document"]["file_name"].as<String>();
-        if (getFile(messages[messageIndex].file_path, messages[messageIndex].file_size, file_id) == true)
-          messages[messageIndex].hasDocument = true;
-        else
-          messages[messageIndex].hasDocument = false;
-      }
-      if (message.containsKey("reply_to_message")) {
-        messages[messageIndex].reply_to_message_id = message["reply_to_message"]["message_id"];
-        // no need to check if containsKey["text"]. If it doesn't, it default to null
-        messages[messageIndex].reply_to_text = message["reply_to_message"]["text"].as<String>();
-      }
+/***************************************************************
+ * GetUpdatesStreaming - same as getUpdates, but the body is   *
+ * deserialized directly from the client through a filter, so  *
+ * neither the raw body nor unused fields are kept in memory   *
+ ***************************************************************/
+int UniversalTelegramBot::getUpdatesStreaming(const String& command, UpdateTarget target) {
+  TelegramHttpBodyStream body(*client, _http, _rx);
+  unsigned long timeout = longPoll * 1000 + waitForResponse;
+
+  abortAsyncRequest();
+  _http.reset();
+  bool sent = sendGetRequest(command);
+  bool received = sent && body.readHeaders(timeout);
+  if (!received && resendOnNewConnection(sent)) {
+    _http.reset();
+    received = sendGetRequest(command) && body.readHeaders(timeout);
+  }
+  if (!received) {
+    #ifdef TELEGRAM_DEBUG  
+        Serial.println(F("Received no response!"));
+    #endif
+    finishResponse();
+    closeClient();
+    return 0;
+  }
 
-    } else if (result.containsKey("channel_post")) {
-      JsonObject message = result["channel_post"];
-      messages[messageIndex].type = F("channel_post");
-      messages[messageIndex].text = message["text"].as<String>();
-      messages[messageIndex].date = message["date"].as<String>();
-      messages[messageIndex].chat_id = message["chat"]["id"].as<String>();
-      messages[messageIndex].chat_title = message["chat"]["title"].as<String>();
-      messages[messageIndex].message_id = message["message_id"].as<int>();  // added message id
-
-    } else if (result.containsKey("callback_query")) {
-      JsonObject message = result["callback_query"];
-      messages[messageIndex].type = F("callback_query");
-      messages[messageIndex].from_id = message["from"]["id"].as<String>();
-      messages[messageIndex].from_name = message["from"]["first_name"].as<String>();
-      messages[messageIndex].text = message["data"].as<String>();
-      messages[messageIndex].date = message["date"].as<String>();
-      messages[messageIndex].chat_id = message["message"]["chat"]["id"].as<String>();
-      messages[messageIndex].reply_to_text = message["message"]["text"].as<String>();
-      messages[messageIndex].chat_title = F("");
-      messages[messageIndex].query_id = message["id"].as<String>();
-      messages[messageIndex].message_id = message["message"]["message_id"].as<int>();  // added message id
-
-    } else if (result.containsKey("edited_message")) {
-      JsonObject message = result["edited_message"];
-      messages[messageIndex].type = F("edited_message");
-      messages[messageIndex].from_id = message["from"]["id"].as<String>();
-      messages[messageIndex].from_name = message["from"]["first_name"].as<String>();
-      messages[messageIndex].date = message["date"].as<String>();
-      messages[messageIndex].chat_id = message["chat"]["id"].as<String>();
-      messages[messageIndex].chat_title = message["chat"]["title"].as<String>();
-      messages[messageIndex].message_id = message["message_id"].as<int>();  // added message id
-
-      if (message.containsKey("text")) {
-        messages[messageIndex].text = message["text"].as<String>();
-          
-      } else if (message.containsKey("location")) {
-        messages[messageIndex].longitude = message["location"]["longitude"].as<float>();
-        messages[messageIndex].latitude  = message["location"]["latitude"].as<float>();
+  // The filter and the updates share the arena
+  _json.reserve(TELEGRAM_UPDATES_FILTER_SIZE + maxMessageLength);
+  TelegramJsonDocument filter(_json, TELEGRAM_UPDATES_FILTER_SIZE);
+  buildUpdatesFilter(filter);
+
+  // The headers have arrived, the body should follow shortly
+  body.setTimeout(waitForResponse);
+  unsigned long parseStart = millis();
+  TelegramJsonDocument doc(_json, maxMessageLength, TELEGRAM_UPDATES_FILTER_SIZE);
+  DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+  metrics.parse.record(millis() - parseStart);
+  body.drain();
+  finishResponse();
+
+  if (!error && _http.complete()) {
+    int newMessages = processUpdates(doc, target);
+    releaseClient();
+    return newMessages;
+  }
+  #ifdef TELEGRAM_DEBUG 
+      Serial.print(F("Failed to parse update stream. Error code: "));
+      Serial.println(error.c_str());
+  #endif     
+  closeClient();
+  return 0;
+}
+
+/*
+   **** Webhook ****
+   Instead of polling, Telegram can POST every update to a URL as it
+   happens. Telegram only delivers to HTTPS on port 443, 80, 88 or 8443,
+   so the bot usually sits behind a reverse proxy or tunnel that
+   terminates TLS and forwards to a plain WiFiServer. The sketch accepts
+   the connections itself and hands them to handleWebhook(), which queues
+   the update for nextMessage / ackMessage.
+ */
+
+/***************************************************************
+ * SetWebhook - tells Telegram to POST updates to url          *
+ * (secretToken: sent along with every update, to tell them    *
+ * apart from requests by anyone else, 1-256 characters out    *
+ * of A-Z, a-z, 0-9, _ and -)                                  *
+ * getUpdates does not work while a webhook is set, and        *
+ * handleWebhook refuses every update without a secretToken    *
+ ***************************************************************/
+bool UniversalTelegramBot::setWebhook(const String& url, const String& secretToken,
+                                      int maxConnections) {
+  const size_t typeCount = sizeof(ALLOWED_UPDATES) / sizeof(ALLOWED_UPDATES[0]) - 1;
+  StaticJsonDocument<JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(typeCount)> payload;
+  payload["url"] = url.c_str();
+  if (secretToken != "")
+    payload["secret_token"] = secretToken.c_str();
+  if (maxConnections > 0)
+    payload["max_connections"] = maxConnections;
+  JsonArray allowed = payload.createNestedArray("allowed_updates");
+  for (size_t i = 0; i < typeCount; i++)
+    allowed.add(ALLOWED_UPDATES[i]);
+
+  JsonObject object = payload.as<JsonObject>();
+  bool set = sendForResponse(BOT_CMD("setWebhook"), &object);
+  if (set) _webhookSecret = secretToken;
+  releaseClient();
+  return set;
+}
+
+// Goes back to getUpdates, optionally dropping the updates not delivered yet
+bool UniversalTelegramBot::deleteWebhook(bool dropPendingUpdates) {
+  StaticJsonDocument<JSON_OBJECT_SIZE(1)> payload;
+  if (dropPendingUpdates)
+    payload["drop_pending_updates"] = true;
+
+  JsonObject object = payload.to<JsonObject>();
+  bool deleted = sendForResponse(BOT_CMD("deleteWebhook"), &object);
+  if (deleted) _webhookSecret = String();
+  releaseClient();
+  return deleted;
+}
+
+/***************************************************************
+ * SetWebhookSecret - the secretToken handleWebhook expects,   *
+ * for a webhook that Telegram still has from before a reboot  *
+ * without calling setWebhook again                            *
+ ***************************************************************/
+void UniversalTelegramBot::setWebhookSecret(const String& secretToken) {
+  _webhookSecret = secretToken;
+}
+
+static void sendWebhookResponse(Client &connection, int status, const __FlashStringHelper* reason) {
+  TelegramBufferedPrint response(connection);
+  response.print(F("HTTP/1.1 "));
+  response.print(status);
+  response.print(' ');
+  response.println(reason);
+  response.println(F("Content-Length: 0"));
+  response.println(F("Connection: close"));
+  response.println();
+}
+
+/***************************************************************
+ * HandleWebhook - reads an update POSTed to the webhook from  *
+ * a connection accepted by the sketch, answers and closes it  *
+ * Requests without the secret token given to setWebhook or    *
+ * setWebhookSecret are refused, and every request is while    *
+ * there is none. When the queue is full the update is refused *
+ * too, Telegram delivers it again later                       *
+ * Returns the number of newly queued messages (0 or 1)        *
+ ***************************************************************/
+int UniversalTelegramBot::handleWebhook(Client &connection) {
+  TelegramHttpParser request;
+  TelegramReadBuffer buffer;
+  TelegramHttpBodyStream body(connection, request, buffer);
+
+  request.resetRequest();
+  if (_webhookSecret != "") request.secretToken = _webhookSecret.c_str();
+
+  int queued = 0;
+  if (!body.readHeaders(waitForResponse)) {
+    sendWebhookResponse(connection, 400, F("Bad Request"));
+  } else if (_webhookSecret == "") {
+    // Anyone could post updates to an endpoint without a secret
+    sendWebhookResponse(connection, 403, F("Forbidden"));
+  } else if (!request.post) {
+    sendWebhookResponse(connection, 405, F("Method Not Allowed"));
+  } else if (!request.secretTokenValid) {
+    sendWebhookResponse(connection, 401, F("Unauthorized"));
+  } else if (_queueCount == messageQueueSize) {
+    sendWebhookResponse(connection, 503, F("Service Unavailable"));
+  } else {
+    // The body is a single update, filtered like one of getUpdates
+    _json.reserve(TELEGRAM_UPDATES_FILTER_SIZE + maxMessageLength);
+    TelegramJsonDocument filter(_json, TELEGRAM_UPDATES_FILTER_SIZE);
+    buildUpdatesFilter(filter);
+
+    body.setTimeout(waitForResponse);
+    TelegramJsonDocument doc(_json, maxMessageLength, TELEGRAM_UPDATES_FILTER_SIZE);
+    DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter["result"][0]));
+    body.drain();
+
+    if (error || !request.complete()) {
+      #ifdef TELEGRAM_DEBUG 
+          Serial.print(F("Failed to parse webhook update. Error code: "));
+          Serial.println(error.c_str());
+      #endif
+      sendWebhookResponse(connection, 400, F("Bad Request"));
+    } else {
+      // Anything else is delivered again, this one is ours now
+      sendWebhookResponse(connection, 200, F("OK"));
+      if (storeUpdate(doc.as<JsonObject>(), TARGET_QUEUE, 0)) {
+        queued = 1;
+        stateChanged();
       }
     }
+  }
+
+  connection.stop();
+  return queued;
+}
+
+/***************************************************************
+ * BuildUpdatesFilter - fills an ArduinoJson filter with the   *
+ * fields processResult reads, everything else is skipped      *
+ * while parsing                                                *
+ ***************************************************************/
+void UniversalTelegramBot::buildUpdatesFilter(JsonDocument& filter) {
+  filter["ok"] = true;
+  JsonObject update = filter["result"].createNestedObject();
+  update["update_id"] = true;
+
+#if TELEGRAM_READ_MESSAGES || TELEGRAM_READ_EDITED_MESSAGES || TELEGRAM_READ_CHANNEL_POSTS
+  JsonObject message = update.createNestedObject("message");
+  message["message_id"] = true;
+  message["date"] = true;
+  message["text"] = true;
+  message["chat"]["id"] = true;
+#if TELEGRAM_READ_FROM
+  message["from"]["id"] = true;
+  message["from"]["first_name"] = true;
+#endif
+#if TELEGRAM_READ_CHAT_TITLE
+  message["chat"]["title"] = true;
+#endif
+#if TELEGRAM_READ_LOCATION
+  message["location"]["longitude"] = true;
+  message["location"]["latitude"] = true;
+#endif
+#if TELEGRAM_READ_FILES
+  message["caption"] = true;
+  message["document"]["file_id"] = true;
+  message["document"]["file_unique_id"] = true;
+  message["document"]["file_name"] = true;
+  message["document"]["file_size"] = true;
+  // only the last, largest size of a photo is used
+  JsonObject photo = message["photo"].createNestedObject();
+  photo["file_id"] = true;
+  photo["file_unique_id"] = true;
+  photo["file_size"] = true;
+  message["video"] = message["document"];
+  message["voice"]["file_id"] = true;
+  message["voice"]["file_unique_id"] = true;
+  message["voice"]["file_size"] = true;
+#endif
+#if TELEGRAM_READ_REPLY_TO
+  message["reply_to_message"]["message_id"] = true;
+  message["reply_to_message"]["text"] = true;
+#endif
+
+  // edited messages and channel posts are read the same way
+#if TELEGRAM_READ_EDITED_MESSAGES
+  update["edited_message"] = message;
+#endif
+#if TELEGRAM_READ_CHANNEL_POSTS
+  update["channel_post"] = message;
+#endif
+#if !TELEGRAM_READ_MESSAGES
+  update.remove("message");
+#endif
+#endif
+
+#if TELEGRAM_READ_CALLBACK_QUERIES
+  JsonObject query = update.createNestedObject("callback_query");
+  query["id"] = true;
+  query["data"] = true;
+  query["message"]["message_id"] = true;
+  query["message"]["chat"]["id"] = true;
+#if TELEGRAM_READ_FROM
+  query["from"]["id"] = true;
+  query["from"]["first_name"] = true;
+#endif
+#if TELEGRAM_READ_REPLY_TO
+  query["message"]["text"] = true;
+#endif
+#endif
+}
+
+// Steps through the result array of a parsed getUpdates response, appending
+// the new messages to the ring buffer
+int UniversalTelegramBot::processUpdates(JsonDocument& doc, UpdateTarget target) {
+  #ifdef TELEGRAM_DEBUG  
+    Serial.print(F("GetUpdates parsed jsonObj: "));
+    serializeJson(doc, Serial);
+    Serial.println();
+  #endif
+  if (!doc.containsKey("result")) {
+    #ifdef TELEGRAM_DEBUG  
+        Serial.println(F("Response contained no 'result'"));
+    #endif
+    return 0;
+  }
+  _allowedUpdatesSent = true;
+
+  int resultArrayLength = doc["result"].size();
+  int newMessages = 0;
+  // Step through all results
+  for (int i = 0; i < resultArrayLength; i++) {
+    if (target == TARGET_COMPACT ? newMessages == messageQueueSize
+                                 : _queueCount == messageQueueSize) break;
+
+    if (storeUpdate(doc["result"][i], target, newMessages)) newMessages++;
+  }
+  #ifdef TELEGRAM_DEBUG  
+    if (newMessages == 0) Serial.println(F("no new messages"));
+  #endif
+  if (newMessages > 0) stateChanged();
+  return newMessages;
+}
+
+// Stores one update of a response, index is its slot in updates[] for
+// TARGET_COMPACT. Returns false if it was skipped
+bool UniversalTelegramBot::storeUpdate(JsonObject result, UpdateTarget target, int index) {
+  if (target == TARGET_QUEUE && result["update_id"].as<long>() <= last_message_received) return false;
+
+  telegramUpdate update;
+  if (!processResult(result, update)) return false;
+
+  if (target == TARGET_COMPACT) {
+    arenaStore(update);
+    updates[index] = update;
+  } else {
+    telegramMessage& message = messages[(_queueHead + _queueCount) % messageQueueSize];
+    update.toMessage(message);
+    _queueCount++;
+  }
+  return true;
+}
+
+// Strings of a parsed update are views, missing ones point to an empty string
+static const char* jsonView(JsonVariant value) {
+  const char* str = value.as<const char*>();
+  return str != nullptr ? str : "";
+}
+
+static String int64ToString(int64_t value) {
+  // An id or date of 0 means the field was missing
+  if (value == 0) return String();
+
+  char buffer[21];
+  char *p = buffer + sizeof(buffer);
+  uint64_t digits = value < 0 ? -(uint64_t)value : (uint64_t)value;
+  *--p = '\0';
+  do {
+    *--p = '0' + digits % 10;
+    digits /= 10;
+  } while (digits > 0);
+  if (value < 0) *--p = '-';
+  return String(p);
+}
+
+bool UniversalTelegramBot::processResult(JsonObject result, telegramUpdate& update) {
+  int update_id = result["update_id"];
+  // Check have we already dealt with this message (this shouldn't happen!)
+  if (last_message_received == update_id) return false;
+
+  last_message_received = update_id;
+  update = telegramUpdate();
+  update.update_id = update_id;
+
+  // Each type is only looked for if it's read at all
+#if TELEGRAM_READ_MESSAGES
+  if (result.containsKey("message")) {
+    update.type = TELEGRAM_UPDATE_MESSAGE;
+    processMessage(result["message"], update);
     return true;
   }
-  return false;
+#endif
+#if TELEGRAM_READ_CHANNEL_POSTS
+  if (result.containsKey("channel_post")) {
+    update.type = TELEGRAM_UPDATE_CHANNEL_POST;
+    processMessage(result["channel_post"], update);
+    return true;
+  }
+#endif
+#if TELEGRAM_READ_CALLBACK_QUERIES
+  if (result.containsKey("callback_query")) {
+    JsonObject query = result["callback_query"];
+    update.type = TELEGRAM_UPDATE_CALLBACK_QUERY;
+#if TELEGRAM_READ_FROM
+    update.from_id = query["from"]["id"].as<int64_t>();
+    update.from_name = jsonView(query["from"]["first_name"]);
+#endif
+    update.text = jsonView(query["data"]);
+    update.date = query["date"].as<int64_t>();
+    update.chat_id = query["message"]["chat"]["id"].as<int64_t>();
+#if TELEGRAM_READ_REPLY_TO
+    update.reply_to_text = jsonView(query["message"]["text"]);
+#endif
+    update.query_id = jsonView(query["id"]);
+    update.message_id = query["message"]["message_id"].as<int32_t>();
+    return true;
+  }
+#endif
+#if TELEGRAM_READ_EDITED_MESSAGES
+  if (result.containsKey("edited_message")) {
+    update.type = TELEGRAM_UPDATE_EDITED_MESSAGE;
+    processMessage(result["edited_message"], update);
+    return true;
+  }
+#endif
+  return true;
+}
+
+// Messages, edited messages and channel posts share the same layout
+void UniversalTelegramBot::processMessage(JsonObject message, telegramUpdate& update) {
+  update.date = message["date"].as<int64_t>();
+  update.chat_id = message["chat"]["id"].as<int64_t>();
+  update.message_id = message["message_id"].as<int32_t>();
+  update.text = jsonView(message["text"]);
+#if TELEGRAM_READ_FROM
+  update.from_id = message["from"]["id"].as<int64_t>();
+  update.from_name = jsonView(message["from"]["first_name"]);
+#endif
+#if TELEGRAM_READ_CHAT_TITLE
+  update.chat_title = jsonView(message["chat"]["title"]);
+#endif
+
+#if TELEGRAM_READ_LOCATION
+  if (message.containsKey("location")) {
+    update.longitude = message["location"]["longitude"].as<float>();
+    update.latitude  = message["location"]["latitude"].as<float>();
+  }
+#endif
+#if TELEGRAM_READ_FILES
+  update.file_caption = jsonView(message["caption"]);
+  if (message.containsKey("document")) {
+    update.file_type = TELEGRAM_FILE_DOCUMENT;
+    processFile(message["document"], update);
+  } else if (message.containsKey("photo")) {
+    update.file_type = TELEGRAM_FILE_PHOTO;
+    JsonArray sizes = message["photo"];
+    processFile(sizes[sizes.size() - 1], update);
+  } else if (message.containsKey("video")) {
+    update.file_type = TELEGRAM_FILE_VIDEO;
+    processFile(message["video"], update);
+  } else if (message.containsKey("voice")) {
+    update.file_type = TELEGRAM_FILE_VOICE;
+    processFile(message["voice"], update);
+  }
+#endif
+#if TELEGRAM_READ_REPLY_TO
+  if (message.containsKey("reply_to_message")) {
+    update.reply_to_message_id = message["reply_to_message"]["message_id"].as<int32_t>();
+    update.reply_to_text = jsonView(message["reply_to_message"]["text"]);
+  }
+#endif
+}
+
+// Only the ids and size are read, the path is looked up when it's needed
+void UniversalTelegramBot::processFile(JsonObject file, telegramUpdate& update) {
+  update.file_id = jsonView(file["file_id"]);
+  update.file_unique_id = jsonView(file["file_unique_id"]);
+  update.file_name = jsonView(file["file_name"]);
+  update.file_size = file["file_size"].as<int32_t>();
+}
+
+/***************************************************************
+ * GetCompactUpdates - like getUpdates, but fills updates[]    *
+ * with compact records. Their strings live in an arena that   *
+ * is reused by the next call, copy what must outlive it       *
+ * Returns the number of new updates                           *
+ ***************************************************************/
+int UniversalTelegramBot::getCompactUpdates(long offset) {
+  // Allocated on first use only, the strings of a batch never add up to
+  // more than the body they were parsed from
+  if (updates == nullptr) updates = new telegramUpdate[messageQueueSize];
+  if (_arenaSize != (size_t)maxMessageLength) {
+    // maxMessageLength was changed since
+    delete[] _arena;
+    _arenaSize = maxMessageLength;
+    _arena = new char[_arenaSize];
+  }
+  _arenaUsed = 0;
+  return requestUpdates(offset, messageQueueSize, TARGET_COMPACT);
+}
+
+// Copies a string of the current batch into the arena
+const char* UniversalTelegramBot::arenaStore(const char* str) {
+  size_t length = strlen(str);
+  if (length == 0) return "";
+  if (_arenaUsed + length + 1 > _arenaSize) {
+    _lastError = TELEGRAM_ERROR_RESPONSE_TOO_LARGE;
+    return "";
+  }
+
+  char *stored = _arena + _arenaUsed;
+  memcpy(stored, str, length + 1);
+  _arenaUsed += length + 1;
+  return stored;
+}
+
+void UniversalTelegramBot::arenaStore(telegramUpdate& update) {
+  update.text = arenaStore(update.text);
+  update.chat_title = arenaStore(update.chat_title);
+  update.from_name = arenaStore(update.from_name);
+  update.file_caption = arenaStore(update.file_caption);
+  update.file_id = arenaStore(update.file_id);
+  update.file_unique_id = arenaStore(update.file_unique_id);
+  update.file_name = arenaStore(update.file_name);
+  update.reply_to_text = arenaStore(update.reply_to_text);
+  update.query_id = arenaStore(update.query_id);
+}
+
+String telegramUpdate::typeString() const {
+  switch (type) {
+    case TELEGRAM_UPDATE_MESSAGE: return F("message");
+    case TELEGRAM_UPDATE_EDITED_MESSAGE: return F("edited_message");
+    case TELEGRAM_UPDATE_CHANNEL_POST: return F("channel_post");
+    case TELEGRAM_UPDATE_CALLBACK_QUERY: return F("callback_query");
+    default: return String();
+  }
+}
+
+// Compatibility accessor, fills the String based telegramMessage
+void telegramUpdate::toMessage(telegramMessage& message) const {
+  message.update_id = update_id;
+  message.type = typeString();
+  message.update_type = type;
+  message.text = text;
+  message.chat_id = int64ToString(chat_id);
+  message.chat_title = chat_title;
+  message.from_id = int64ToString(from_id);
+  message.from_name = from_name;
+  message.date = int64ToString(date);
+  message.message_id = message_id;
+  message.file_caption = file_caption;
+  message.file_name = file_name;
+  message.file_id = file_id;
+  message.file_unique_id = file_unique_id;
+  message.file_path = F("");
+  message.file_size = file_size;
+  message.file_type = file_type;
+  message.hasDocument = file_type == TELEGRAM_FILE_DOCUMENT;
+  message.longitude = longitude;
+  message.latitude = latitude;
+  message.reply_to_message_id = reply_to_message_id;
+  message.reply_to_text = reply_to_text;
+  message.query_id = query_id;
 }
 
 /***********************************************************************
@@ -537,40 +1365,37 @@ bool UniversalTelegramBot::sendSimpleMessage(const String& chat_id, const String
   #ifdef TELEGRAM_DEBUG  
     Serial.println(F("sendSimpleMessage: SEND Simple Message"));
   #endif
-  unsigned long sttime = millis();
+  retryPolicy.begin();
 
   if (text != "") {
-    while (millis() - sttime < 8000ul) { // loop for a while to send the message
-      String command = BOT_CMD("sendMessage?chat_id=");
-      command += chat_id;
-      command += F("&text=");
-      command += text;
-      command += F("&parse_mode=");
-      command += parse_mode;
-      String response = sendGetToTelegram(command);
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println(response);
-      #endif
-      sent = checkForOkResponse(response);
-      if (sent) break;
-    }
+    String command = BOT_CMD("sendMessage?chat_id=");
+    command += chat_id;
+    command += F("&text=");
+    command += text;
+    command += F("&parse_mode=");
+    command += parse_mode;
+    do {
+      sent = sendForResponse(command);
+    } while (!sent && retryFailedSend());
   }
-  closeClient();
+  releaseClient();
   return sent;
 }
 
 bool UniversalTelegramBot::sendMessage(const String& chat_id, const String& text,
                                        const String& parse_mode, int message_id) { // added message_id
 
-  DynamicJsonDocument payload(maxMessageLength);
-  payload["chat_id"] = chat_id;
-  payload["text"] = text;
+  // Strings are stored as pointers to the arguments, so the document only
+  // needs room for the members themselves
+  StaticJsonDocument<JSON_OBJECT_SIZE(4)> payload;
+  payload["chat_id"] = chat_id.c_str();
+  payload["text"] = text.c_str();
 
   if (message_id != 0)
     payload["message_id"] = message_id; // added message_id
 
   if (parse_mode != "")
-    payload["parse_mode"] = parse_mode;
+    payload["parse_mode"] = parse_mode.c_str();
 
   return sendPostMessage(payload.as<JsonObject>(), message_id); // if message id == 0 then edit is false, else edit is true
 }
@@ -578,17 +1403,33 @@ bool UniversalTelegramBot::sendMessage(const String& chat_id, const String& text
 bool UniversalTelegramBot::sendMessageWithReplyKeyboard(
     const String& chat_id, const String& text, const String& parse_mode, const String& keyboard,
     bool resize, bool oneTime, bool selective) {
+  return sendReplyKeyboardMessage(chat_id, text, parse_mode, keyboard.c_str(), keyboard.length(),
+                                  resize, oneTime, selective);
+}
+
+bool UniversalTelegramBot::sendMessageWithReplyKeyboard(
+    const String& chat_id, const String& text, const String& parse_mode,
+    const TelegramKeyboard& keyboard, bool resize, bool oneTime, bool selective) {
+  if (keyboard.failed()) return false;
+  return sendReplyKeyboardMessage(chat_id, text, parse_mode, keyboard.c_str(), keyboard.length(),
+                                  resize, oneTime, selective);
+}
+
+// The keyboard is written into the request as it is, without a copy
+bool UniversalTelegramBot::sendReplyKeyboardMessage(
+    const String& chat_id, const String& text, const String& parse_mode, const char *keyboard,
+    size_t length, bool resize, bool oneTime, bool selective) {
     
-  DynamicJsonDocument payload(maxMessageLength);
-  payload["chat_id"] = chat_id;
-  payload["text"] = text;
+  StaticJsonDocument<JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(4)> payload;
+  payload["chat_id"] = chat_id.c_str();
+  payload["text"] = text.c_str();
 
   if (parse_mode != "")
-    payload["parse_mode"] = parse_mode;
+    payload["parse_mode"] = parse_mode.c_str();
 
   JsonObject replyMarkup = payload.createNestedObject("reply_markup");
     
-  replyMarkup["keyboard"] = serialized(keyboard);
+  replyMarkup["keyboard"] = serialized(keyboard, length);
 
   // Telegram defaults these values to false, so to decrease the size of the
   // payload we will only send them if needed
@@ -609,19 +1450,38 @@ bool UniversalTelegramBot::sendMessageWithInlineKeyboard(const String& chat_id,
                                                          const String& parse_mode,
                                                          const String& keyboard,
                                                          int message_id) {   // added message_id
+  return sendInlineKeyboardMessage(chat_id, text, parse_mode, keyboard.c_str(), keyboard.length(),
+                                   message_id);
+}
 
-  DynamicJsonDocument payload(maxMessageLength);
-  payload["chat_id"] = chat_id;
-  payload["text"] = text;
+bool UniversalTelegramBot::sendMessageWithInlineKeyboard(const String& chat_id,
+                                                         const String& text,
+                                                         const String& parse_mode,
+                                                         const TelegramKeyboard& keyboard,
+                                                         int message_id) {
+  if (keyboard.failed()) return false;
+  return sendInlineKeyboardMessage(chat_id, text, parse_mode, keyboard.c_str(), keyboard.length(),
+                                   message_id);
+}
+
+bool UniversalTelegramBot::sendInlineKeyboardMessage(const String& chat_id,
+                                                     const String& text,
+                                                     const String& parse_mode,
+                                                     const char *keyboard, size_t length,
+                                                     int message_id) {
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(1)> payload;
+  payload["chat_id"] = chat_id.c_str();
+  payload["text"] = text.c_str();
 
   if (message_id != 0)
     payload["message_id"] = message_id; // added message_id
     
   if (parse_mode != "")
-    payload["parse_mode"] = parse_mode;
+    payload["parse_mode"] = parse_mode.c_str();
 
   JsonObject replyMarkup = payload.createNestedObject("reply_markup");
-  replyMarkup["inline_keyboard"] = serialized(keyboard);
+  replyMarkup["inline_keyboard"] = serialized(keyboard, length);
   return sendPostMessage(payload.as<JsonObject>(), message_id); // if message id == 0 then edit is false, else edit is true
 }
 
@@ -637,20 +1497,37 @@ bool UniversalTelegramBot::sendPostMessage(JsonObject payload, bool edit) { // a
     serializeJson(payload, Serial);
     Serial.println();
   #endif 
-  unsigned long sttime = millis();
+  retryPolicy.begin();
 
   if (payload.containsKey("text")) {
-    while (millis() < sttime + 8000) { // loop for a while to send the message
-        String response = sendPostToTelegram((edit ? BOT_CMD("editMessageText") : BOT_CMD("sendMessage")), payload); // if edit is true we send a editMessageText CMD
-         #ifdef TELEGRAM_DEBUG  
-        Serial.println(response);
-      #endif
-      sent = checkForOkResponse(response);
-      if (sent) break;
+    // if edit is true we send a editMessageText CMD
+    String command = edit ? BOT_CMD("editMessageText") : BOT_CMD("sendMessage");
+    const char *text = payload["text"] | "";
+    TelegramTextSplitter parts(text, strlen(text), payload["parse_mode"] | "");
+
+    if (edit || parts.single()) {
+      do {
+        sent = sendForResponse(command, &payload);
+      } while (!sent && retryFailedSend());
+    } else {
+      // Too long for one message: the parts go out one after the other over
+      // the kept-alive connection, each with retries of its own. A text
+      // that is nothing but whitespace has no part to send
+      TextPart part;
+      part.opening = &parts.opening();
+      part.closing = &parts.closing();
+      sent = !parts.done();
+      while (sent && parts.next(part.text, part.length)) {
+        part.last = parts.done();
+        retryPolicy.begin();
+        do {
+          sent = sendForResponse(command, &payload, &part);
+        } while (!sent && retryFailedSend());
+      }
     }
   }
 
-  closeClient();
+  releaseClient();
   return sent;
 }
 
@@ -661,21 +1538,19 @@ String UniversalTelegramBot::sendPostPhoto(JsonObject payload) {
   #ifdef TELEGRAM_DEBUG  
     Serial.println(F("sendPostPhoto: SEND Post Photo"));
   #endif
-  unsigned long sttime = millis();
+  retryPolicy.begin();
 
   if (payload.containsKey("photo")) {
-    while (millis() - sttime < 8000ul) { // loop for a while to send the message
+    do {
       response = sendPostToTelegram(BOT_CMD("sendPhoto"), payload);
       #ifdef TELEGRAM_DEBUG  
         Serial.println(response);
       #endif
       sent = checkForOkResponse(response);
-      if (sent) break;
-      
-    }
+    } while (!sent && retryFailedSend());
   }
 
-  closeClient();
+  releaseClient();
   return response;
 }
 
@@ -705,12 +1580,12 @@ String UniversalTelegramBot::sendPhoto(const String& chat_id, const String& phot
                                        int reply_to_message_id,
                                        const String& keyboard) {
 
-  DynamicJsonDocument payload(maxMessageLength);
-  payload["chat_id"] = chat_id;
-  payload["photo"] = photo;
+  StaticJsonDocument<JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(1)> payload;
+  payload["chat_id"] = chat_id.c_str();
+  payload["photo"] = photo.c_str();
 
   if (caption.length() > 0)
-      payload["caption"] = caption;
+      payload["caption"] = caption.c_str();
 
   if (disable_notification)
       payload["disable_notification"] = disable_notification;
@@ -720,22 +1595,157 @@ String UniversalTelegramBot::sendPhoto(const String& chat_id, const String& phot
 
   if (keyboard.length() > 0) {
     JsonObject replyMarkup = payload.createNestedObject("reply_markup");
-    replyMarkup["keyboard"] = serialized(keyboard);
+    replyMarkup["keyboard"] = serialized(keyboard.c_str(), keyboard.length());
   }
 
   return sendPostPhoto(payload.as<JsonObject>());
 }
 
-bool UniversalTelegramBot::checkForOkResponse(const String& response) {
-  int last_id;
-  DynamicJsonDocument doc(response.length());
-  deserializeJson(doc, response);
+// Uploads a file from a Stream, such as a File, as the given field
+String UniversalTelegramBot::sendFile(const String& method, const char* field,
+                                      const String& chat_id, Stream& file, size_t size,
+                                      const String& fileName, const String& contentType,
+                                      const String& caption) {
+  TelegramUpload upload;
+  upload.addField("chat_id", chat_id);
+  if (caption.length() > 0)
+    upload.addField("caption", caption);
+  upload.addFile(field, fileName.c_str(), contentType.c_str(), file, size);
+  return sendMultipart(method, upload);
+}
+
+String UniversalTelegramBot::sendDocument(const String& chat_id, Stream& file, size_t size,
+                                          const String& fileName, const String& contentType,
+                                          const String& caption) {
+  return sendFile(F("sendDocument"), "document", chat_id, file, size, fileName, contentType, caption);
+}
+
+String UniversalTelegramBot::sendVideo(const String& chat_id, Stream& file, size_t size,
+                                       const String& fileName, const String& contentType,
+                                       const String& caption) {
+  return sendFile(F("sendVideo"), "video", chat_id, file, size, fileName, contentType, caption);
+}
+
+String UniversalTelegramBot::sendAudio(const String& chat_id, Stream& file, size_t size,
+                                       const String& fileName, const String& contentType,
+                                       const String& caption) {
+  return sendFile(F("sendAudio"), "audio", chat_id, file, size, fileName, contentType, caption);
+}
+
+/*
+   **** Responses ****
+   Only the fields of telegramResponse are kept from a response. Senders
+   that return a bool parse it straight off the connection, the ones that
+   return the body parse it once more from the String. Either way the
+   outcome ends up in lastResponse, nothing needs to parse it again.
+ */
 
+typedef StaticJsonDocument<JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(6) +
+                           JSON_ARRAY_SIZE(1) + 5 * JSON_OBJECT_SIZE(2)> ResponseFilter;
+
+static void buildResponseFilter(JsonDocument& filter) {
+  filter["ok"] = true;
+  filter["error_code"] = true;
+  filter["description"] = true;
+  filter["parameters"]["retry_after"] = true;
+
+  JsonObject result = filter.createNestedObject("result");
+  result["message_id"] = true;
+  JsonObject photo = result["photo"].createNestedObject();
+  photo["file_id"] = true;
+  photo["file_unique_id"] = true;
+  result["document"] = photo;
+  result["video"] = photo;
+  result["audio"] = photo;
+  result["voice"] = photo;
+}
+
+// Fills lastResponse from a parsed response
+void UniversalTelegramBot::readResponse(JsonDocument& doc) {
+  lastResponse.ok = doc["ok"] | false;
+  lastResponse.error_code = doc["error_code"] | 0;
+  lastResponse.description = doc["description"] | "";
+  lastResponse.retry_after = doc["parameters"]["retry_after"] | 0ul;
+
+  JsonObject result = doc["result"];
+  lastResponse.message_id = result["message_id"] | 0;
   // Save last sent message_id
-  last_id = doc["result"]["message_id"];
-  if (last_id > 0) last_sent_message_id = last_id;
+  if (lastResponse.message_id > 0) last_sent_message_id = lastResponse.message_id;
+
+  JsonObject file;
+  if (result.containsKey("photo")) {
+    // the sizes are in ascending order
+    JsonArray sizes = result["photo"];
+    file = sizes[sizes.size() - 1];
+  } else if (result.containsKey("document")) {
+    file = result["document"];
+  } else if (result.containsKey("video")) {
+    file = result["video"];
+  } else if (result.containsKey("audio")) {
+    file = result["audio"];
+  } else if (result.containsKey("voice")) {
+    file = result["voice"];
+  }
+  lastResponse.file_id = file["file_id"] | "";
+  lastResponse.file_unique_id = file["file_unique_id"] | "";
+}
 
-  return doc["ok"] | false;  // default is false, but this is more explicit and clear
+bool UniversalTelegramBot::checkForOkResponse(const String& response) {
+  ResponseFilter filter;
+  buildResponseFilter(filter);
+  TelegramJsonDocument doc(_json, maxMessageLength);
+  DeserializationError error = deserializeJson(doc, response, DeserializationOption::Filter(filter));
+
+  lastResponse = telegramResponse();
+  if (!error) readResponse(doc);
+  return lastResponse.ok;
+}
+
+/***************************************************************
+ * SendForResponse - sends command, as a POST of payload if    *
+ * one is given, and parses the response as it is received     *
+ * into lastResponse without holding its body                  *
+ * Returns lastResponse.ok                                     *
+ ***************************************************************/
+bool UniversalTelegramBot::sendForResponse(const String& command, JsonObject *payload,
+                                           const TextPart *part) {
+  TelegramHttpBodyStream body(*client, _http, _rx);
+  lastResponse = telegramResponse();
+
+  abortAsyncRequest();
+  _http.reset();
+  bool sent = sendRequest(command, payload, part);
+  bool received = sent && body.readHeaders(waitForResponse);
+  if (!received && resendOnNewConnection(sent)) {
+    _http.reset();
+    sent = sendRequest(command, payload, part);
+    received = sent && body.readHeaders(waitForResponse);
+  }
+  if (!received) {
+    // A request that never went out keeps its connection error
+    if (sent) finishResponse();
+    closeClient();
+    return false;
+  }
+
+  ResponseFilter filter;
+  buildResponseFilter(filter);
+  body.setTimeout(waitForResponse);
+  TelegramJsonDocument doc(_json, maxMessageLength);
+  DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+  body.drain();
+  finishResponse();
+
+  if (error || !_http.complete()) {
+    #ifdef TELEGRAM_DEBUG 
+        Serial.print(F("Failed to parse response. Error code: "));
+        Serial.println(error.c_str());
+    #endif     
+    closeClient();
+    return false;
+  }
+  readResponse(doc);
+  return lastResponse.ok;
 }
 
 bool UniversalTelegramBot::sendChatAction(const String& chat_id, const String& text) {
@@ -744,32 +1754,57 @@ bool UniversalTelegramBot::sendChatAction(const String& chat_id, const String& t
   #ifdef TELEGRAM_DEBUG  
     Serial.println(F("SEND Chat Action Message"));
   #endif
-  unsigned long sttime = millis();
+  retryPolicy.begin();
 
   if (text != "") {
-    while (millis() - sttime < 8000ul) { // loop for a while to send the message
-      String command = BOT_CMD("sendChatAction?chat_id=");
-      command += chat_id;
-      command += F("&action=");
-      command += text;
-
-      String response = sendGetToTelegram(command);
+    String command = BOT_CMD("sendChatAction?chat_id=");
+    command += chat_id;
+    command += F("&action=");
+    command += text;
+
+    do {
+      sent = sendForResponse(command);
+    } while (!sent && retryFailedSend());
+  }
 
-      #ifdef TELEGRAM_DEBUG  
-        Serial.println(response);
-      #endif
-      sent = checkForOkResponse(response);
+  releaseClient();
+  return sent;
+}
 
-      if (sent) break;
-      
-    }
-  }
+/***************************************************************
+ * RetryFailedSend - asks retryPolicy about a failed attempt   *
+ * and waits as long as it says, a 429 tells how long to wait  *
+ * in lastResponse                                             *
+ * Returns true if the request should be sent again            *
+ ***************************************************************/
+bool UniversalTelegramBot::retryFailedSend() {
+  if (!retryPolicy.nextAttempt(_lastError, lastResponse.retry_after)) return false;
+  if (_requestEndpoint != nullptr) _requestEndpoint->retries++;
 
+  #ifdef TELEGRAM_DEBUG  
+    Serial.print(F("Send failed with "));
+    Serial.print(_lastError);
+    Serial.print(F(", retrying in "));
+    Serial.println(retryPolicy.delay());
+  #endif
+  // The connection is not worth keeping while waiting
   closeClient();
-  return sent;
+  delay(retryPolicy.delay());
+  return true;
+}
+
+// Hands the connection back after a call, it is only kept open when keep-alive
+// is enabled and the server agreed to it
+void UniversalTelegramBot::releaseClient() {
+  if (!keepAlive || !_connectionReusable) closeClient();
+}
+
+unsigned long UniversalTelegramBot::getHandshakeCount() {
+  return metrics.handshakes;
 }
 
 void UniversalTelegramBot::closeClient() {
+  _rx.clear();
   if (client->connected()) {
     #ifdef TELEGRAM_DEBUG  
         Serial.println(F("Closing client"));
@@ -778,42 +1813,562 @@ void UniversalTelegramBot::closeClient() {
   }
 }
 
-bool UniversalTelegramBot::getFile(String& file_path, long& file_size, const String& file_id)
+/***************************************************************
+ * GetFilePath - looks up the download URL of the file of a    *
+ * message and fills in file_path and file_size. Updates only  *
+ * carry the file ids, so nothing is requested until a path is *
+ * actually needed                                             *
+ ***************************************************************/
+bool UniversalTelegramBot::getFilePath(telegramMessage& message) {
+  String path;
+  if (message.file_id.length() == 0 ||
+      !resolveFile(message.file_id, message.file_unique_id, path, message.file_size)) return false;
+
+  message.file_path  = F("https://api.telegram.org/file/");
+  message.file_path += buildCommand(path);
+  return true;
+}
+
+// Looks up where Telegram keeps a file, path is relative to /file/bot<token>/
+// Paths that were resolved within their lifetime are served from _fileCache,
+// keyed by file_unique_id as the file_id of the same file differs per bot
+bool UniversalTelegramBot::resolveFile(const String& file_id, const String& file_unique_id,
+                                       String& path, long& size)
 {
+  unsigned long now = millis();
+  FileCacheEntry *slot = &_fileCache[0];
+  for (FileCacheEntry& entry : _fileCache) {
+    if (file_unique_id.length() > 0 && entry.uniqueId == file_unique_id &&
+        now - entry.resolved < filePathLifetime) {
+      entry.used = ++_fileCacheClock;
+      path = entry.path;
+      size = entry.size;
+      return true;
+    }
+    if (entry.used < slot->used) slot = &entry;
+  }
+
   String command = BOT_CMD("getFile?file_id=");
   command += file_id;
   String response = sendGetToTelegram(command); // receive reply from telegram.org
-  DynamicJsonDocument doc(maxMessageLength);
+  TelegramJsonDocument doc(_json, maxMessageLength);
   DeserializationError error = deserializeJson(doc, ZERO_COPY(response));
-  closeClient();
+  releaseClient();
 
-  if (!error) {
-    if (doc.containsKey("result")) {
-      file_path  = F("https://api.telegram.org/file/");
-      file_path += buildCommand(doc["result"]["file_path"]);
-      file_size = doc["result"]["file_size"].as<long>();
-      return true;
+  if (error || !doc.containsKey("result")) return false;
+
+  path = doc["result"]["file_path"].as<String>();
+  size = doc["result"]["file_size"].as<long>();
+
+  slot->uniqueId = doc["result"]["file_unique_id"].as<String>();
+  slot->path = path;
+  slot->size = size;
+  slot->resolved = now;
+  slot->used = ++_fileCacheClock;
+  return true;
+}
+
+/***************************************************************
+ * DownloadFile - streams a file sent to the bot into sink     *
+ * over the bot's own connection, no second TLS session or     *
+ * HTTP client is needed. A download that breaks off is        *
+ * resumed where it stopped with a Range request, as often as  *
+ * retryPolicy allows. Progress is reported to downloadProgress*
+ * Returns true if the whole file, of the size Telegram gave   *
+ * for it, was written to sink                                 *
+ ***************************************************************/
+bool UniversalTelegramBot::downloadFile(const String& file_id, Print& sink,
+                                        const String& file_unique_id) {
+  String path;
+  long size = 0;
+  if (!resolveFile(file_id, file_unique_id, path, size)) return false;
+
+  String command = F("file/");
+  command += buildCommand(path);
+  long received = 0;
+  unsigned long start = millis();
+
+  retryPolicy.begin();
+  while (!downloadRange(command, received, size, sink, start)) {
+    if (!retryFailedSend()) return false;
+  }
+  return true;
+}
+
+// Requests the file from received on and writes it to sink, received is
+// advanced by what arrived. Returns true once the file is complete
+bool UniversalTelegramBot::downloadRange(const String& command, long& received, long size,
+                                         Print& sink, unsigned long start) {
+  abortAsyncRequest();
+  // A file is not a JSON response, there is nothing to read into it
+  lastResponse = telegramResponse();
+  startMetrics(command);
+  if (!connectClient()) return false;
+
+  {
+    TelegramBufferedPrint request(*client);
+    request.print(F("GET /"));
+    request.print(command);
+    request.println(F(" HTTP/1.1"));
+    request.print(F("Host:"));
+    request.println(serverHost);
+    if (received > 0) {
+      request.print(F("Range: bytes="));
+      request.print(received);
+      request.println('-');
+    }
+    request.println(F("Connection: keep-alive"));
+    request.println();
+    if (!endRequest(request)) {
+      closeClient();
+      return false;
     }
   }
-  return false;
+
+  TelegramHttpBodyStream body(*client, _http, _rx);
+  _http.reset();
+  if (!body.readHeaders(waitForResponse)) {
+    finishResponse();
+    closeClient();
+    return false;
+  }
+
+  // A server ignoring the range sends the whole file again
+  long skip = 0;
+  if (_http.statusCode == 200) {
+    skip = received;
+  } else if (_http.statusCode != 206) {
+    body.drain();
+    finishResponse();
+    releaseClient();
+    return false;
+  }
+
+  body.setTimeout(waitForResponse);
+  const uint8_t *data;
+  size_t length;
+  while ((length = body.readBlock(data)) > 0) {
+    if (skip > 0) {
+      size_t skipped = (long)length < skip ? length : skip;
+      data += skipped;
+      length -= skipped;
+      skip -= skipped;
+      if (length == 0) continue;
+    }
+    if (sink.write(data, length) != length) {
+      _lastError = TELEGRAM_ERROR_DOWNLOAD_INCOMPLETE;
+      finishMetrics();
+      closeClient();
+      return false;
+    }
+    received += length;
+    if (downloadProgress != nullptr) downloadProgress(received, size, millis() - start);
+  }
+
+  finishResponse();
+  if (!_http.complete()) {
+    // Broke off, resumed by the next attempt
+    closeClient();
+    return false;
+  }
+  releaseClient();
+
+  if (size > 0 && received != size) {
+    _lastError = TELEGRAM_ERROR_DOWNLOAD_INCOMPLETE;
+    return false;
+  }
+  return true;
 }
 
 bool UniversalTelegramBot::answerCallbackQuery(const String &query_id, const String &text, bool show_alert, const String &url, int cache_time) {
-  DynamicJsonDocument payload(maxMessageLength);
+  StaticJsonDocument<JSON_OBJECT_SIZE(5)> payload;
 
-  payload["callback_query_id"] = query_id;
+  payload["callback_query_id"] = query_id.c_str();
   payload["show_alert"] = show_alert;
   payload["cache_time"] = cache_time;
 
-  if (text.length() > 0) payload["text"] = text;
-  if (url.length() > 0) payload["url"] = url;
+  if (text.length() > 0) payload["text"] = text.c_str();
+  if (url.length() > 0) payload["url"] = url.c_str();
 
-  String response = sendPostToTelegram(BOT_CMD("answerCallbackQuery"), payload.as<JsonObject>());
-  #ifdef _debug  
-     Serial.print(F("answerCallbackQuery response:"));
-     Serial.println(response);
-  #endif
-  bool answer = checkForOkResponse(response);
-  closeClient();
+  JsonObject object = payload.as<JsonObject>();
+  bool answer = sendForResponse(BOT_CMD("answerCallbackQuery"), &object);
+  releaseClient();
   return answer;
 }
+
+
+/*
+   **** Asynchronous requests ****
+   queueGet / queuePost (and the helpers built on them) only store the
+   request, loop() then advances it a little on every call: the request is
+   written once the connection is free and the response is fed to the HTTP
+   parser as its bytes arrive, without ever waiting for more. When the
+   response is complete the callback is called with the outcome.
+   Client::connect() itself still blocks, so the first request after the
+   connection was dropped takes as long as the handshake.
+   With pipelineDepth above 1 the requests behind the first are written
+   right after it on the same connection and the responses, which arrive
+   in order, are matched to them one by one. Requests are never written
+   behind a getUpdates, whose long poll would hold everything up. If the
+   connection is closed after a response, because the server asked for it
+   or the response timed out or broke off, the requests that followed are
+   sent again on a new connection.
+   Synchronous calls wait for the responses of the requests in flight
+   before they use the connection. Only a getUpdates long poll is aborted,
+   its callback then gets no updates.
+ */
+
+bool UniversalTelegramBot::queueGet(const String& command, TelegramRequestCallback callback) {
+  AsyncRequest *request = queueRequest(command);
+  if (request == nullptr) return false;
+  request->callback = callback;
+  return true;
+}
+
+bool UniversalTelegramBot::queuePost(const String& command, JsonObject payload,
+                                     TelegramRequestCallback callback) {
+  AsyncRequest *request = queueRequest(command);
+  if (request == nullptr) return false;
+  // The payload is kept until loop() gets to send it
+  request->post = true;
+  serializeJson(payload, request->payload);
+  request->callback = callback;
+  return true;
+}
+
+bool UniversalTelegramBot::sendMessageAsync(const String& chat_id, const String& text,
+                                            const String& parse_mode,
+                                            TelegramRequestCallback callback) {
+  StaticJsonDocument<JSON_OBJECT_SIZE(3)> payload;
+  payload["chat_id"] = chat_id.c_str();
+  payload["text"] = text.c_str();
+  if (parse_mode != "")
+    payload["parse_mode"] = parse_mode.c_str();
+
+  return queuePost(BOT_CMD("sendMessage"), payload.as<JsonObject>(), callback);
+}
+
+/***************************************************************
+ * FetchUpdatesAsync - non blocking fetchUpdates, the updates  *
+ * are added to the message queue from within loop() and the   *
+ * callback is told how many arrived                            *
+ ***************************************************************/
+bool UniversalTelegramBot::fetchUpdatesAsync(TelegramUpdatesCallback callback) {
+  if (_queueCount == messageQueueSize) return false;
+
+  String command = BOT_CMD("getUpdates?offset=");
+  command += last_message_acked + 1;
+  command += F("&limit=");
+  command += messageQueueSize;
+  if (longPoll > 0) {
+    command += F("&timeout=");
+    command += longPoll;
+  }
+  if (!_allowedUpdatesSent) appendAllowedUpdates(command);
+
+  AsyncRequest *request = queueRequest(command);
+  if (request == nullptr) return false;
+  request->updatesCallback = callback;
+  return true;
+}
+
+int UniversalTelegramBot::pendingRequests() {
+  return _asyncCount;
+}
+
+UniversalTelegramBot::AsyncRequest* UniversalTelegramBot::queueRequest(const String& command) {
+  if (_asyncCount == TELEGRAM_ASYNC_QUEUE_SIZE) return nullptr;
+
+  AsyncRequest& request = _asyncQueue[(_asyncHead + _asyncCount) % TELEGRAM_ASYNC_QUEUE_SIZE];
+  request.command = command;
+  request.payload = String();
+  request.post = false;
+  request.callback = nullptr;
+  request.updatesCallback = nullptr;
+  request.sendSlot = -1;
+  request.error = TELEGRAM_ERROR_NONE;
+  _asyncCount++;
+  return &request;
+}
+
+/***************************************************************
+ * Loop - advances the queued requests, call it as often as    *
+ * possible. Returns after loopTimeSlice milliseconds at most, *
+ * or as soon as it would have to wait for the server          *
+ ***************************************************************/
+void UniversalTelegramBot::loop() {
+  unsigned long start = millis();
+
+  dispatchQueuedMessages();
+
+  while (millis() - start < loopTimeSlice) {
+    if (_asyncInFlight == 0) {
+      if (_asyncCount == 0) return;
+      if (_asyncQueue[_asyncHead].error != TELEGRAM_ERROR_NONE) {
+        _lastError = _asyncQueue[_asyncHead].error;
+        _http.reset();
+        completeAsyncRequest(false);
+        continue;
+      }
+      if (!startAsyncRequest()) {
+        // Don't try the rest of the queue against a server we can't reach
+        completeAsyncRequest(false);
+        return;
+      }
+    }
+    pipelineAsyncRequests();
+
+    while (!_http.complete() && !_http.failed() && feedAsyncResponse()) {
+      if (millis() - start >= loopTimeSlice) return;
+    }
+    // Nothing to do until more data arrives
+    if (!asyncResponseDone()) return;
+    completeAsyncRequest(true);
+  }
+}
+
+// Feeds the bytes that have arrived to the response of the request at the
+// head of the queue, false if there were none
+bool UniversalTelegramBot::feedAsyncResponse() {
+  if (_rx.length() == 0 && _rx.fill(*client) == 0) return false;
+
+  size_t bodyLength;
+  size_t used = _http.feed(_rx.data(), _rx.length(), bodyLength);
+  char *bodyStart = _rx.data() + used - bodyLength;
+  if (_asyncBody.length() + bodyLength > (unsigned int)maxMessageLength)
+    bodyLength = _asyncBody.length() < (unsigned int)maxMessageLength
+                     ? maxMessageLength - _asyncBody.length() : 0;
+  _rx.appendTo(_asyncBody, bodyStart, bodyLength);
+  _rx.consume(used);
+  // The response has started, from now on only wait for gaps
+  _asyncLastReceived = millis();
+  _asyncTimeout = waitForResponse;
+  return true;
+}
+
+// Whether the response of the head request is over, because it is complete
+// or failed, the server half-closed the connection or it timed out
+bool UniversalTelegramBot::asyncResponseDone() {
+  if (_http.complete() || _http.failed()) return true;
+  if (!client->connected()) {
+    _http.finish();
+    return true;
+  }
+  return millis() - _asyncLastReceived >= _asyncTimeout;
+}
+
+bool UniversalTelegramBot::startAsyncRequest() {
+  AsyncRequest& request = _asyncQueue[_asyncHead];
+
+  _http.reset();
+  _asyncBody = String();
+  bool sent = request.post ? sendPostRequest(request.command, request.payload)
+                           : sendGetRequest(request.command);
+  if (!sent) {
+    if (_lastError == TELEGRAM_ERROR_NONE) _lastError = TELEGRAM_ERROR_CONNECTION;
+    closeClient();
+    return false;
+  }
+
+  _asyncInFlight = 1;
+  _asyncLastReceived = millis();
+  _asyncTimeout = longPoll * 1000 + waitForResponse;
+  return true;
+}
+
+// Writes the queued requests behind the ones in flight, up to pipelineDepth
+void UniversalTelegramBot::pipelineAsyncRequests() {
+  while (_asyncInFlight < _asyncCount && _asyncInFlight < pipelineDepth &&
+         keepAlive && _connectionReusable && client->connected()) {
+    // A long poll would hold back every response behind it
+    if (_asyncQueue[(_asyncHead + _asyncInFlight - 1) % TELEGRAM_ASYNC_QUEUE_SIZE].updatesCallback != nullptr)
+      return;
+
+    AsyncRequest& request = _asyncQueue[(_asyncHead + _asyncInFlight) % TELEGRAM_ASYNC_QUEUE_SIZE];
+    TelegramBufferedPrint out(*client);
+    if (request.post) {
+      writeRequestHead(out, F("POST"), request.command, request.payload.length());
+      out.print(request.payload);
+    } else {
+      writeRequestHead(out, F("GET"), request.command, -1);
+    }
+    out.flush();
+    metrics.bytesOut += out.written();
+    if (out.failed()) return;
+    _asyncInFlight++;
+  }
+}
+
+// Takes the request at the head of the queue off it and reports the outcome
+void UniversalTelegramBot::completeAsyncRequest(bool responseRead) {
+  AsyncRequest& request = _asyncQueue[_asyncHead];
+  TelegramRequestCallback callback = request.callback;
+  TelegramUpdatesCallback updatesCallback = request.updatesCallback;
+  int sendSlot = request.sendSlot;
+  request.command = String();
+  request.payload = String();
+
+  _asyncHead = (_asyncHead + 1) % TELEGRAM_ASYNC_QUEUE_SIZE;
+  _asyncCount--;
+  if (_asyncInFlight > 0) _asyncInFlight--;
+
+  if (responseRead) {
+    finishResponse();
+    // The connection is closed when the server asked for it, after a timeout
+    // or a broken response. A server answering with Connection: close has
+    // not read what was pipelined behind, it is sent again on the next
+    // connection. Otherwise the server may have acted on it already, so it
+    // fails rather than being sent twice
+    if (!keepAlive || !_connectionReusable) {
+      for (int i = 0; i < _asyncInFlight && !_http.complete(); i++)
+        _asyncQueue[(_asyncHead + i) % TELEGRAM_ASYNC_QUEUE_SIZE].error = TELEGRAM_ERROR_CONNECTION_CLOSED;
+      _asyncInFlight = 0;
+    }
+    releaseClient();
+  }
+
+  // The answer is taken off the engine and the next request in flight made
+  // ready before any callback runs. The callbacks are free to queue further
+  // requests or make a synchronous call, which drains the pipeline first
+  bool complete = _http.complete();
+  int error = _lastError;
+  String body(static_cast<String&&>(_asyncBody));
+  _asyncBody = String();
+  if (_asyncInFlight > 0) {
+    // The response of the next pipelined request follows, its record has
+    // no connect or send phase of its own
+    startMetrics(_asyncQueue[_asyncHead].command);
+    _rx.expectResponse();
+    _http.reset();
+    _asyncLastReceived = millis();
+    _asyncTimeout = longPoll * 1000 + waitForResponse;
+  }
+
+  if (updatesCallback != nullptr) {
+    int newMessages = 0;
+    if (complete) {
+      unsigned long parseStart = millis();
+      TelegramJsonDocument doc(_json, maxMessageLength);
+      DeserializationError parseError = deserializeJson(doc, ZERO_COPY(body));
+      metrics.parse.record(millis() - parseStart);
+      if (!parseError)
+        newMessages = processUpdates(doc, TARGET_QUEUE);
+    }
+    updatesCallback(*this, newMessages);
+  } else {
+    // Parsed here, so the callback finds it in lastResponse
+    checkForOkResponse(body);
+    if (sendSlot >= 0)
+      completeQueuedMessage(sendSlot, error, body);
+    else if (callback != nullptr)
+      callback(*this, error, body);
+  }
+}
+
+/***************************************************************
+ * AbortAsyncRequest - frees the connection for a synchronous  *
+ * call. The responses of the requests in flight are waited    *
+ * for first, as the server may already have acted on them,    *
+ * only a getUpdates long poll at the head is given up on      *
+ ***************************************************************/
+void UniversalTelegramBot::abortAsyncRequest() {
+  // Nothing is pipelined behind a getUpdates, it is the last one in flight
+  while (_asyncInFlight > 0 && _asyncQueue[_asyncHead].updatesCallback == nullptr) {
+    while (!_http.complete() && !_http.failed() && feedAsyncResponse()) {
+    }
+    if (asyncResponseDone())
+      completeAsyncRequest(true);
+    else
+      yield();
+  }
+  if (_asyncInFlight == 0) return;
+
+  _lastError = TELEGRAM_ERROR_CONNECTION_CLOSED;
+  finishMetrics();
+  closeClient();
+  while (_asyncInFlight > 0) {
+    _lastError = TELEGRAM_ERROR_CONNECTION_CLOSED;
+    _http.reset();
+    completeAsyncRequest(false);
+  }
+  finishMetrics();
+}
+
+/*
+   **** Rate limited sending ****
+   queueMessage() holds messages back until the rate limiter allows them,
+   loop() then hands them to the asynchronous engine. Messages to different
+   chats overtake each other, messages to the same chat keep their order.
+   A 429 answer pauses all sending for the retry_after it asks for, after
+   which the message is sent again.
+ */
+
+bool UniversalTelegramBot::queueMessage(const String& chat_id, const String& text,
+                                        const String& parse_mode,
+                                        TelegramRequestCallback callback) {
+  if (_sendCount == TELEGRAM_SEND_QUEUE_SIZE || text == "") return false;
+
+  QueuedMessage& message = _sendQueue[(_sendHead + _sendCount) % TELEGRAM_SEND_QUEUE_SIZE];
+  message.chat_id = chat_id;
+  message.text = text;
+  message.parse_mode = parse_mode;
+  message.callback = callback;
+  message.state = SEND_WAITING;
+  _sendCount++;
+  return true;
+}
+
+// Messages queued with queueMessage() that have not been sent yet
+int UniversalTelegramBot::outgoingMessages() {
+  int waiting = 0;
+  for (int i = 0; i < _sendCount; i++)
+    if (_sendQueue[(_sendHead + i) % TELEGRAM_SEND_QUEUE_SIZE].state != SEND_EMPTY) waiting++;
+  return waiting;
+}
+
+void UniversalTelegramBot::dispatchQueuedMessages() {
+  unsigned long now = millis();
+
+  for (int i = 0; i < _sendCount && _asyncCount < TELEGRAM_ASYNC_QUEUE_SIZE; i++) {
+    int slot = (_sendHead + i) % TELEGRAM_SEND_QUEUE_SIZE;
+    QueuedMessage& message = _sendQueue[slot];
+    if (message.state != SEND_WAITING) continue;
+    if (!_rateLimiter.tryAcquire(message.chat_id.c_str(), now)) continue;
+
+    StaticJsonDocument<JSON_OBJECT_SIZE(3)> payload;
+    payload["chat_id"] = message.chat_id.c_str();
+    payload["text"] = message.text.c_str();
+    if (message.parse_mode != "")
+      payload["parse_mode"] = message.parse_mode.c_str();
+
+    AsyncRequest *request = queueRequest(BOT_CMD("sendMessage"));
+    request->post = true;
+    serializeJson(payload, request->payload);
+    request->sendSlot = slot;
+    message.state = SEND_IN_FLIGHT;
+  }
+}
+
+void UniversalTelegramBot::completeQueuedMessage(int slot, int error, const String& response) {
+  QueuedMessage& message = _sendQueue[slot];
+
+  if (error == 429) {
+    unsigned long wait = lastResponse.retry_after;
+    _rateLimiter.floodWait(wait > 0 ? wait : 1, millis());
+    message.state = SEND_WAITING;
+    return;
+  }
+
+  TelegramRequestCallback callback = message.callback;
+  message.state = SEND_EMPTY;
+  message.chat_id = String();
+  message.text = String();
+  message.parse_mode = String();
+  // Free the slots that are done at the head of the queue
+  while (_sendCount > 0 && _sendQueue[_sendHead].state == SEND_EMPTY) {
+    _sendHead = (_sendHead + 1) % TELEGRAM_SEND_QUEUE_SIZE;
+    _sendCount--;
+  }
+
+  if (callback != nullptr) callback(*this, error, response);
+}
@@ -29,18 +29,120 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 #include <ArduinoJson.h>
 #include <Client.h>
 #include <TelegramCertificate.h>
+#include <TelegramHttp.h>
+#include <TelegramJsonArena.h>
+#include <TelegramMetrics.h>
+#include <TelegramRateLimiter.h>
+#include <TelegramRetryPolicy.h>
+#include <TelegramPollScheduler.h>
+#include <TelegramCommandRouter.h>
+#include <TelegramKeyboard.h>
+#include <TelegramTextSplitter.h>
+#include <TelegramStateStore.h>
+#include <TelegramUpload.h>
 
 #define TELEGRAM_HOST "api.telegram.org"
 #define TELEGRAM_SSL_PORT 443
+// Default number of telegramMessage slots, see the constructor
+#ifndef HANDLE_MESSAGES
 #define HANDLE_MESSAGES 1
+#endif
 
 //unmark following line to enable debug mode
 //#define _debug
 
-typedef bool (*MoreDataAvailable)();
-typedef byte (*GetNextByte)();
-typedef byte* (*GetNextBuffer)();
-typedef int (GetNextBufferLen)();
+// Number of requests that can wait for loop() at the same time
+#ifndef TELEGRAM_ASYNC_QUEUE_SIZE
+#define TELEGRAM_ASYNC_QUEUE_SIZE 4
+#endif
+
+// Number of messages queueMessage() can hold back for the rate limiter
+#ifndef TELEGRAM_SEND_QUEUE_SIZE
+#define TELEGRAM_SEND_QUEUE_SIZE 16
+#endif
+
+// Number of resolved file paths kept by getFilePath() and downloadFile()
+#ifndef TELEGRAM_FILE_CACHE_SIZE
+#define TELEGRAM_FILE_CACHE_SIZE 4
+#endif
+
+// Telegram keeps a file path valid for at least this long (ms)
+#ifndef TELEGRAM_FILE_PATH_LIFETIME
+#define TELEGRAM_FILE_PATH_LIFETIME 3600000UL
+#endif
+
+// Room for the filter built by buildUpdatesFilter
+#define TELEGRAM_UPDATES_FILTER_SIZE JSON_OBJECT_SIZE(160)
+
+// Update types and fields that are read from updates. Set any of them to 0
+// with a build flag (e.g. -DTELEGRAM_READ_LOCATION=0), the library is
+// compiled apart from the sketch. Fields left out are neither filtered in
+// nor extracted, types left out are no longer sent by the server
+#ifndef TELEGRAM_READ_MESSAGES
+#define TELEGRAM_READ_MESSAGES 1
+#endif
+#ifndef TELEGRAM_READ_EDITED_MESSAGES
+#define TELEGRAM_READ_EDITED_MESSAGES 1
+#endif
+#ifndef TELEGRAM_READ_CHANNEL_POSTS
+#define TELEGRAM_READ_CHANNEL_POSTS 1
+#endif
+#ifndef TELEGRAM_READ_CALLBACK_QUERIES
+#define TELEGRAM_READ_CALLBACK_QUERIES 1
+#endif
+// from_id and from_name
+#ifndef TELEGRAM_READ_FROM
+#define TELEGRAM_READ_FROM 1
+#endif
+#ifndef TELEGRAM_READ_CHAT_TITLE
+#define TELEGRAM_READ_CHAT_TITLE 1
+#endif
+// reply_to_message_id and reply_to_text
+#ifndef TELEGRAM_READ_REPLY_TO
+#define TELEGRAM_READ_REPLY_TO 1
+#endif
+#ifndef TELEGRAM_READ_LOCATION
+#define TELEGRAM_READ_LOCATION 1
+#endif
+// Documents, photos, videos and voice notes along with their caption
+#ifndef TELEGRAM_READ_FILES
+#define TELEGRAM_READ_FILES 1
+#endif
+
+class UniversalTelegramBot;
+
+// Completion of a queued request, error is the resulting _lastError
+typedef void (*TelegramRequestCallback)(UniversalTelegramBot &bot, int error, const String &response);
+typedef void (*TelegramUpdatesCallback)(UniversalTelegramBot &bot, int newMessages);
+
+enum TelegramUpdateType : uint8_t {
+  TELEGRAM_UPDATE_NONE,
+  TELEGRAM_UPDATE_MESSAGE,
+  TELEGRAM_UPDATE_EDITED_MESSAGE,
+  TELEGRAM_UPDATE_CHANNEL_POST,
+  TELEGRAM_UPDATE_CALLBACK_QUERY
+};
+
+// Kind of file attached to a message, photos refer to their largest size
+enum TelegramFileType : uint8_t {
+  TELEGRAM_FILE_NONE,
+  TELEGRAM_FILE_DOCUMENT,
+  TELEGRAM_FILE_PHOTO,
+  TELEGRAM_FILE_VIDEO,
+  TELEGRAM_FILE_VOICE
+};
+
+// What the last request was answered with, read from its response in one
+// pass. Ids of a file that was sent refer to the largest size of a photo
+struct telegramResponse {
+  bool ok = false;
+  int error_code = 0;
+  String description;
+  unsigned long retry_after = 0;
+  int message_id = 0;
+  String file_id;
+  String file_unique_id;
+};
 
 struct telegramMessage {
   String text;
@@ -49,10 +151,16 @@ struct telegramMessage {
   String from_id;
   String from_name;
   String date;
+  // The kind of update as a string, update_type compares cheaper
   String type;
+  TelegramUpdateType update_type;
   String file_caption;
+  String file_id;
+  String file_unique_id;
+  // Left empty until getFilePath() is called for the message
   String file_path;
   String file_name;
+  TelegramFileType file_type;
   bool hasDocument;
   long file_size;
   float longitude;
@@ -65,9 +173,40 @@ struct telegramMessage {
   String query_id;
 };
 
+// Compact, allocation free counterpart of telegramMessage. Ids and dates are
+// numbers, the strings are views that stay valid until the next batch
+struct telegramUpdate {
+  int64_t chat_id = 0;
+  int64_t from_id = 0;
+  int64_t date = 0;
+  int32_t update_id = 0;
+  int32_t message_id = 0;
+  int32_t reply_to_message_id = 0;
+  float longitude = 0;
+  float latitude = 0;
+  int32_t file_size = 0;
+  TelegramUpdateType type = TELEGRAM_UPDATE_NONE;
+  TelegramFileType file_type = TELEGRAM_FILE_NONE;
+  const char *text = "";
+  const char *chat_title = "";
+  const char *from_name = "";
+  const char *file_caption = "";
+  const char *file_id = "";
+  const char *file_unique_id = "";
+  const char *file_name = "";
+  const char *reply_to_text = "";
+  const char *query_id = "";
+
+  String typeString() const;
+  void toMessage(telegramMessage& message) const;
+};
+
 class UniversalTelegramBot {
 public:
-  UniversalTelegramBot(const String& token, Client &client);
+  UniversalTelegramBot(const String& token, Client &client, int messageQueueSize = HANDLE_MESSAGES);
+  ~UniversalTelegramBot();
+  UniversalTelegramBot(const UniversalTelegramBot&) = delete;
+  UniversalTelegramBot& operator=(const UniversalTelegramBot&) = delete;
   void updateToken(const String& token);
   String getToken();
   String sendGetToTelegram(const String& command);
@@ -80,9 +219,13 @@ public:
                                   GetNextByte getNextByteCallback, 
                                   GetNextBuffer getNextBufferCallback, 
                                   GetNextBufferLen getNextBufferLenCallback);
+  String sendMultipart(const String& method, const TelegramUpload& upload);
 
   bool readHTTPAnswer(String &body, String &headers);
   bool getMe();
+  void setJsonBuffer(char *buffer, size_t size);
+  bool getFilePath(telegramMessage& message);
+  bool downloadFile(const String& file_id, Print& sink, const String& file_unique_id = "");
 
   bool sendSimpleMessage(const String& chat_id, const String& text, const String& parse_mode);
   bool sendMessage(const String& chat_id, const String& text, const String& parse_mode = "", int message_id = 0);
@@ -92,6 +235,13 @@ public:
                                     bool selective = false);
   bool sendMessageWithInlineKeyboard(const String& chat_id, const String& text,
                                      const String& parse_mode, const String& keyboard, int message_id = 0);
+  bool sendMessageWithReplyKeyboard(const String& chat_id, const String& text,
+                                    const String& parse_mode, const TelegramKeyboard& keyboard,
+                                    bool resize = false, bool oneTime = false,
+                                    bool selective = false);
+  bool sendMessageWithInlineKeyboard(const String& chat_id, const String& text,
+                                     const String& parse_mode, const TelegramKeyboard& keyboard,
+                                     int message_id = 0);
 
   bool sendChatAction(const String& chat_id, const String& text);
 
@@ -105,6 +255,13 @@ public:
   String sendPhoto(const String& chat_id, const String& photo, const String& caption = "",
                    bool disable_notification = false,
                    int reply_to_message_id = 0, const String& keyboard = "");
+  String sendDocument(const String& chat_id, Stream& file, size_t size, const String& fileName,
+                      const String& contentType = "application/octet-stream",
+                      const String& caption = "");
+  String sendVideo(const String& chat_id, Stream& file, size_t size, const String& fileName,
+                   const String& contentType = "video/mp4", const String& caption = "");
+  String sendAudio(const String& chat_id, Stream& file, size_t size, const String& fileName,
+                   const String& contentType = "audio/mpeg", const String& caption = "");
 
   bool answerCallbackQuery(const String &query_id,
                            const String &text = "",
@@ -113,28 +270,226 @@ public:
                            int cache_time = 0);
 
   bool setMyCommands(const String& commandArray);
+  bool setMyCommands(const TelegramCommandRouter& router);
+
+  bool setWebhook(const String& url, const String& secretToken = "", int maxConnections = 0);
+  bool deleteWebhook(bool dropPendingUpdates = false);
+  void setWebhookSecret(const String& secretToken);
+  int handleWebhook(Client &connection);
 
   String buildCommand(const String& cmd);
 
   int getUpdates(long offset);
+  int pollUpdates();
+  int fetchUpdates();
+  int getCompactUpdates(long offset);
+  int queuedMessages();
+  telegramMessage* nextMessage();
+  void ackMessage();
   bool checkForOkResponse(const String& response);
-  telegramMessage messages[HANDLE_MESSAGES];
-  long last_message_received;
+  void buildUpdatesFilter(JsonDocument& filter);
+  const int messageQueueSize;
+  telegramMessage *messages;
+  telegramUpdate *updates = nullptr;
+  telegramResponse lastResponse;
+  long last_message_received = 0;
+  long last_message_acked = 0;
   String name;
   String userName;
   int longPoll = 0;
   unsigned int waitForResponse = 1500;
-  int _lastError;
+  int _lastError = TELEGRAM_ERROR_NONE;
   int last_sent_message_id = 0;
   int maxMessageLength = 1500;
+  // Deserialize getUpdates() straight from the client through a filter
+  // instead of buffering the whole HTTP body into a String first
+  bool streamUpdates = false;
+  // Keep the connection to the server open between calls
+  bool keepAlive = true;
+  // Seconds an idle connection is kept before it is considered stale
+  unsigned int keepAliveTimeout = 30;
+  // Server the requests go to, can be pointed at a local server replaying
+  // recorded responses to benchmark the library without Telegram
+  const char *serverHost = TELEGRAM_HOST;
+  uint16_t serverPort = TELEGRAM_SSL_PORT;
+  // How failed sends are retried, the outcome is left in _lastError
+  TelegramRetryPolicy retryPolicy;
+  // Picks the long-poll timeout and pace of pollUpdates()
+  TelegramPollScheduler pollScheduler;
+  // Size of the blocks uploaded files are sent in, and an optional callback
+  // told about the progress of an upload after every block
+  size_t uploadChunkSize = TELEGRAM_UPLOAD_CHUNK_SIZE;
+  TelegramUploadProgress uploadProgress = nullptr;
+  // Told about the progress of downloadFile() after every block
+  TelegramUploadProgress downloadProgress = nullptr;
+  // How long a file path resolved by getFile is used again, in ms
+  unsigned long filePathLifetime = TELEGRAM_FILE_PATH_LIFETIME;
+  // Counters and latencies of the requests made, and an optional sink that is
+  // handed every finished request. The sink must not call the bot
+  TelegramMetrics metrics;
+  TelegramMetricsSink metricsSink = nullptr;
+  // Keeps the update offsets, name and userName across reboots. Changes are
+  // written at most once per persistInterval ms
+  TelegramStateStore *stateStore = nullptr;
+  unsigned long persistInterval = TELEGRAM_PERSIST_INTERVAL;
+
+  bool restoreState();
+  bool persistState();
+  unsigned long getHandshakeCount();
+
+  bool queueGet(const String& command, TelegramRequestCallback callback = nullptr);
+  bool queuePost(const String& command, JsonObject payload, TelegramRequestCallback callback = nullptr);
+  bool sendMessageAsync(const String& chat_id, const String& text, const String& parse_mode = "",
+                        TelegramRequestCallback callback = nullptr);
+  bool fetchUpdatesAsync(TelegramUpdatesCallback callback);
+  bool queueMessage(const String& chat_id, const String& text, const String& parse_mode = "",
+                    TelegramRequestCallback callback = nullptr);
+  int pendingRequests();
+  int outgoingMessages();
+  void loop();
+  // Longest time in milliseconds loop() spends before returning
+  unsigned int loopTimeSlice = 5;
+  // Number of queued requests loop() writes back to back on the kept-alive
+  // connection before their responses arrive, 1 turns pipelining off
+  uint8_t pipelineDepth = 1;
 
 private:
+  struct AsyncRequest {
+    String command;
+    String payload;
+    bool post;
+    TelegramRequestCallback callback;
+    TelegramUpdatesCallback updatesCallback;
+    // Slot in _sendQueue the request was made for, or -1
+    int sendSlot;
+    // Set when it was in flight on a connection that broke, it is reported
+    // with this error instead of being sent again
+    int error;
+  };
+  AsyncRequest _asyncQueue[TELEGRAM_ASYNC_QUEUE_SIZE];
+  int _asyncHead = 0;
+  int _asyncCount = 0;
+  // Requests from _asyncHead on that were written and await their response
+  int _asyncInFlight = 0;
+  unsigned long _asyncLastReceived = 0;
+  unsigned long _asyncTimeout = 0;
+  String _asyncBody;
+  AsyncRequest* queueRequest(const String& command);
+  bool startAsyncRequest();
+  void pipelineAsyncRequests();
+  bool feedAsyncResponse();
+  bool asyncResponseDone();
+  void completeAsyncRequest(bool responseRead);
+  void abortAsyncRequest();
+
+  enum SendState { SEND_EMPTY, SEND_WAITING, SEND_IN_FLIGHT };
+  struct QueuedMessage {
+    String chat_id;
+    String text;
+    String parse_mode;
+    TelegramRequestCallback callback;
+    SendState state = SEND_EMPTY;
+  };
+  QueuedMessage _sendQueue[TELEGRAM_SEND_QUEUE_SIZE];
+  int _sendHead = 0;
+  int _sendCount = 0;
+  TelegramRateLimiter _rateLimiter;
+  void dispatchQueuedMessages();
+  bool sendReplyKeyboardMessage(const String& chat_id, const String& text, const String& parse_mode,
+                                const char *keyboard, size_t length, bool resize, bool oneTime,
+                                bool selective);
+  bool sendInlineKeyboardMessage(const String& chat_id, const String& text, const String& parse_mode,
+                                 const char *keyboard, size_t length, int message_id);
+  void completeQueuedMessage(int slot, int error, const String& response);
+
+  bool retryFailedSend();
+
   // JsonObject * parseUpdates(String response);
   String _token;
   Client *client;
+  TelegramHttpParser _http;
+  TelegramReadBuffer _rx;
+  TelegramJsonArena _json;
+  String _webhookSecret;
+  bool _stateDirty = false;
+  bool _stateSaved = false;
+  unsigned long _stateSavedAt = 0;
+  void stateChanged();
+  void persistStateIfDue();
+  unsigned long _lastActivity = 0;
+  unsigned int _serverKeepAliveTimeout = 0;
+  bool _connectionReusable = false;
+  bool _reusedConnection = false;
+  bool _allowedUpdatesSent = false;
+  bool connectClient();
+  bool resendOnNewConnection(bool sent);
+  void releaseClient();
   void closeClient();
-  bool getFile(String& file_path, long& file_size, const String& file_id);
-  bool processResult(JsonObject result, int messageIndex);
+  void finishResponse();
+
+  // Request whose metrics are being collected
+  TelegramRequestMetrics _request;
+  TelegramEndpointMetrics *_requestEndpoint = nullptr;
+  bool _requestPending = false;
+  unsigned long _phaseStart = 0;
+  unsigned long _requestReceived = 0;
+  void startMetrics(const String& command);
+  bool endRequest(TelegramBufferedPrint& request);
+  void finishMetrics();
+  bool sendGetRequest(const String& command);
+  // Slice of a long text that is sent in place of the "text" member of a
+  // payload, between the markup that balances it. Only the last one
+  // carries the reply_markup
+  struct TextPart {
+    const char *text;
+    size_t length;
+    const String *opening;
+    const String *closing;
+    bool last;
+  };
+  bool sendPostRequest(const String& command, JsonObject payload);
+  bool sendPostRequest(const String& command, const String& payload);
+  bool sendPostRequest(const String& command, JsonObject payload, const TextPart& part);
+  bool sendRequest(const String& command, JsonObject *payload, const TextPart *part);
+  void writeRequestHead(Print& request, const __FlashStringHelper* method,
+                        const String& command, long contentLength, bool multipart = false);
+  String sendFile(const String& method, const char* field, const String& chat_id, Stream& file,
+                  size_t size, const String& fileName, const String& contentType,
+                  const String& caption);
+  int _queueHead = 0;
+  int _queueCount = 0;
+  char *_arena = nullptr;
+  size_t _arenaSize = 0;
+  size_t _arenaUsed = 0;
+
+  // Where a batch of parsed updates ends up
+  enum UpdateTarget { TARGET_MESSAGES, TARGET_QUEUE, TARGET_COMPACT };
+  int requestUpdates(long offset, int limit, UpdateTarget target);
+  int getUpdatesStreaming(const String& command, UpdateTarget target);
+  bool sendForResponse(const String& command, JsonObject *payload = nullptr,
+                       const TextPart *part = nullptr);
+  void readResponse(JsonDocument& doc);
+  int processUpdates(JsonDocument& doc, UpdateTarget target);
+  bool storeUpdate(JsonObject result, UpdateTarget target, int index);
+  const char* arenaStore(const char* str);
+  void arenaStore(telegramUpdate& update);
+
+  // Recently resolved file paths, the least recently used one is replaced
+  struct FileCacheEntry {
+    String uniqueId;
+    String path;
+    long size = 0;
+    unsigned long resolved = 0;
+    unsigned long used = 0;
+  };
+  FileCacheEntry _fileCache[TELEGRAM_FILE_CACHE_SIZE];
+  unsigned long _fileCacheClock = 0;
+  bool resolveFile(const String& file_id, const String& file_unique_id, String& path, long& size);
+  bool downloadRange(const String& command, long& received, long size, Print& sink,
+                     unsigned long start);
+  bool processResult(JsonObject result, telegramUpdate& update);
+  void processMessage(JsonObject message, telegramUpdate& update);
+  void processFile(JsonObject file, telegramUpdate& update);
 };
 
 #endif